@@ -0,0 +1,101 @@
+#!/bin/bash
+#
+# Loopback benchmark: sends a file through datadiode-send, datadiode-recv and datadiode-recovery for every
+# combination of file size, xor size, spray and loss model, the loss is injected into the sender by lossinject.so
+#
+#	SIZES="1048576 8388608" XORS="4 8" SPRAYS="2 6" LOSSES="0 0.01 ge:0.01,0.25" ./bench.sh
+#
+# LOSSES are DD_LOSS values of lossinject.c (0 = no loss). On a veth pair (see README) set HOST to the receiver
+# address and RECV_WRAP="ip netns exec diode"; the receiver has to see the same DIR.
+#
+# Columns: wall time of the data phase (from the start of the sender to its EOF tail) plus the recovery run, goodput
+# over that time, the fixed EOF tail of the sender (left out of the wall time), CPU seconds of all three programs per
+# GB of file (the sender up to its tail), packets sent and dropped by the injector, slices of the file, clear slices
+# received, slices rebuilt by recovery and the byte-exact comparison with the original.
+
+SIZES=${SIZES:-"1048576 8388608"}
+XORS=${XORS:-"4 8"}
+SPRAYS=${SPRAYS:-"2 6"}
+LOSSES=${LOSSES:-"0 0.01 ge:0.01,0.25"}
+HOST=${HOST:-127.0.0.1}
+PORT=${PORT:-7100}
+SEED=${SEED:-1}
+if [ -z "$DIR" ]; then
+	DIR=$(mktemp -d /tmp/datadiode-bench.XXXXXX)
+	TEMPDIR=$DIR
+fi
+BIN=$(cd "$(dirname "$0")" && pwd)
+DATALEN=1364
+MAGIC='*' # MAGICNUMBER 42 marks a received slice
+
+TICK=$(getconf CLK_TCK)
+TIMEFORMAT='%R %U %S'
+
+# user + system time of a running process in seconds
+cputime() {
+	awk -v tick=$TICK '{ print ($14 + $15) / tick }' /proc/$1/stat 2>/dev/null || echo 0
+}
+
+mkdir -p "$DIR/in" "$DIR/out" || exit 1
+printf "%-10s %-4s %-5s %-14s %8s %8s %7s %9s %8s %7s %7s %7s %9s %s\n" \
+	size xor spray loss wall_s Mbps tail_s cpu_s/GB sent dropped slices clear recovered cmp
+
+for size in $SIZES; do
+	head -c $size /dev/urandom > "$DIR/in/bench.bin"
+	slices=$(( (size + DATALEN - 1) / DATALEN ))
+	for xor in $XORS; do
+	for spray in $SPRAYS; do
+	for loss in $LOSSES; do
+		rm -f "$DIR"/out/bench.bin* "$DIR/loss"
+
+		$RECV_WRAP "$BIN/datadiode-recv" $PORT "$DIR/out" > "$DIR/recv.log" 2>&1 &
+		recv=$!
+		sleep 0.3
+
+		start=$(date +%s.%N)
+		DD_LOSS=$loss DD_LOSS_SEED=$SEED DD_LOSS_REPORT="$DIR/loss" LD_PRELOAD="$BIN/lossinject.so" \
+			"$BIN/datadiode-send" $HOST $PORT "$DIR/in/bench.bin" $xor $spray > "$DIR/send.log" 2>&1 &
+		send=$!
+		# the data phase ends where the sender starts its EOF tail (stderr, unbuffered)
+		while kill -0 $send 2>/dev/null && ! grep -q "EOF packets" "$DIR/send.log"; do
+			sleep 0.01
+		done
+		data=$(date +%s.%N)
+		sendcpu=$(cputime $send)
+		wait $send
+		tail=$(date +%s.%N)
+		for i in $(seq 50); do
+			[ -e "$DIR/out/bench.bin.finished" ] && break
+			sleep 0.1
+		done
+		recvcpu=$(cputime $recv)
+		kill $recv 2>/dev/null; wait $recv 2>/dev/null
+
+		clear=$(tr -cd "$MAGIC" < "$DIR/out/bench.bin_clear_list.in" 2>/dev/null | wc -c)
+		{ time "$BIN/datadiode-recovery" "$DIR/out" bench.bin $xor > "$DIR/recovery.log" 2>&1 ; } 2> "$DIR/recovery.time"
+
+		if cmp -s "$DIR/in/bench.bin" "$DIR/out/bench.bin"; then
+			result=ok
+			recovered=$(( slices - clear ))
+		else
+			result=FAIL
+			recovered=$(( $(tr -cd "$MAGIC" < "$DIR/out/bench.bin_clear_list.in" 2>/dev/null | wc -c) - clear ))
+		fi
+		read sent dropped <<< $(awk '{ s += $2; d += $4 } END { print s + 0, d + 0 }' "$DIR/loss" 2>/dev/null)
+
+		awk -v size=$size -v xor=$xor -v spray=$spray -v loss=$loss -v start=$start -v data=$data -v tail=$tail \
+			-v sendcpu=$sendcpu -v recvcpu=$recvcpu -v sent=$sent -v dropped=$dropped -v slices=$slices -v clear=$clear \
+			-v recovered=$recovered -v result=$result -v recovery="$(cat "$DIR/recovery.time")" 'BEGIN {
+			split(recovery, r, " ")
+			wall = data - start + r[1]
+			cpu = sendcpu + r[2] + r[3] + recvcpu
+			printf "%-10d %-4d %-5d %-14s %8.2f %8.1f %7.2f %9.1f %8d %7d %7d %7d %9d %s\n", size, xor, spray, loss,
+				wall, size * 8 / wall / 1e6, tail - data, cpu / (size / 1e9), sent, dropped, slices, clear, recovered, result
+		}'
+	done
+	done
+	done
+done
+
+[ -n "$TEMPDIR" ] && rm -rf "$TEMPDIR"
+exit 0
@@ -0,0 +1,275 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "bundle.h"
+
+#define BUNDLE_COPY (1 << 20)
+
+static void put(unsigned char *p, uint64_t v, uint8_t len) {
+	for(uint8_t i=0; i<len; i++)
+		p[i] = (v >> ((len - 1 - i) * 8)) & 0xFF;
+}
+
+static uint64_t get(unsigned char *p, uint8_t len) {
+	uint64_t v = 0;
+	for(uint8_t i=0; i<len; i++)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static int write_all(int fd, unsigned char *buf, size_t len) {
+	while(len > 0) {
+		ssize_t n = write(fd, buf, len);
+		if(n == -1) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int read_all(int fd, unsigned char *buf, size_t len) {
+	while(len > 0) {
+		ssize_t n = read(fd, buf, len);
+		if(n == -1 && errno == EINTR)
+			continue;
+		if(n <= 0)
+			return -1;
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+// write index and data of the entries to fd, a file that shrank is padded with zeros, -1 on error
+int bundle_write(int fd, bundle_entry_t *entries, uint32_t count) {
+	unsigned char head[30];
+	unsigned char *buf = (unsigned char *)malloc(BUNDLE_COPY);
+	if(buf == NULL)
+		return -1;
+
+	memcpy(head, BUNDLE_MAGIC, BUNDLE_MAGICLEN);
+	put(head + BUNDLE_MAGICLEN, count, 4);
+	if(write_all(fd, head, BUNDLE_MAGICLEN + 4) == -1)
+		goto fail;
+
+	for(uint32_t i=0; i<count; i++) {
+		uint16_t len = strlen(entries[i].name);
+		put(head, len, 2);
+		put(head + 2, entries[i].mode, 4);
+		put(head + 6, entries[i].mtime, 8);
+		put(head + 14, entries[i].size, 8);
+		if(write_all(fd, head, 22) == -1 || write_all(fd, (unsigned char *)entries[i].name, len) == -1)
+			goto fail;
+	}
+
+	for(uint32_t i=0; i<count; i++) {
+		int in = open(entries[i].path, O_RDONLY);
+		if(in == -1)
+			goto fail;
+		uint64_t left = entries[i].size;
+		while(left > 0) {
+			ssize_t n = read(in, buf, (left < BUNDLE_COPY) ? left : BUNDLE_COPY);
+			if(n == -1 && errno == EINTR)
+				continue;
+			if(n == -1) {
+				close(in);
+				goto fail;
+			}
+			// the index already promised size bytes
+			if(n == 0) {
+				n = (left < BUNDLE_COPY) ? left : BUNDLE_COPY;
+				memset(buf, 0, n);
+			}
+			if(write_all(fd, buf, n) == -1) {
+				close(in);
+				goto fail;
+			}
+			left -= n;
+		}
+		close(in);
+	}
+
+	free(buf);
+	return 0;
+
+fail:
+	free(buf);
+	return -1;
+}
+
+// bundles are recognised by name and magic
+uint8_t bundle_check(char *path) {
+	size_t len = strlen(path), slen = strlen(BUNDLE_SUFFIX);
+	unsigned char magic[BUNDLE_MAGICLEN];
+
+	if(len < slen || strcmp(path + len - slen, BUNDLE_SUFFIX) != 0)
+		return 0;
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+		return 0;
+	uint8_t ok = (read_all(fd, magic, BUNDLE_MAGICLEN) == 0 && memcmp(magic, BUNDLE_MAGIC, BUNDLE_MAGICLEN) == 0);
+	close(fd);
+	return ok;
+}
+
+// names come from the other side of the diode: relative, no .. components
+static uint8_t safe_name(char *name) {
+	if(name[0] == '/' || strlen(name) >= BUNDLE_NAMELEN)
+		return 0;
+	for(char *p = name; ; ) {
+		char *end = strchr(p, '/');
+		size_t len = (end != NULL) ? (size_t)(end - p) : strlen(p);
+		if(len == 0 || (len == 2 && p[0] == '.' && p[1] == '.'))
+			return 0;
+		if(end == NULL)
+			return 1;
+		p = end + 1;
+	}
+}
+
+static void make_parents(char *path) {
+	for(char *p = strchr(path + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+		*p = 0;
+		mkdir(path, 0777);
+		*p = '/';
+	}
+}
+
+// move a file of a spool that was sent on its own to its name below folder, like an unpacked member; 0 or -1
+int bundle_place(char *path, char *folder, char *name, uint32_t mode, uint64_t mtime) {
+	char out[BUNDLE_NAMELEN + 512];
+
+	if(!safe_name(name)) {
+		fprintf(stderr, "[recovery] refusing to place %s\n", name);
+		return -1;
+	}
+	snprintf(out, sizeof(out), "%s/%s", folder, name);
+	make_parents(out);
+
+	// permission bits only, setuid, setgid and sticky from the far side of the diode are dropped
+	struct timespec times[2] = { { mtime, 0 }, { mtime, 0 } };
+	chmod(path, mode & 0777);
+	utimensat(AT_FDCWD, path, times, 0);
+	if(rename(path, out) == -1) {
+		perror("[recovery] failed to rename spool file");
+		return -1;
+	}
+	return 0;
+}
+
+// unpack every file of the bundle below folder, returns the number of files or -1
+int bundle_unpack(char *path, char *folder) {
+	unsigned char head[22];
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+		return -1;
+
+	if(read_all(fd, head, BUNDLE_MAGICLEN + 4) == -1 || memcmp(head, BUNDLE_MAGIC, BUNDLE_MAGICLEN) != 0) {
+		close(fd);
+		return -1;
+	}
+	uint32_t count = get(head + BUNDLE_MAGICLEN, 4);
+	if(count > BUNDLE_MAXCOUNT) {
+		close(fd);
+		return -1;
+	}
+
+	bundle_entry_t *entries = (bundle_entry_t *)calloc(count > 0 ? count : 1, sizeof(bundle_entry_t));
+	unsigned char *buf = (unsigned char *)malloc(BUNDLE_COPY);
+	int ret = -1;
+	if(entries == NULL || buf == NULL)
+		goto done;
+
+	for(uint32_t i=0; i<count; i++) {
+		if(read_all(fd, head, 22) == -1)
+			goto done;
+		uint16_t len = get(head, 2);
+		entries[i].mode = get(head + 2, 4);
+		entries[i].mtime = get(head + 6, 8);
+		entries[i].size = get(head + 14, 8);
+		entries[i].name = (char *)calloc(len + 1, 1);
+		if(entries[i].name == NULL || read_all(fd, (unsigned char *)entries[i].name, len) == -1)
+			goto done;
+	}
+
+	for(uint32_t i=0; i<count; i++) {
+		char out[BUNDLE_NAMELEN + 512], tmp[BUNDLE_NAMELEN + 520];
+		uint8_t skip = !safe_name(entries[i].name);
+		int ofd = -1;
+
+		if(skip)
+			fprintf(stderr, "[recovery] refusing to unpack %s\n", entries[i].name);
+		else {
+			snprintf(out, sizeof(out), "%s/%s", folder, entries[i].name);
+			snprintf(tmp, sizeof(tmp), "%s.part", out);
+			make_parents(tmp);
+			ofd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+			if(ofd == -1) {
+				perror("[recovery] failed to create unpacked file");
+				goto done;
+			}
+		}
+
+		uint64_t left = entries[i].size;
+		while(left > 0) {
+			size_t n = (left < BUNDLE_COPY) ? left : BUNDLE_COPY;
+			if(read_all(fd, buf, n) == -1 || (ofd != -1 && write_all(ofd, buf, n) == -1)) {
+				if(ofd != -1)
+					close(ofd);
+				goto done;
+			}
+			left -= n;
+		}
+		if(ofd == -1)
+			continue;
+
+		struct timespec times[2] = { { entries[i].mtime, 0 }, { entries[i].mtime, 0 } };
+		fchmod(ofd, entries[i].mode & 0777);	// no setuid, setgid or sticky bits, like bundle_place
+		futimens(ofd, times);
+		close(ofd);
+		if(rename(tmp, out) == -1) {
+			perror("[recovery] failed to rename unpacked file");
+			goto done;
+		}
+	}
+	ret = count;
+
+done:
+	for(uint32_t i=0; entries != NULL && i<count; i++)
+		free(entries[i].name);
+	free(entries);
+	free(buf);
+	close(fd);
+	return ret;
+}
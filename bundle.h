@@ -0,0 +1,57 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __BUNDLE_FOUNTAIN__
+#define __BUNDLE_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Bundle of small files sent as one transfer object (".ddb"), unpacked by recovery
+ *		Magic					: 8 bytes		-> "DDBUNDL1"
+ *		File count				: 4 bytes
+ *		Index, per file			: name length (2), mode (4), mtime (8), size (8), relative name
+ *		Data					: the files one after the other, in index order
+ * all numbers big endian */
+
+#define BUNDLE_MAGIC "DDBUNDL1"
+#define BUNDLE_MAGICLEN 8
+#define BUNDLE_SUFFIX ".ddb"
+#define BUNDLE_NAMELEN 4096
+#define BUNDLE_MAXCOUNT (1 << 24)
+
+typedef struct {
+	char *path;			// on the sender
+	char *name;			// relative to the spool, as unpacked
+	uint32_t mode;
+	uint64_t mtime;
+	uint64_t size;
+} bundle_entry_t;
+
+int bundle_write(int fd, bundle_entry_t *entries, uint32_t count);
+uint8_t bundle_check(char *path);
+int bundle_unpack(char *path, char *folder);
+int bundle_place(char *path, char *folder, char *name, uint32_t mode, uint64_t mtime);
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "compress.h"
+
+static void put(unsigned char *p, uint32_t v) {
+	for(uint8_t i=0; i<4; i++)
+		p[i] = (v >> ((3 - i) * 8)) & 0xFF;
+}
+
+static uint32_t get(unsigned char *p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static int write_all(int fd, unsigned char *buf, size_t len) {
+	while(len > 0) {
+		ssize_t n = write(fd, buf, len);
+		if(n == -1) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+// reads up to len bytes, less only at the end of the file
+static ssize_t read_full(int fd, unsigned char *buf, size_t len) {
+	size_t got = 0;
+	while(got < len) {
+		ssize_t n = read(fd, buf + got, len - got);
+		if(n == -1 && errno == EINTR)
+			continue;
+		if(n == -1)
+			return -1;
+		if(n == 0)
+			break;
+		got += n;
+	}
+	return got;
+}
+
+// codec of a -Z argument, -1 if unknown or not built in
+int codec_parse(char *name) {
+	#ifdef HAVE_LZ4
+	if(strcmp(name, "lz4") == 0)
+		return CODEC_LZ4;
+	#endif
+	#ifdef HAVE_ZSTD
+	if(strcmp(name, "zstd") == 0)
+		return CODEC_ZSTD;
+	#endif
+	return -1;
+}
+
+char *codec_name(uint8_t codec) {
+	switch(codec) {
+	case CODEC_LZ4:
+		return "lz4";
+	case CODEC_ZSTD:
+		return "zstd";
+	default:
+		return "none";
+	}
+}
+
+static size_t bound(uint8_t codec, size_t len) {
+	#ifdef HAVE_LZ4
+	if(codec == CODEC_LZ4)
+		return LZ4_compressBound(len);
+	#endif
+	#ifdef HAVE_ZSTD
+	if(codec == CODEC_ZSTD)
+		return ZSTD_compressBound(len);
+	#endif
+	return len;
+}
+
+// compressed size, 0 when the chunk does not shrink
+static size_t pack(uint8_t codec, int level, unsigned char *src, size_t len, unsigned char *dst, size_t cap) {
+	size_t n = 0;
+	#ifdef HAVE_LZ4
+	if(codec == CODEC_LZ4) {
+		// level is the acceleration, higher is faster
+		int r = LZ4_compress_fast((char *)src, (char *)dst, len, cap, (level > 0) ? level : 1);
+		n = (r > 0) ? r : 0;
+	}
+	#endif
+	#ifdef HAVE_ZSTD
+	if(codec == CODEC_ZSTD) {
+		size_t r = ZSTD_compress(dst, cap, src, len, (level > 0) ? level : 3);
+		n = ZSTD_isError(r) ? 0 : r;
+	}
+	#endif
+	return (n > 0 && n < len) ? n : 0;
+}
+
+static int unpack(uint8_t codec, unsigned char *src, size_t len, unsigned char *dst, size_t raw) {
+	#ifdef HAVE_LZ4
+	if(codec == CODEC_LZ4)
+		return (LZ4_decompress_safe((char *)src, (char *)dst, len, raw) == (int)raw) ? 0 : -1;
+	#endif
+	#ifdef HAVE_ZSTD
+	if(codec == CODEC_ZSTD) {
+		size_t r = ZSTD_decompress(dst, raw, src, len);
+		return (!ZSTD_isError(r) && r == raw) ? 0 : -1;
+	}
+	#endif
+	return -1;
+}
+
+// compress in into the chunked object at out, reports raw and packed sizes; -1 on error
+int compress_file(int in, int out, uint8_t codec, int level, uint64_t *raw, uint64_t *packed) {
+	size_t cap = bound(codec, COMPRESS_CHUNK);
+	unsigned char *src = (unsigned char *)malloc(COMPRESS_CHUNK);
+	unsigned char *dst = (unsigned char *)malloc(COMPRESS_HDRLEN + cap);
+	int ret = -1;
+
+	*raw = 0;
+	*packed = COMPRESS_MAGICLEN;
+	if(src == NULL || dst == NULL || write_all(out, (unsigned char *)COMPRESS_MAGIC, COMPRESS_MAGICLEN) == -1)
+		goto done;
+
+	for(;;) {
+		ssize_t len = read_full(in, src, COMPRESS_CHUNK);
+		if(len == -1)
+			goto done;
+		if(len == 0)
+			break;
+
+		size_t n = pack(codec, level, src, len, dst + COMPRESS_HDRLEN, cap);
+		put(dst, len);
+		if(n > 0) {
+			put(dst + 4, n);
+			dst[8] = codec;
+			if(write_all(out, dst, COMPRESS_HDRLEN + n) == -1)
+				goto done;
+		}
+		else {
+			// incompressible, stored
+			put(dst + 4, len);
+			dst[8] = CODEC_NONE;
+			if(write_all(out, dst, COMPRESS_HDRLEN) == -1 || write_all(out, src, len) == -1)
+				goto done;
+			n = len;
+		}
+		*raw += len;
+		*packed += COMPRESS_HDRLEN + n;
+	}
+	ret = 0;
+
+done:
+	free(src);
+	free(dst);
+	return ret;
+}
+
+// expand the chunked object at in into out, -1 on a damaged object or an unknown codec
+int decompress_file(int in, int out) {
+	unsigned char hdr[COMPRESS_HDRLEN];
+	unsigned char *src = (unsigned char *)malloc(bound(CODEC_ZSTD, COMPRESS_CHUNK) + bound(CODEC_LZ4, COMPRESS_CHUNK));
+	unsigned char *dst = (unsigned char *)malloc(COMPRESS_CHUNK);
+	int ret = -1;
+
+	if(src == NULL || dst == NULL || read_full(in, hdr, COMPRESS_MAGICLEN) != COMPRESS_MAGICLEN ||
+		memcmp(hdr, COMPRESS_MAGIC, COMPRESS_MAGICLEN) != 0)
+		goto done;
+
+	for(;;) {
+		ssize_t n = read_full(in, hdr, COMPRESS_HDRLEN);
+		if(n == 0)
+			break;
+		if(n != COMPRESS_HDRLEN)
+			goto done;
+		uint32_t raw = get(hdr), stored = get(hdr + 4);
+		if(raw > COMPRESS_CHUNK || stored > bound(hdr[8], COMPRESS_CHUNK) || (hdr[8] == CODEC_NONE && stored != raw))
+			goto done;
+		if(read_full(in, src, stored) != stored)
+			goto done;
+
+		if(hdr[8] == CODEC_NONE) {
+			if(write_all(out, src, raw) == -1)
+				goto done;
+		}
+		else if(unpack(hdr[8], src, stored, dst, raw) == -1 || write_all(out, dst, raw) == -1)
+			goto done;
+	}
+	ret = 0;
+
+done:
+	free(src);
+	free(dst);
+	return ret;
+}
@@ -0,0 +1,51 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __COMPRESS_FOUNTAIN__
+#define __COMPRESS_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Chunked compressed object, what the sender puts on the link with -Z and recovery expands again
+ *		Magic					: 4 bytes		-> "DDZ1"
+ *		per chunk				: raw length (4), stored length (4), codec (1), stored bytes
+ * chunks of COMPRESS_CHUNK bytes are compressed on their own, a chunk that does not shrink is stored as is
+ * all numbers big endian */
+
+#define CODEC_NONE 0
+#define CODEC_LZ4 1
+#define CODEC_ZSTD 2
+
+#define COMPRESS_MAGIC "DDZ1"
+#define COMPRESS_MAGICLEN 4
+#define COMPRESS_CHUNK (1 << 20)
+#define COMPRESS_HDRLEN 9
+
+int codec_parse(char *name);
+char *codec_name(uint8_t codec);
+int compress_file(int in, int out, uint8_t codec, int level, uint64_t *raw, uint64_t *packed);
+int decompress_file(int in, int out);
+
+#endif
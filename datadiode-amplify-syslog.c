@@ -23,6 +23,7 @@
 */   
 
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -34,18 +35,80 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <stdint.h>
-
-#define AMPFACTOR 1000   // send each line AMPFACTOR times using AMPFACTOR packets
+#include <poll.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <sys/random.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include "fec.h"
+#include "sysframe.h"
+
+#define AMPFACTOR 1000   // default, send each line AMPFACTOR times using AMPFACTOR packets (-a changes it)
+#define BATCH 1024       // repetitions handed to the kernel per sendmmsg() call, UIO_MAXIOV is the limit
 		       
-// listener port
+// listener port, when no -u, -t or -x is given
 #define MYPORT "1514"    // 514 default SYSLOG port requires root, RFC 5424, need to drop privileges and maybe chroot
+#define MAXLISTENERS 64
+#define MAXEVENTS 64
+#define DGRAMREADS 64    // datagrams read from one socket per wakeup, the others get their turn
 
 // destination port for datadiode-deamplify514
 #define SERVERPORT "2514"    // the port users will be connecting to, same 514 from RFC 5424
 			     
-#define MAXBUFLEN 1024 + sizeof(uint16_t)  // needs jumbo frames for longer lines like 8192+2, set MTU to 9000 on data-diode interfaces
-
-uint16_t counter=0;   // this normally overflows, as it should. we just want to clear duplicate packets on the receiver side
+#define MAXBUFLEN 65536   // largest line taken in, lines are cut to what fits one datagram
+#define DATAGRAM 1472     // default datagram size (-m), Ethernet MTU; with jumbo frames (MTU 9000) use 8972
+#define DELAY 1000        // default batching deadline in microseconds (-d)
+
+int ampfactor = -1;      // AMPFACTOR, 1 in coded mode
+
+/* lines are coalesced into datagrams of up to -m bytes: <length (2)><line> each, big endian, after the source and
+ * frame header; a datagram leaves when the next line does not fit or -d microseconds after its first line */
+int datagram = DATAGRAM;
+long delay_us = DELAY;
+size_t batch_room = 0;
+
+/* ingest: UDP (-u) and Unix datagram (-x) sockets take a line per datagram, TCP listeners (-t) accept connections
+ * with RFC 6587 framing, octet counting or LF terminated lines. Every datagram socket and every connection is a
+ * source with its own random id, sequence numbers and batch; a closed connection leaves its id and sequence number
+ * to the next one accepted by its listener, so clients that reconnect do not fill the table of the deamplifier */
+#define SRC_DGRAM 0
+#define SRC_LISTEN 1
+#define SRC_STREAM 2
+#define STREAMBUF (2 * MAXBUFLEN + 16)
+
+typedef struct source {
+    int fd, kind;
+    uint32_t id;
+    uint64_t seq;
+    unsigned char *batch;        // room for the frame header, the datagram header, then the lines
+    size_t batch_len;
+    struct timespec batch_start;
+    struct source *prev, *next;  // open batches, oldest first: the same delay for all makes it deadline order
+    char *in;                    // stream: bytes not framed yet
+    size_t in_len;
+    struct source *listener;     // stream: where it goes back when the connection closes
+    struct source *spare;        // listener: closed connections to reuse, linked by spare
+} source_t;
+
+source_t *open_head = NULL, *open_tail = NULL;
+int epfd;
+
+// -F k,r[,ms]: coded mode, windows of up to k datagrams closed after ms with r Reed-Solomon repair frames
+int coded = 0, window_k = 0, window_r = 0, window_ms = 50;
+uint32_t run, window = 0;    // run: random per start, the deamplifier keeps the windows of a restart apart
+int window_count = 0;
+size_t window_len[FEC_MAXBLOCKS];    // block bytes: length + payload
+uint8_t *window_block[FEC_MAXBLOCKS];
+struct timespec window_start;
+
+int sockfdout;
+struct iovec iov;
+struct mmsghdr msgs[BATCH];
+
+// the deamplifier drops copies by source and sequence number, a restarted amplifier has new sources
 
 // get sockaddr, IPv4 or IPv6:
 void *get_in_addr(struct sockaddr *sa)
@@ -57,53 +120,373 @@ void *get_in_addr(struct sockaddr *sa)
     return &(((struct sockaddr_in6*)sa)->sin6_addr);
 }
 
-int main(void)
+// send len bytes of data ampfactor times, BATCH per system call
+void send_copies(char *data, size_t len)
+{
+    int i, numbytes;
+
+    iov.iov_base = data;
+    iov.iov_len = len;
+    for (i=0; i<ampfactor; ) {
+        int n = (ampfactor - i < BATCH) ? ampfactor - i : BATCH;
+        if ((numbytes = sendmmsg(sockfdout, msgs, n, 0)) == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("talker: sendmmsg");
+            break;
+        }
+        i += numbytes; // a short count is resumed, the rest of the batch was not sent
+    }
+}
+
+long elapsed_us(struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000 + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+// coded mode: repair frames of the open window, then the next one starts
+void close_window(void)
+{
+    uint8_t *repair[FEC_MAXBLOCKS];
+    static unsigned char frame[SYSFRAME_HEADER + MAXBUFLEN];
+    size_t block = 0;
+    int i;
+
+    if (window_count == 0)
+        return;
+    for (i=0; i<window_count; i++)
+        if (window_len[i] > block)
+            block = window_len[i];
+    for (i=0; i<window_count; i++)
+        memset(window_block[i] + window_len[i], 0, block - window_len[i]);
+    for (i=0; i<window_r; i++)
+        repair[i] = window_block[window_k + i];
+    fec_encode(window_count, window_r, window_block, repair, block);
+
+    for (i=0; i<window_r; i++) {
+        sysframe_t f = { SYSFRAME_REPAIR, window_count + i, run, window, window_count, window_r, block };
+        sysframe_serialize(&f, frame);
+        memcpy(frame + SYSFRAME_HEADER, repair[i], block);
+        send_copies((char *)frame, SYSFRAME_HEADER + block);
+    }
+    window++;
+    window_count = 0;
+}
+
+// coded mode: the batch goes out now in a data frame, its block waits for the repair frames
+void send_coded(unsigned char *payload, size_t len)
+{
+    sysframe_t f = { SYSFRAME_DATA, window_count, run, window, 0, window_r, len };
+
+    if (window_count == 0)
+        clock_gettime(CLOCK_MONOTONIC, &window_start);
+    sysframe_serialize(&f, payload - SYSFRAME_HEADER);
+    send_copies((char *)payload - SYSFRAME_HEADER, SYSFRAME_HEADER + len);
+
+    uint8_t *b = window_block[window_count];
+    b[0] = len >> 8;
+    b[1] = len;
+    memcpy(b + 2, payload, len);
+    window_len[window_count++] = len + 2;
+    if (window_count == window_k)
+        close_window();
+}
+
+// the batch leaves behind its source and sequence number, in coded mode also behind the frame header
+void flush_batch(source_t *src)
+{
+    unsigned char *dgram = src->batch + SYSFRAME_HEADER;
+
+    if (src->batch_len == 0)
+        return;
+    if (src->prev) src->prev->next = src->next; else open_head = src->next;
+    if (src->next) src->next->prev = src->prev; else open_tail = src->prev;
+    src->prev = src->next = NULL;
+
+    sysdgram_serialize(src->id, src->seq++, dgram);
+    if (coded)
+        send_coded(dgram, SYSDGRAM_HEADER + src->batch_len);
+    else
+        send_copies((char *)dgram, SYSDGRAM_HEADER + src->batch_len); // send ampfactor times
+    src->batch_len = 0;
+}
+
+void add_line(source_t *src, char *line, size_t len)
+{
+    unsigned char *lines = src->batch + SYSFRAME_HEADER + SYSDGRAM_HEADER;
+
+    if (len > 0 && line[len-1] == '\n')
+        len--;
+    if (len + 2 > batch_room) // longer than a datagram, the end is cut
+        len = batch_room - 2;
+    if (src->batch_len + 2 + len > batch_room)
+        flush_batch(src);
+    if (src->batch_len == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &src->batch_start);
+        src->prev = open_tail;
+        if (open_tail) open_tail->next = src; else open_head = src;
+        open_tail = src;
+    }
+    lines[src->batch_len] = len >> 8;
+    lines[src->batch_len + 1] = len;
+    memcpy(lines + src->batch_len + 2, line, len);
+    src->batch_len += 2 + len;
+    if (delay_us == 0)
+        flush_batch(src);
+}
+
+source_t *add_source(int fd, int kind, source_t *listener)
+{
+    source_t *src = listener ? listener->spare : NULL;
+    struct epoll_event ev;
+
+    if (src != NULL) {
+        listener->spare = src->spare;
+        src->spare = NULL;
+        src->in_len = 0;
+    }
+    else if ((src = calloc(1, sizeof(source_t))) == NULL || (kind != SRC_LISTEN && (src->batch = malloc(SYSFRAME_HEADER + SYSDGRAM_HEADER + batch_room)) == NULL) ||
+        (kind == SRC_STREAM && (src->in = malloc(STREAMBUF)) == NULL)) {
+        perror("malloc");
+        exit(1);
+    }
+    else {
+        src->listener = listener;
+        if (getrandom(&src->id, sizeof(src->id), 0) != sizeof(src->id))
+            src->id = time(NULL) ^ ((uint32_t)getpid() << 16) ^ fd;
+    }
+    src->fd = fd;
+    src->kind = kind;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    ev.events = EPOLLIN;
+    ev.data.ptr = src;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        perror("epoll_ctl");
+        exit(1);
+    }
+    return src;
+}
+
+void close_source(source_t *src)
+{
+    flush_batch(src);
+    close(src->fd); // leaves the epoll set
+    if (src->listener) {
+        src->spare = src->listener->spare;
+        src->listener->spare = src;
+        return;
+    }
+    free(src->batch);
+    free(src->in);
+    free(src);
+}
+
+// RFC 6587: "<length> <message>" when the frame starts with a digit, else a line up to LF (or NUL)
+void stream_input(source_t *src)
+{
+    ssize_t n = recv(src->fd, src->in + src->in_len, STREAMBUF - src->in_len, 0);
+    size_t pos = 0;
+
+    if (n == 0 || (n == -1 && errno != EAGAIN && errno != EINTR)) {
+        close_source(src);
+        return;
+    }
+    if (n == -1)
+        return;
+    src->in_len += n;
+
+    while (pos < src->in_len) {
+        char *frame = src->in + pos, *end;
+        size_t left = src->in_len - pos;
+        if (isdigit((unsigned char)frame[0])) {
+            size_t digits = 0, msglen = 0;
+            while (digits < left && isdigit((unsigned char)frame[digits]) && digits < 6)
+                msglen = msglen * 10 + frame[digits++] - '0';
+            if (digits == left)
+                break;
+            if (frame[digits] != ' ' || msglen > MAXBUFLEN) {
+                fprintf(stderr, "listener: bad octet count from source %08x, closing it\n", src->id);
+                close_source(src);
+                return;
+            }
+            if (digits + 1 + msglen > left)
+                break;
+            add_line(src, frame + digits + 1, msglen);
+            pos += digits + 1 + msglen;
+        }
+        else if ((end = memchr(frame, '\n', left)) != NULL || (end = memchr(frame, '\0', left)) != NULL) {
+            add_line(src, frame, end - frame);
+            pos += end - frame + 1;
+        }
+        else {
+            if (left >= MAXBUFLEN) { // no end in sight, the line is cut
+                add_line(src, frame, MAXBUFLEN);
+                pos += MAXBUFLEN;
+                continue;
+            }
+            break;
+        }
+    }
+    memmove(src->in, src->in + pos, src->in_len - pos);
+    src->in_len -= pos;
+}
+
+void dgram_input(source_t *src)
+{
+    static char buf[MAXBUFLEN];
+    int i;
+
+    for (i=0; i<DGRAMREADS; i++) {
+        ssize_t n = recv(src->fd, buf, MAXBUFLEN, 0);
+        if (n == -1) {
+            if (errno != EAGAIN && errno != EINTR)
+                perror("recvfrom");
+            return;
+        }
+        add_line(src, buf, n);
+    }
+}
+
+// [host:]port or [v6-address]:port, no host listens on all addresses
+int open_listener(char *spec, int socktype)
 {
-    int sockfd, sockfdout,i;
     struct addrinfo hints, *servinfo, *p;
-    int rv;
-    int numbytes,len;
-    struct sockaddr_storage their_addr;
-    char buf[MAXBUFLEN];
-    socklen_t addr_len;
-//    char s[INET6_ADDRSTRLEN];
+    char host[256], *port = spec;
+    int rv, fd = -1, one = 1;
+
+    host[0] = 0;
+    char *colon = strrchr(spec, ':');
+    if (colon != NULL) {
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - spec), spec);
+        if (host[0] == '[') {
+            memmove(host, host + 1, strlen(host));
+            host[strcspn(host, "]")] = 0;
+        }
+        port = colon + 1;
+    }
 
     memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_INET6; // set to AF_INET6 to use IPv6
-    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_family = host[0] ? AF_UNSPEC : AF_INET6; // IPv6 takes IPv4 as well
+    hints.ai_socktype = socktype;
     hints.ai_flags = AI_PASSIVE; // use my IP
-
-    if ((rv = getaddrinfo(NULL, MYPORT, &hints, &servinfo)) != 0) {
-        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(rv));
-        return 1;
+    if ((rv = getaddrinfo(host[0] ? host : NULL, port, &hints, &servinfo)) != 0) {
+        fprintf(stderr, "getaddrinfo %s: %s\n", spec, gai_strerror(rv));
+        exit(1);
     }
 
     // loop through all the results and bind to the first we can
     for(p = servinfo; p != NULL; p = p->ai_next) {
-        if ((sockfd = socket(p->ai_family, p->ai_socktype,
-                p->ai_protocol)) == -1) {
+        if ((fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1) {
             perror("listener: socket");
             continue;
         }
-
-        if (bind(sockfd, p->ai_addr, p->ai_addrlen) == -1) {
-            close(sockfd);
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, p->ai_addr, p->ai_addrlen) == -1 || (socktype == SOCK_STREAM && listen(fd, SOMAXCONN) == -1)) {
+            close(fd);
             perror("listener: bind");
             continue;
         }
-
         break;
     }
-
+    freeaddrinfo(servinfo);
     if (p == NULL) {
-        fprintf(stderr, "listener: failed to bind socket\n");
-        return 2;
+        fprintf(stderr, "listener: failed to bind %s\n", spec);
+        exit(2);
     }
+    return fd;
+}
 
-    freeaddrinfo(servinfo);
+// like /dev/log: every local process may write to it
+int open_unix(char *path)
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (fd == -1 || strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "listener: failed to open %s\n", path);
+        exit(2);
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || chmod(path, 0666) == -1) {
+        perror("listener: bind");
+        exit(2);
+    }
+    return fd;
+}
 
-    printf("listener: waiting to recvfrom...\n");
-    addr_len = sizeof their_addr;
+int main(int argc, char *argv[])
+{
+    int i,opt;
+    struct addrinfo hints, *servinfo, *p;
+    int rv;
+//    char s[INET6_ADDRSTRLEN];
+    char *listen_spec[MAXLISTENERS];
+    int listen_kind[MAXLISTENERS], nlisteners = 0;
+    struct epoll_event events[MAXEVENTS];
+
+    while ((opt = getopt(argc, argv, "a:F:m:d:u:t:x:")) != -1) {
+        if ((opt == 'u' || opt == 't' || opt == 'x') && nlisteners < MAXLISTENERS) {
+            listen_kind[nlisteners] = opt;
+            listen_spec[nlisteners++] = optarg;
+        }
+        else if (opt == 'a' && atoi(optarg) > 0)
+            ampfactor = atoi(optarg);
+        else if (opt == 'm' && atoi(optarg) >= 64 && atoi(optarg) <= 65507)
+            datagram = atoi(optarg);
+        else if (opt == 'd' && atol(optarg) >= 0)
+            delay_us = atol(optarg);
+        else if (opt == 'F' && sscanf(optarg, "%d,%d,%d", &window_k, &window_r, &window_ms) >= 2 &&
+            window_k > 0 && window_r > 0 && window_k + window_r <= FEC_MAXBLOCKS && window_ms > 0)
+            coded = 1;
+        else {
+            fprintf(stderr, "usage: %s [-u [host:]port]... [-t [host:]port]... [-x path]... [-a amplification-factor (default %d, 1 with -F)]\n", argv[0], AMPFACTOR);
+            fprintf(stderr, "       [-F k,r[,ms]] [-m datagram-size] [-d usec]\n");
+            fprintf(stderr, "       -u UDP, -t TCP (RFC 6587 octet counting or LF framing), -x Unix datagram syslog listeners (default -u %s)\n", MYPORT);
+            fprintf(stderr, "       -F send datagrams once in windows of up to k, closed after ms (default 50) with r repair frames\n");
+            fprintf(stderr, "       -m coalesce lines into datagrams of up to this many bytes (default %d, 8972 for jumbo frames)\n", DATAGRAM);
+            fprintf(stderr, "       -d send a datagram at most usec after its first line (default %d, 0 = a line per datagram)\n", DELAY);
+            return 1;
+        }
+    }
+    if (ampfactor == -1)
+        ampfactor = coded ? 1 : AMPFACTOR;
+    // a repair frame carries the block with its 2 length bytes, it must fit -m as well
+    batch_room = datagram - (coded ? SYSFRAME_HEADER + 2 : 0) - SYSDGRAM_HEADER;
+    if (coded && getrandom(&run, sizeof(run), 0) != sizeof(run))
+        run = time(NULL) ^ ((uint32_t)getpid() << 16);
+    if (coded)
+        for (i=0; i<window_k + window_r; i++)
+            if ((window_block[i] = malloc(2 + SYSDGRAM_HEADER + batch_room)) == NULL) {
+                perror("malloc");
+                return 1;
+            }
+
+    if ((epfd = epoll_create1(0)) == -1) {
+        perror("epoll_create1");
+        return 1;
+    }
+    if (nlisteners == 0) {
+        listen_kind[0] = 'u';
+        listen_spec[nlisteners++] = MYPORT;
+    }
+    for (i=0; i<nlisteners; i++) {
+        source_t *src;
+        if (listen_kind[i] == 'u')
+            src = add_source(open_listener(listen_spec[i], SOCK_DGRAM), SRC_DGRAM, NULL);
+        else if (listen_kind[i] == 't')
+            src = add_source(open_listener(listen_spec[i], SOCK_STREAM), SRC_LISTEN, NULL);
+        else
+            src = add_source(open_unix(listen_spec[i]), SRC_DGRAM, NULL);
+        if (src->kind == SRC_DGRAM)
+            printf("listener: source %08x on %s %s\n", src->id, listen_kind[i] == 'u' ? "udp" : "unix", listen_spec[i]);
+        else
+            printf("listener: tcp %s\n", listen_spec[i]);
+    }
 
     memset(&hints, 0, sizeof hints);
     hints.ai_family = AF_INET6; // set to AF_INET6 to use IPv6
@@ -130,28 +513,58 @@ int main(void)
         return 2;
     }
 
-    counter = 0;
-    char *ptr = buf + sizeof(uint16_t);
-    uint8_t *conv = (uint8_t *) &counter;
+    // every repetition is the same datagram: one iovec, BATCH message headers pointing at it
+    memset(msgs, 0, sizeof msgs);
+    for (i=0; i<BATCH; i++) {
+        msgs[i].msg_hdr.msg_name = p->ai_addr;
+        msgs[i].msg_hdr.msg_namelen = p->ai_addrlen;
+        msgs[i].msg_hdr.msg_iov = &iov;
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
     while (1) {  // infinite loop, in UDP packets may be lost so this is preferred 
-	if ((numbytes = recvfrom(sockfd, ptr, MAXBUFLEN-1-sizeof(uint16_t) , 0, 
-	    (struct sockaddr *)&their_addr, &addr_len)) == -1) {
-		perror("recvfrom");
+	// open batches and the open window are sent by their deadlines, ppoll on the epoll set waits to the microsecond
+	long left = 0;
+	int n, timeout = -1, pending = 0;
+	if (open_head != NULL) {
+		left = delay_us - elapsed_us(&open_head->batch_start);
+		pending = 1;
 	}
-	ptr[numbytes] = '\0';
-	len = numbytes;
-
-	
-	for (i=0; i<sizeof(uint16_t); i++) buf[i] = conv[i];
-
-	for (i=0; i<AMPFACTOR; i++) {
-		if ((numbytes = sendto(sockfdout, buf, len-1+sizeof(uint16_t), 0, p->ai_addr, p->ai_addrlen)) == -1) { // send AMPFACTOR times
-        		perror("talker: sendto");
+	if (coded && window_count > 0 && (!pending || window_ms * 1000L - elapsed_us(&window_start) < left)) {
+		left = window_ms * 1000L - elapsed_us(&window_start);
+		pending = 1;
+	}
+	if (pending) {
+		struct pollfd pfd = { epfd, POLLIN, 0 };
+		struct timespec ts = { left / 1000000, (left % 1000000) * 1000 };
+		if (left <= 0 || ppoll(&pfd, 1, &ts, NULL) == 0) {
+			while (open_head != NULL && elapsed_us(&open_head->batch_start) >= delay_us)
+				flush_batch(open_head);
+			if (coded && window_count > 0 && elapsed_us(&window_start) >= window_ms * 1000L)
+				close_window();
+			continue;
 		}
-
-
+		timeout = 0;
+	}
+	if ((n = epoll_wait(epfd, events, MAXEVENTS, timeout)) == -1) {
+		if (errno != EINTR)
+			perror("epoll_wait");
+		continue;
+	}
+	for (i=0; i<n; i++) {
+		source_t *src = events[i].data.ptr;
+		if (src->kind == SRC_LISTEN) {
+			int fd = accept(src->fd, NULL, NULL);
+			if (fd == -1)
+				perror("accept");
+			else
+				add_source(fd, SRC_STREAM, src);
+		}
+		else if (src->kind == SRC_STREAM)
+			stream_input(src);
+		else
+			dgram_input(src);
 	}
-	counter++; // this normally overflows
     }
 
     /* 
@@ -159,7 +572,7 @@ int main(void)
      */
 
     freeaddrinfo(servinfo);
-    close(sockfd); close(sockfdout);
+    close(epfd); close(sockfdout);
 
     return 0;
 }
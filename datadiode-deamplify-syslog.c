@@ -22,6 +22,8 @@
  *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
 */   
 
+#define _GNU_SOURCE // sendmmsg()
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -33,16 +35,97 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <stdint.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/un.h>
+#include <time.h>
+#include <fcntl.h>
+#include "fec.h"
+#include "sysframe.h"
 
 // listener port
 #define MYPORT "2514"    // 514 default SYSLOG port requires root, RFC 5424, need to drop privileges and maybe chroot
 
-// destination port for datadiode-deamplify514
+// destination port for datadiode-deamplify514, when no -o is given
 #define SERVERPORT "514"    // the port users will be connecting to, same 514 from RFC 5424
+#define MAXSINKS 16
+#define SINKBATCH 256      // lines per sendmmsg() of a datagram sink
+#define SINKBUF (1 << 20)  // bytes a sink collects before it writes
+#define SYNC_MS 100        // default group commit interval of file sinks
+#define RETRY_MS 1000      // stream sinks reconnect at most this often
+#define BURST 256          // datagrams taken in before the sinks are flushed
 			     
-#define MAXBUFLEN 1024 + sizeof(uint16_t)  // needs jumbo frames for longer lines like 8192+2, set MTU to 9000 on data-diode interfaces
-
-uint16_t counter=65535, prevcounter=0;   // this normally overflows, as it should. we just want to clear duplicate packets on the receiver side
+#define MAXBUFLEN 65536   // largest datagram, the amplifier coalesces lines up to its -m size
+
+/* copies are dropped per source by sequence number: a bitmap remembers the last SEQWINDOW sequence numbers, so copies
+ * that arrive out of order or interleaved are still caught; sequence numbers that leave it unseen are lost */
+#define SEQWINDOW 4096
+#define SOURCES 4096     // sources remembered, the least recently seen one is forgotten for a new one
+
+typedef struct {
+    uint8_t used;
+    uint32_t id;
+    uint64_t seen;             // source_clock when its last datagram came
+    uint64_t base;             // first sequence number seen
+    uint64_t top;              // highest sequence number seen
+    uint64_t bits[SEQWINDOW / 64];   // bit seq % SEQWINDOW for seq in (top - SEQWINDOW, top]
+    uint64_t received, duplicates, late, stale, lost;
+} source_t;
+
+source_t sources[2 * SOURCES];
+int nsources = 0;
+uint64_t source_clock = 0, sources_forgotten = 0;
+volatile sig_atomic_t report = 0;
+
+#define WINDOWS 64       // coded windows decoded at the same time
+
+/* -F ms: coded mode, a window waits at most ms for the repair frames that rebuild its missing lines; data frames are
+ * forwarded whenever they come, the copies are dropped by deliver() */
+typedef struct {
+    uint8_t used, done, gone;  // gone: expired, its lines that were counted lost still count when they come late
+    uint32_t run, id;
+    uint8_t k, r;              // k = 0 until a repair frame told it
+    uint16_t ndata, nrepair;
+    size_t block;              // padded block length from the repair frames
+    uint8_t have[FEC_MAXBLOCKS];
+    uint8_t *blocks[FEC_MAXBLOCKS];
+    struct timespec start;
+} window_t;
+
+int coded = 0, budget_ms = 0;
+window_t windows[WINDOWS];
+uint64_t dgrams_recovered = 0, dgrams_lost = 0, windows_lost = 0;
+
+/* -o: every line goes to every sink. Lines are collected while datagrams keep coming and written when the socket
+ * runs dry or the sink is full: [udp:]host:port and unix:path (datagram, like /dev/log) send SINKBATCH lines per
+ * sendmmsg(), tcp:host:port and unixstream:path keep a non-blocking connection open and write RFC 6587 octet counted
+ * frames, what the collector does not take yet stays in the buffer and lines that do not fit are dropped, so a slow
+ * collector never stalls the receive loop; file:path[,ms] appends lines and makes them durable with one fdatasync()
+ * every ms (group commit) */
+#define SINK_DGRAM 0
+#define SINK_STREAM 1
+#define SINK_FILE 2
+
+typedef struct {
+    int kind, fd;              // fd -1: stream sink not connected
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    char *spec;
+    unsigned char *buf;        // lines (datagram sinks) or bytes waiting to be written
+    size_t len;
+    struct mmsghdr msgs[SINKBATCH];
+    struct iovec iov[SINKBATCH];
+    int queued;                // lines in buf (datagram and file sinks)
+    size_t head;               // stream: bytes at the start of buf left of a frame cut by a short send
+    uint8_t connecting;        // stream: connect() in progress
+    long sync_ms;
+    uint8_t dirty;             // file: written since the last fdatasync()
+    struct timespec synced, retry;
+    uint64_t lines, dropped;
+} sink_t;
+
+sink_t sinks[MAXSINKS];
+int nsinks = 0;
 
 // get sockaddr, IPv4 or IPv6:
 void *get_in_addr(struct sockaddr *sa)
@@ -54,53 +137,610 @@ void *get_in_addr(struct sockaddr *sa)
     return &(((struct sockaddr_in6*)sa)->sin6_addr);
 }
 
-uint16_t uint8_to_uint16(uint8_t high_byte, uint8_t low_byte) {
-    uint16_t result;
-    uint8_t *ptr = (uint8_t *)&result;
-
-    // Store high_byte in the appropriate position based on endianness
-    #if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && defined(__ORDER_LITTLE_ENDIAN__)
-        #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
-            ptr[0] = high_byte;
-            ptr[1] = low_byte;
-        #elif __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-            ptr[0] = low_byte;
-            ptr[1] = high_byte;
-        #else
-            #error "Unknown endianness!"
-        #endif
-    #else
-        // Handle endianness at runtime if compiler-specific macros are not available
-        union {
-            uint16_t u16;
-            uint8_t u8[2];
-        } endian_test = {0x0102};
-        
-        if (endian_test.u8[0] == 0x01) { // Big-endian
-            ptr[0] = high_byte;
-            ptr[1] = low_byte;
-        } else if (endian_test.u8[0] == 0x02) { // Little-endian
-            ptr[0] = low_byte;
-            ptr[1] = high_byte;
-        } else {
-            #error "Unknown endianness!"
-        }
-    #endif
-
-    return result;
-}
-
-int main(void)
-{
-    int sockfd, sockfdout;
+long elapsed_ms(struct timespec *since);
+
+int sink_connect(sink_t *sink)
+{
+    clock_gettime(CLOCK_MONOTONIC, &sink->retry);
+    sink->connecting = 0;
+    if ((sink->fd = socket(sink->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1)
+        return -1;
+    if (connect(sink->fd, (struct sockaddr *)&sink->addr, sink->addr_len) == -1) {
+        if (errno == EINPROGRESS) {
+            sink->connecting = 1;
+            return 0;
+        }
+        fprintf(stderr, "[deamplifier] sink %s: %s, retrying\n", sink->spec, strerror(errno));
+        close(sink->fd);
+        sink->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// bytes of the octet counted frame at p, "<length> <line>"
+size_t frame_length(unsigned char *p)
+{
+    char *end;
+    size_t n = strtoul((char *)p, &end, 10);
+
+    return end - (char *)p + 1 + n;
+}
+
+// as much as the collector takes without blocking, the rest waits in buf for the next call
+void flush_stream(sink_t *sink)
+{
+    size_t done = 0, pos;
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+
+    if (sink->fd == -1 && elapsed_ms(&sink->retry) >= RETRY_MS)
+        sink_connect(sink);
+    if (sink->fd != -1 && sink->connecting) {
+        struct pollfd pfd = { sink->fd, POLLOUT, 0 };
+        if (poll(&pfd, 1, 0) == 0)
+            return;
+        getsockopt(sink->fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+        sink->connecting = 0;
+        if (err != 0) {
+            fprintf(stderr, "[deamplifier] sink %s: %s, retrying\n", sink->spec, strerror(err));
+            close(sink->fd);
+            sink->fd = -1;
+        }
+    }
+    while (sink->fd != -1 && done < sink->len) {
+        ssize_t w = send(sink->fd, sink->buf + done, sink->len - done, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (w == -1 && errno == EINTR)
+            continue;
+        if (w == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (w == -1) {
+            fprintf(stderr, "[deamplifier] sink %s: %s\n", sink->spec, strerror(errno));
+            close(sink->fd);
+            sink->fd = -1;
+            break;
+        }
+        done += w;
+    }
+
+    // the first frame boundary at or after the bytes sent
+    for (pos = sink->head; pos < done; )
+        pos += frame_length(sink->buf + pos);
+    if (sink->fd == -1) {
+        // the collector is down, lines are not held back; a cut frame has to be resynced by the peer
+        sink->dropped += (pos > done);
+        for (; pos < sink->len; pos += frame_length(sink->buf + pos))
+            sink->dropped++;
+        sink->len = sink->head = 0;
+        return;
+    }
+    memmove(sink->buf, sink->buf + done, sink->len - done);
+    sink->len -= done;
+    sink->head = pos - done;
+}
+
+void flush_sink(sink_t *sink)
+{
+    int i, n;
+
+    if (sink->kind == SINK_STREAM) {
+        flush_stream(sink);
+        return;
+    }
+    if (sink->kind == SINK_DGRAM) {
+        for (i=0; i<sink->queued; ) {
+            if ((n = sendmmsg(sink->fd, sink->msgs + i, sink->queued - i, 0)) == -1) {
+                if (errno == EINTR)
+                    continue;
+                perror("talker: sendmmsg");
+                sink->dropped += sink->queued - i;
+                break;
+            }
+            i += n; // a short count is resumed
+        }
+    }
+    else if (sink->len > 0) {
+        size_t done = 0;
+        while (done < sink->len) {
+            ssize_t w = write(sink->fd, sink->buf + done, sink->len - done);
+            if (w == -1 && errno == EINTR)
+                continue;
+            if (w == -1) {
+                fprintf(stderr, "[deamplifier] sink %s: %s\n", sink->spec, strerror(errno));
+                sink->dropped += sink->queued;
+                break;
+            }
+            done += w;
+        }
+        sink->dirty |= (done > 0);
+    }
+    sink->len = 0;
+    sink->queued = 0;
+
+    if (sink->dirty && elapsed_ms(&sink->synced) >= sink->sync_ms) {
+        if (fdatasync(sink->fd) == -1)
+            perror("[deamplifier] fdatasync");
+        sink->dirty = 0;
+        clock_gettime(CLOCK_MONOTONIC, &sink->synced);
+    }
+}
+
+void flush_sinks(void)
+{
+    int i;
+
+    for (i=0; i<nsinks; i++)
+        flush_sink(&sinks[i]);
+}
+
+// how long the receive loop may sleep: until the next group commit of a file sink
+int sink_timeout(void)
+{
+    int i, timeout = -1;
+
+    for (i=0; i<nsinks; i++)
+        if (sinks[i].dirty) {
+            long left = sinks[i].sync_ms - elapsed_ms(&sinks[i].synced);
+            if (left < 0)
+                left = 0;
+            if (timeout == -1 || left < timeout)
+                timeout = left;
+        }
+    return timeout;
+}
+
+void forward(char *line, size_t len)
+{
+    int i;
+
+    for (i=0; i<nsinks; i++) {
+        sink_t *sink = &sinks[i];
+        size_t need = len + 8; // octet count and space, or LF
+
+        if ((sink->kind != SINK_STREAM && sink->queued == SINKBATCH) || sink->len + need > SINKBUF)
+            flush_sink(sink);
+        if (sink->len + need > SINKBUF) { // a stream collector that does not keep up
+            sink->dropped++;
+            continue;
+        }
+        unsigned char *dst = sink->buf + sink->len;
+        if (sink->kind == SINK_DGRAM) {
+            memcpy(dst, line, len);
+            sink->iov[sink->queued].iov_base = dst;
+            sink->iov[sink->queued].iov_len = len;
+            sink->len += len;
+        }
+        else if (sink->kind == SINK_STREAM) {
+            int n = sprintf((char *)dst, "%zu ", len);
+            memcpy(dst + n, line, len);
+            sink->len += n + len;
+        }
+        else {
+            memcpy(dst, line, len);
+            dst[len] = '\n';
+            sink->len += len + 1;
+        }
+        sink->queued++;
+        sink->lines++;
+    }
+}
+
+// [udp:]host:port, tcp:host:port (also [v6-address]:port), unix:path, unixstream:path or file:path[,ms]
+void open_sink(sink_t *sink, char *spec)
+{
+    struct addrinfo hints, *servinfo;
+    char host[256], *port;
+    int rv, i;
+
+    sink->spec = spec;
+    sink->kind = SINK_DGRAM;
+    sink->sync_ms = SYNC_MS;
+    if ((sink->buf = malloc(SINKBUF)) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i=0; i<SINKBATCH; i++) {
+        memset(&sink->msgs[i], 0, sizeof(struct mmsghdr));
+        sink->msgs[i].msg_hdr.msg_name = &sink->addr;
+        sink->msgs[i].msg_hdr.msg_iov = &sink->iov[i];
+        sink->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &sink->synced);
+
+    if (strncmp(spec, "file:", 5) == 0) {
+        char *path = strdup(spec + 5), *comma = strrchr(path, ',');
+        if (comma != NULL) {
+            *comma = 0;
+            sink->sync_ms = atol(comma + 1);
+        }
+        sink->kind = SINK_FILE;
+        if ((sink->fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0640)) == -1) {
+            perror("talker: open");
+            exit(2);
+        }
+        free(path);
+        return;
+    }
+    if (strncmp(spec, "unix:", 5) == 0 || strncmp(spec, "unixstream:", 11) == 0) {
+        struct sockaddr_un *addr = (struct sockaddr_un *)&sink->addr;
+        char *path = strchr(spec, ':') + 1;
+        memset(addr, 0, sizeof(*addr));
+        addr->sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(addr->sun_path)) {
+            fprintf(stderr, "talker: path too long %s\n", spec);
+            exit(1);
+        }
+        strcpy(addr->sun_path, path);
+        sink->addr_len = sizeof(*addr);
+    }
+    else {
+        if (strncmp(spec, "udp:", 4) == 0)
+            spec += 4;
+        else if (strncmp(spec, "tcp:", 4) == 0) {
+            spec += 4;
+            sink->kind = SINK_STREAM;
+        }
+        if ((port = strrchr(spec, ':')) == NULL) {
+            fprintf(stderr, "talker: no port in %s\n", spec);
+            exit(1);
+        }
+        snprintf(host, sizeof(host), "%.*s", (int)(port - spec), spec);
+        if (host[0] == '[') {
+            memmove(host, host + 1, strlen(host));
+            host[strcspn(host, "]")] = 0;
+        }
+        port++;
+
+        memset(&hints, 0, sizeof hints);
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = (sink->kind == SINK_STREAM) ? SOCK_STREAM : SOCK_DGRAM;
+        if ((rv = getaddrinfo(host, port, &hints, &servinfo)) != 0) {
+            fprintf(stderr, "getaddrinfo %s: %s\n", spec, gai_strerror(rv));
+            exit(1);
+        }
+        memcpy(&sink->addr, servinfo->ai_addr, servinfo->ai_addrlen);
+        sink->addr_len = servinfo->ai_addrlen;
+        freeaddrinfo(servinfo);
+    }
+    for (i=0; i<SINKBATCH; i++)
+        sink->msgs[i].msg_hdr.msg_namelen = sink->addr_len;
+
+    if (strncmp(sink->spec, "unixstream:", 11) == 0)
+        sink->kind = SINK_STREAM;
+    if (sink->kind == SINK_STREAM)
+        sink_connect(sink); // retried when lines are written
+    else if ((sink->fd = socket(sink->addr.ss_family, SOCK_DGRAM, 0)) == -1) {
+        perror("talker: socket");
+        exit(2);
+    }
+}
+
+// a datagram of the amplifier holds lines as <length (2)><line>, each goes to syslog on its own
+void forward_lines(unsigned char *lines, size_t len)
+{
+    size_t pos = 0;
+
+    while (pos + 2 <= len) {
+        size_t n = ((size_t)lines[pos] << 8) | lines[pos + 1];
+        if (pos + 2 + n > len) {
+            fprintf(stderr, "[deamplifier] dropped a truncated line of %zu bytes\n", n);
+            return;
+        }
+        forward((char *)lines + pos + 2, n);
+        pos += 2 + n;
+    }
+}
+
+uint32_t source_slot(uint32_t id)
+{
+    return (id * 2654435761u) % (2 * SOURCES);
+}
+
+// linear probing without tombstones: the sources behind the hole move up unless that passes their own slot
+void forget_source(uint32_t i)
+{
+    uint32_t j = i, home;
+
+    for (;;) {
+        j = (j + 1) % (2 * SOURCES);
+        if (!sources[j].used)
+            break;
+        home = source_slot(sources[j].id);
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+            sources[i] = sources[j];
+            i = j;
+        }
+    }
+    memset(&sources[i], 0, sizeof(source_t));
+    nsources--;
+}
+
+source_t *find_source(uint32_t id)
+{
+    uint32_t i = source_slot(id), oldest = 0;
+    int j;
+
+    while (sources[i].used && sources[i].id != id)
+        i = (i + 1) % (2 * SOURCES);
+    if (!sources[i].used) {
+        if (nsources == SOURCES) {
+            // a table full of sources that come and go, the one silent for longest has no copies in flight
+            for (j=0; j<2 * SOURCES; j++)
+                if (sources[j].used && (!sources[oldest].used || sources[j].seen < sources[oldest].seen))
+                    oldest = j;
+            forget_source(oldest);
+            sources_forgotten++;
+            for (i = source_slot(id); sources[i].used; i = (i + 1) % (2 * SOURCES))
+                ;
+        }
+        sources[i].used = 1;
+        sources[i].id = id;
+        nsources++;
+    }
+    sources[i].seen = ++source_clock;
+    return &sources[i];
+}
+
+// 1 the first time seq of the source is seen, 0 for copies and for sequence numbers too old to tell
+int accept_seq(source_t *src, uint64_t seq)
+{
+    uint64_t *word, bit;
+
+    if (src->received == 0 && src->duplicates == 0 && src->stale == 0) {
+        src->base = src->top = seq;
+    }
+    else if (seq > src->top) {
+        // the window slides, sequence numbers that leave it unseen are lost
+        uint64_t q, s;
+        if (seq - src->top >= SEQWINDOW) {
+            for (q = (src->top - src->base >= SEQWINDOW) ? src->top - SEQWINDOW + 1 : src->base; q <= src->top; q++)
+                if (!(src->bits[(q % SEQWINDOW) / 64] & (1ULL << (q % 64))))
+                    src->lost++;
+            src->lost += seq - src->top - SEQWINDOW;    // never inside the window
+            memset(src->bits, 0, sizeof(src->bits));
+        }
+        else
+            for (s = src->top + 1; s <= seq; s++) {
+                word = &src->bits[(s % SEQWINDOW) / 64];
+                bit = 1ULL << (s % 64);
+                if (!(*word & bit) && s >= src->base + SEQWINDOW)   // s - SEQWINDOW leaves
+                    src->lost++;
+                *word &= ~bit;
+            }
+        src->top = seq;
+    }
+    else if (src->top - seq >= SEQWINDOW) {
+        src->stale++;
+        return 0;
+    }
+    else {
+        if (src->bits[(seq % SEQWINDOW) / 64] & (1ULL << (seq % 64))) {
+            src->duplicates++;
+            return 0;
+        }
+        src->late++;
+        if (seq < src->base)
+            src->base = seq;
+    }
+    src->bits[(seq % SEQWINDOW) / 64] |= 1ULL << (seq % 64);
+    src->received++;
+    return 1;
+}
+
+// datagrams not yet seen from their source go to syslog
+void deliver(unsigned char *dgram, size_t len)
+{
+    uint32_t id;
+    uint64_t seq;
+
+    if (sysdgram_parse(&id, &seq, dgram, len) == -1)
+        return;
+    if (accept_seq(find_source(id), seq))
+        forward_lines(dgram + SYSDGRAM_HEADER, len - SYSDGRAM_HEADER);
+}
+
+// SIGUSR1: counters per source; gaps are sequence numbers missing from the window, they may still come
+void print_report(void)
+{
+    int i, j;
+
+    for (i=0; i<2 * SOURCES; i++) {
+        source_t *src = &sources[i];
+        if (!src->used)
+            continue;
+        uint64_t first = (src->top - src->base >= SEQWINDOW) ? src->top - SEQWINDOW + 1 : src->base, seen = 0;
+        for (j=0; j<SEQWINDOW / 64; j++)
+            seen += __builtin_popcountll(src->bits[j]);
+        fprintf(stderr, "[deamplifier] source %08x: next %lu received %lu duplicates %lu late %lu stale %lu gaps %lu lost %lu\n",
+            src->id, src->top + 1, src->received, src->duplicates, src->late, src->stale, src->top - first + 1 - seen, src->lost);
+    }
+    if (sources_forgotten)
+        fprintf(stderr, "[deamplifier] %lu sources forgotten for new ones\n", sources_forgotten);
+    if (coded)
+        fprintf(stderr, "[deamplifier] coded: %lu datagrams rebuilt, %lu lost in %lu windows\n", dgrams_recovered, dgrams_lost, windows_lost);
+    for (i=0; i<nsinks; i++)
+        fprintf(stderr, "[deamplifier] sink %s: %lu lines, %lu dropped\n", sinks[i].spec, sinks[i].lines, sinks[i].dropped);
+}
+
+void on_usr1(int sig)
+{
+    report = 1;
+}
+
+long elapsed_ms(struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+// a window leaves, lines that never arrived nor were rebuilt are counted as lost
+void expire(window_t *w)
+{
+    int i;
+
+    if (w->gone)
+        return;
+    if (w->used && !w->done) {
+        // without a repair frame the window size is not known, the highest data frame seen is a lower bound
+        int k = w->k;
+        if (k == 0)
+            for (i=0; i<FEC_MAXBLOCKS; i++)
+                if (w->have[i])
+                    k = i + 1;
+        if (w->ndata < k) {
+            dgrams_lost += k - w->ndata;
+            windows_lost++;
+            fprintf(stderr, "[deamplifier] window %08x/%u: %d of %d datagrams lost (%lu lost so far)\n", w->run, w->id, k - w->ndata, k, dgrams_lost);
+        }
+        w->k = k;
+    }
+    // the run, id, k and the frames seen stay for the data frames that are still on their way
+    for (i=0; i<FEC_MAXBLOCKS; i++) {
+        free(w->blocks[i]);
+        w->blocks[i] = NULL;
+    }
+    w->used = w->gone = 1;
+}
+
+// once k of the frames are in, the missing datagrams are rebuilt and delivered
+void decode(window_t *w)
+{
+    int i;
+
+    if (w->done || w->k == 0 || w->ndata + w->nrepair < w->k)
+        return;
+    if (w->ndata < w->k) {
+        for (i=0; i<w->k; i++) {
+            uint8_t *b = realloc(w->blocks[i], w->block);
+            if (b == NULL) {
+                perror("realloc");
+                return;
+            }
+            // zero padded like on the amplifier side
+            size_t used = w->have[i] ? (((size_t)b[0] << 8) | b[1]) + 2 : 0;
+            if (used < w->block)
+                memset(b + used, 0, w->block - used);
+            w->blocks[i] = b;
+        }
+        if (fec_decode(w->k, w->r, w->blocks, w->have, w->block) == -1)
+            return;
+        for (i=0; i<w->k; i++) {
+            if (w->have[i])
+                continue;
+            size_t len = ((size_t)w->blocks[i][0] << 8) | w->blocks[i][1];
+            if (len + 2 <= w->block)
+                deliver(w->blocks[i] + 2, len);
+            dgrams_recovered++;
+        }
+    }
+    w->done = 1;
+}
+
+void receive_frame(unsigned char *data, size_t len)
+{
+    sysframe_t f;
+    int i;
+
+    if (sysframe_parse(&f, data, len) == -1) {
+        fprintf(stderr, "[deamplifier] dropped a malformed frame of %zu bytes\n", len);
+        return;
+    }
+    unsigned char *payload = data + SYSFRAME_HEADER;
+    // lines go out at once, late or not, the decoder only needs them for the lines that are missing
+    if (f.type == SYSFRAME_DATA)
+        deliver(payload, f.length);
+
+    /* a slot holds one window of a run: a newer window of the same run takes it over, frames of an older one
+     * (the window counter compared as a serial number) have nothing left to rebuild; another run is a restarted
+     * amplifier and takes it over as well */
+    window_t *w = &windows[f.window % WINDOWS];
+    if (w->used && w->run == f.run && (int32_t)(f.window - w->id) < 0)
+        return;
+    if (w->used && (w->run != f.run || w->id != f.window)) {
+        expire(w);
+        w->used = 0;
+    }
+    if (!w->used) {
+        memset(w, 0, sizeof(window_t));
+        w->used = 1;
+        w->run = f.run;
+        w->id = f.window;
+        clock_gettime(CLOCK_MONOTONIC, &w->start);
+    }
+    if (w->gone) {
+        // counted lost when the window expired, it came after all
+        if (f.type == SYSFRAME_DATA && !w->have[f.index] && f.index < w->k) {
+            w->have[f.index] = 1;
+            dgrams_lost--;
+        }
+        return;
+    }
+    if (w->done || w->have[f.index]) // duplicate, or nothing left to rebuild
+        return;
+
+    if (f.type == SYSFRAME_DATA) {
+        // kept as a block for the decoder, padded when the block length is known
+        if ((w->blocks[f.index] = malloc(f.length + 2)) == NULL) {
+            perror("malloc");
+            return;
+        }
+        w->blocks[f.index][0] = f.length >> 8;
+        w->blocks[f.index][1] = f.length;
+        memcpy(w->blocks[f.index] + 2, payload, f.length);
+        w->ndata++;
+    }
+    else {
+        if (w->k == 0) {
+            w->k = f.k;
+            w->r = f.r;
+            w->block = f.length;
+        }
+        if (f.k != w->k || f.r != w->r || f.length != w->block)
+            return;
+        if ((w->blocks[f.index] = malloc(f.length)) == NULL) {
+            perror("malloc");
+            return;
+        }
+        memcpy(w->blocks[f.index], payload, f.length);
+        w->nrepair++;
+    }
+    w->have[f.index] = 1;
+    // data frames past the window size are not from this window
+    if (w->k != 0)
+        for (i=w->k + w->r; i<FEC_MAXBLOCKS; i++)
+            w->have[i] = 0;
+    decode(w);
+}
+
+int main(int argc, char *argv[])
+{
+    int sockfd, opt, i, n;
     struct addrinfo hints, *servinfo, *p;
     int rv;
-    int numbytes,len;
+    int numbytes;
     struct sockaddr_storage their_addr;
     char buf[MAXBUFLEN];
     socklen_t addr_len;
 //    char s[INET6_ADDRSTRLEN];
 
+    char *sink_spec[MAXSINKS];
+
+    while ((opt = getopt(argc, argv, "F:o:")) != -1) {
+        if (opt == 'F' && (budget_ms = atoi(optarg)) > 0)
+            coded = 1;
+        else if (opt == 'o' && nsinks < MAXSINKS)
+            sink_spec[nsinks++] = optarg;
+        else {
+            fprintf(stderr, "usage: %s [-F ms] [-o sink]...\n", argv[0]);
+            fprintf(stderr, "       -o send every line to [udp:]host:port or unix:path (batched datagrams), tcp:host:port or unixstream:path\n");
+            fprintf(stderr, "          (RFC 6587 octet counting) or file:path[,ms] (fdatasync every ms, default %d), repeatable\n", SYNC_MS);
+            fprintf(stderr, "          (default 127.0.0.1:%s)\n", SERVERPORT);
+            fprintf(stderr, "       -F coded frames of datadiode-amplify-syslog -F, missing lines are rebuilt for at most ms\n");
+            return 1;
+        }
+    }
+
     memset(&hints, 0, sizeof hints);
     hints.ai_family = AF_INET6; // set to AF_INET6 to use IPv6
     hints.ai_socktype = SOCK_DGRAM;
@@ -138,47 +778,56 @@ int main(void)
     printf("listener: waiting to recvfrom...\n");
     addr_len = sizeof their_addr;
 
-    memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_INET; // set to AF_INET6 to use IPv6, syslog 514 is usually on IPv4
-    hints.ai_socktype = SOCK_DGRAM;
-
-    if ((rv = getaddrinfo("localhost", SERVERPORT, &hints, &servinfo)) != 0) {
-        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(rv));
-        return 1;
-    }
-
-    // loop through all the results and make a socket
-    for(p = servinfo; p != NULL; p = p->ai_next) {
-        if ((sockfdout = socket(p->ai_family, p->ai_socktype,
-                p->ai_protocol)) == -1) {
-            perror("talker: socket");
-            continue;
-        }
-
-        break;
-    }
+    // syslog 514 is usually on IPv4
+    if (nsinks == 0)
+        sink_spec[nsinks++] = "127.0.0.1:" SERVERPORT;
+    for (i=0; i<nsinks; i++)
+        open_sink(&sinks[i], sink_spec[i]);
 
-    if (p == NULL) {
-        fprintf(stderr, "talker: failed to create socket\n");
-        return 2;
-    }
+    // the report is printed by the loops below, the signal interrupts their wait
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_usr1;
+    sigaction(SIGUSR1, &sa, NULL);
 
-    prevcounter = 65535;
-    char *ptr = buf + sizeof(uint16_t);
+    struct pollfd pfds[1 + MAXSINKS];
     while (1) {  // infinite loop, in UDP packets may be lost so this is preferred 
-	if ((numbytes = recvfrom(sockfd, buf, MAXBUFLEN-1, 0, 
-	    (struct sockaddr *)&their_addr, &addr_len)) == -1) {
-		perror("recvfrom");
+	if (report) {
+		print_report();
+		report = 0;
 	}
-	buf[numbytes] = '\0';
-	len = numbytes;
-	counter=uint8_to_uint16((uint8_t) buf[0], (uint8_t) buf[1]);
-
-	if (counter != prevcounter) { // skip duplicate (amplified) lines
-		if ((numbytes = sendto(sockfdout, ptr, len-sizeof(uint16_t), 0, p->ai_addr, p->ai_addrlen)) == -1) { // send to syslog
-       			perror("talker: sendto");
+	// take in what is queued, then write it to the sinks in batches
+	for (n=0; n<BURST; n++) {
+		if ((numbytes = recvfrom(sockfd, buf, MAXBUFLEN, MSG_DONTWAIT,
+		    (struct sockaddr *)&their_addr, &addr_len)) == -1) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				perror("recvfrom");
+			break;
 		}
-		prevcounter = counter;
+		if (coded)
+			receive_frame((unsigned char *)buf, numbytes);
+		else
+			deliver((unsigned char *)buf, numbytes); // skip duplicate (amplified) datagrams, send to syslog
+	}
+	if (coded) // windows are given up after the latency budget
+		for (i=0; i<WINDOWS; i++)
+			if (windows[i].used && !windows[i].gone && elapsed_ms(&windows[i].start) > budget_ms)
+				expire(&windows[i]);
+	flush_sinks();
+	if (n < BURST) {
+		int timeout = sink_timeout();
+		if (coded && (timeout == -1 || timeout > 10))
+			timeout = 10;
+		// stream sinks with bytes left wake the loop when the collector takes more
+		int npfds = 1;
+		pfds[0].fd = sockfd;
+		pfds[0].events = POLLIN;
+		for (i=0; i<nsinks; i++)
+			if (sinks[i].kind == SINK_STREAM && sinks[i].fd != -1 && sinks[i].len > 0) {
+				pfds[npfds].fd = sinks[i].fd;
+				pfds[npfds++].events = POLLOUT;
+			}
+		poll(pfds, npfds, timeout);
 	}
     }
 
@@ -187,7 +836,7 @@ int main(void)
      */
 
     freeaddrinfo(servinfo);
-    close(sockfd); close(sockfdout);
+    close(sockfd);
 
     return 0;
 }
@@ -21,11 +21,13 @@
  *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
 */ 
 
+#define _GNU_SOURCE
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <string.h>
 #include <stdint.h>
 
@@ -36,8 +38,12 @@
 
 #include "slice_queue.h"
 #include "fountain.h"
-#define SEED 777		
+#include "protocol.h"
+#include "bundle.h"
+#include "compress.h"
+#include "delta.h"
 uint8_t XOR_GROUP_SIZE = 4; 
+uint32_t CHUNK_KEEP = DELTA_KEEP; // -k: days an unused chunk stays in the delta store
 
 #define FILEIDLEN 100
 #define TOTALLEN 4
@@ -45,7 +51,7 @@ uint8_t XOR_GROUP_SIZE = 4;
 #define DATALEN 1364 
 #define MAGICNUMBER 42
 
-char paths[5][256];
+char paths[6][256];
 char path[256];
 
 int open_file(char *path) {
@@ -66,40 +72,6 @@ void close_file(int fd) {
 	}
 }
 
-// reconstruct randomized indices for xor and the inverse array
-void prepare_fountain(uint32_t **index, uint32_t **lookup, uint32_t slices) {
-	// configure fountain seed
-	seed(SEED);
-	
-	// prepare indices
-	*index = (uint32_t *)malloc(slices * sizeof(uint32_t));
-	if(*index == NULL) {
-		perror("[recovery] prepare_fountain failed to allocate\n");
-		exit(3);
-	}
-	
-	*lookup = (uint32_t *)malloc(slices * sizeof(uint32_t));
-	if(*lookup == NULL) {
-		perror("[recovery] prepare_fountain failed to allocate\n");
-		exit(4);
-	}
-	
-	for (uint32_t i=0; i<slices; i++) {
-		*(*index + i) = i;
-		*(*lookup + i) = i;
-	}
-	
-	// shuffle ordered array of slices and construct inverse array
-	indexed_shuffle32(*index, *lookup, slices);
-
-	#ifdef DEBUG
-		printf("Fountain shuffle:\n");
-		printlineArray32(*index, slices);
-		printf("Fountain lookup:\n");
-		printlineArray32(*lookup, slices);
-	#endif
-}
-
 // retrieve checksum from the checksum file
 unsigned char *get_checksum(int fd) {
 
@@ -151,6 +123,59 @@ void extract_checksum_info(char *path, unsigned char **checksum, uint32_t *fsize
 	close_file(checkfd);
 }
 
+// read the transfer descriptor, -1 when the sender did not send one (yet)
+int read_meta(char *path, meta_t *meta) {
+	if(access(path, F_OK) != 0)
+		return -1;
+
+	int metafd = open_file(path);
+	unsigned char buf[DATALEN];
+	lseek(metafd, FILEIDLEN + TOTALLEN, SEEK_SET);
+	if(read(metafd, buf, DATALEN) < METALEN) {
+		perror("[recovery] read transfer descriptor failed");
+		exit(18);
+	}
+	close_file(metafd);
+
+	return meta_parse(meta, buf);
+}
+
+// place of a spool file sent on its own, -1 when the descriptor does not carry one
+int read_place(char *path, uint32_t *mode, uint64_t *mtime, char *name) {
+	unsigned char buf[DATALEN];
+	meta_t meta;
+
+	int metafd = open_file(path);
+	lseek(metafd, FILEIDLEN + TOTALLEN, SEEK_SET);
+	if(read(metafd, buf, DATALEN) != DATALEN) {
+		perror("[recovery] read transfer descriptor failed");
+		exit(18);
+	}
+	close_file(metafd);
+
+	if(meta_parse(&meta, buf) == -1 || !(meta.flags & META_SPOOL))
+		return -1;
+	return spool_parse(buf, mode, mtime, name);
+}
+
+// the transfer descriptor, when the sender sent one, overrides the xor group size from the command line
+// and gives the source block size and the 64-bit file size
+void extract_meta_info(char *path, uint32_t *window, uint64_t *fsize) {
+	if(access(path, F_OK) != 0)
+		return;
+
+	meta_t meta;
+	if(read_meta(path, &meta) == -1) {
+		fprintf(stderr, "[recovery] unknown transfer descriptor, keeping xor size %u\n", XOR_GROUP_SIZE);
+		return;
+	}
+	if(meta.xor_group_size != XOR_GROUP_SIZE)
+		fprintf(stderr, "[INFO] sender used xor size %u\n", meta.xor_group_size);
+	XOR_GROUP_SIZE = meta.xor_group_size;
+	*window = meta.window;
+	*fsize = meta.file_size;
+}
+
 // keep track of how many times a xored packet was unxored
 unsigned char *build_remainder(uint32_t slices) {
 	unsigned char *remaining = (unsigned char *)malloc(slices * sizeof(unsigned char));
@@ -177,16 +202,16 @@ void unxor_from_checksum(unsigned char *toberemoved, unsigned char* buf) {
 }
 
 // given a clear data slice, find all xor groups it is part of, then un-xor and update files
-void find_and_unxor_from_xor_groups(int xorfd, int slxorfd, unsigned char *remaining, uint32_t slices, uint32_t *lookup, 
+// slice and group ids are local to the source block starting at slice base
+void find_and_unxor_from_xor_groups(int xorfd, int slxorfd, unsigned char *remaining, uint32_t slices, uint32_t base, uint32_t *lookup, 
 	uint32_t clear_index, unsigned char *clear_slice, uint32_t *slice_index) {
 	
 	// locate clear slice index in randomized array
 	uint32_t pos = lookup[clear_index];
 				
 	// find xored packet indexes in which clear packet was part of
-	slice_index[0] = pos;
-	for(uint32_t i=1; i<XOR_GROUP_SIZE; i++) {
-		slice_index[i] = (pos < i) ? (slices + pos - i) : (pos - i);
+	for(uint32_t i=0; i<XOR_GROUP_SIZE; i++) {
+		slice_index[i] = fountain_group(pos, slices, i);
 	}
 	#ifdef DEBUG
 		printf("Removing clear packet ID: %d, from grouping %d, %d, %d, %d\n", i, slice_index[0], slice_index[1], slice_index[2], slice_index[3]);
@@ -194,20 +219,20 @@ void find_and_unxor_from_xor_groups(int xorfd, int slxorfd, unsigned char *remai
 				
 	// check if xored packet was stored; if yes -> unxor
 	unsigned char store = 0;
-	uint32_t offset = 0;
-	uint32_t position;
+	off_t offset = 0;
+	off_t position;
 	unsigned char buf[DATALEN];
 	
 	// for each xor group, un-xor the current clear data
 	for(int k=0; k<XOR_GROUP_SIZE; k++) {
-		offset = slice_index[k]; 
+		offset = (off_t)base + slice_index[k]; 
 		lseek(slxorfd, offset, SEEK_SET);
 		if(read(slxorfd, &store, 1) == 1 && store == MAGICNUMBER) {
 			#ifdef DEBUG
 				printf("Group xor ID: %d found in xor file\n", slice_index[k]);
 			#endif
 
-			position = slice_index[k] * DATALEN;
+			position = offset * DATALEN;
 			lseek(xorfd, position, SEEK_SET);
 			if(read(xorfd, buf, DATALEN) != DATALEN) {
 				perror("[recovery] read failed for xor remove");
@@ -231,19 +256,19 @@ void find_and_unxor_from_xor_groups(int xorfd, int slxorfd, unsigned char *remai
 
 // load all fresh clear slices and un-xor them from available xor groups
 void unxor_clears_from_xor_file(int clearfd, int xorfd, int slclearfd, int slxorfd, unsigned char *checksum, unsigned char *remaining, 
-	uint32_t slices, uint32_t *lookup) {
+	uint32_t slices, uint32_t base, uint32_t *lookup) {
 	unsigned char clear_slice[DATALEN];
 	uint32_t slice_index[XOR_GROUP_SIZE];
 	unsigned char store = 0;
-	uint32_t offset_clear = 0;
+	off_t offset_clear = 0;
 
 	// unxor clear packets from xored packets
 	for(uint32_t clear_index=0; clear_index<slices; clear_index++) {
 		
-		lseek(slclearfd, clear_index, SEEK_SET);
+		lseek(slclearfd, (off_t)base + clear_index, SEEK_SET);
 		if(read(slclearfd, &store, 1) == 1 && store == MAGICNUMBER) { // slice present in clear
 			// get slice in clear
-			offset_clear = clear_index * DATALEN;
+			offset_clear = ((off_t)base + clear_index) * DATALEN;
 			lseek(clearfd, offset_clear, SEEK_SET);
 			int n = read(clearfd, clear_slice, DATALEN);
 			if(n<DATALEN) {
@@ -259,7 +284,7 @@ void unxor_clears_from_xor_file(int clearfd, int xorfd, int slclearfd, int slxor
 			unxor_from_checksum(clear_slice, checksum);
 			
 			// remove from xored slices stored in the xor file
-			find_and_unxor_from_xor_groups(xorfd, slxorfd, remaining, slices, lookup, clear_index, clear_slice, slice_index);
+			find_and_unxor_from_xor_groups(xorfd, slxorfd, remaining, slices, base, lookup, clear_index, clear_slice, slice_index);
 		}
 		else
 		{
@@ -334,8 +359,8 @@ void log_after_first_round(int slclearfd, int slxorfd, uint32_t slices, unsigned
 }
 
 // perform first layer of recovery: from xor groups with 1 component left, retrieve clear
-void recovery_layer1(int clearfd, int xorfd, int slclearfd, int slxorfd, uint32_t slices, unsigned char *checksum, unsigned char *remaining, 
-	uint32_t *index, uint32_t *lookup) {
+void recovery_layer1(int clearfd, int xorfd, int slclearfd, int slxorfd, uint32_t slices, uint32_t base, unsigned char *checksum, 
+	unsigned char *remaining, uint32_t *index, uint32_t *lookup) {
 	
 	uint32_t components[XOR_GROUP_SIZE];
 	unsigned char data_slice[DATALEN];
@@ -355,9 +380,8 @@ void recovery_layer1(int clearfd, int xorfd, int slclearfd, int slxorfd, uint32_
 		qnode = popNode(que);
 
 		// retrieve group components
-		components[0] = index[qnode->value];
 		for(uint32_t j=0; j<XOR_GROUP_SIZE; j++) {
-			components[j] = index[((qnode->value)+j) % slices];
+			components[j] = fountain_member(index, slices, qnode->value, j);
 		}
 
 		#ifdef DEBUG
@@ -369,16 +393,16 @@ void recovery_layer1(int clearfd, int xorfd, int slclearfd, int slxorfd, uint32_
 		#endif
 				
 		for(uint32_t j=0; j<XOR_GROUP_SIZE; j++) {
-			lseek(slclearfd, components[j], SEEK_SET);
+			lseek(slclearfd, (off_t)base + components[j], SEEK_SET);
 					
 			if(read(slclearfd, &store, 1) == 1 && store != MAGICNUMBER) {
 				#ifdef DEBUG
 					printf("Missing element found: %d\n", components[j]);
 				#endif
 						
-				lseek(clearfd, components[j] * DATALEN, SEEK_SET);
-				lseek(xorfd, (qnode->value) * DATALEN, SEEK_SET);
-				lseek(slclearfd, components[j], SEEK_SET);
+				lseek(clearfd, ((off_t)base + components[j]) * DATALEN, SEEK_SET);
+				lseek(xorfd, ((off_t)base + qnode->value) * DATALEN, SEEK_SET);
+				lseek(slclearfd, (off_t)base + components[j], SEEK_SET);
 						
 				if(read(xorfd, data_slice, DATALEN) < DATALEN) {
 					perror("[recovery] read failed for xor load");
@@ -398,7 +422,7 @@ void recovery_layer1(int clearfd, int xorfd, int slclearfd, int slxorfd, uint32_
 				unxor_from_checksum(data_slice, checksum);
 				
 				// remove from xored slices
-				find_and_unxor_from_xor_groups(xorfd, slxorfd, remaining, slices, lookup, components[j], data_slice, slice_index);
+				find_and_unxor_from_xor_groups(xorfd, slxorfd, remaining, slices, base, lookup, components[j], data_slice, slice_index);
 
 				// update queue
 				for(uint32_t k=0; k<XOR_GROUP_SIZE; k++) {
@@ -415,13 +439,118 @@ void recovery_layer1(int clearfd, int xorfd, int slclearfd, int slxorfd, uint32_
 	free(que);
 }
 
+// recover one source block, its xor groups never leave it
+void recover_block(int clearfd, int xorfd, int slclearfd, int slxorfd, unsigned char *checksum, uint32_t base, uint32_t len, uint32_t b) {
+	// prepare indices for fountain codes
+	uint32_t *index = NULL;
+	uint32_t *lookup = NULL;
+	prepare_fountain(&index, &lookup, len, b);
+		
+	// keep track of how many times a xored packet was unxored
+	unsigned char *remaining = build_remainder(len);
+	
+	// unxor clear packets from xored packets
+	unxor_clears_from_xor_file(clearfd, xorfd, slclearfd, slxorfd, checksum, remaining, len, base, lookup);
+	
+	#ifdef DEBUG
+		log_after_first_round(slclearfd, slxorfd, len, remaining);
+	#endif
+	
+	// try to recover clear slices from single xored slices
+	recovery_layer1(clearfd, xorfd, slclearfd, slxorfd, len, base, checksum, remaining, index, lookup);
+
+	free(remaining);
+	free(index);
+	free(lookup);
+}
+
 // will do at some point
 int check_the_checksum(char paths[][256]){
 	return 1;
 }
 
+// replace a compressed object by its content
+void expand(char *path, uint8_t codec) {
+	char tmppath[300];
+	snprintf(tmppath, sizeof(tmppath), "%s.expand", path);
+
+	int in = open(path, O_RDONLY);
+	int out = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if(in == -1 || out == -1) {
+		perror("[recovery] failed to open for decompression");
+		exit(18);
+	}
+	if(decompress_file(in, out) == -1) {
+		fprintf(stderr, "[recovery] %s failed to decompress (%s), keeping the compressed object\n", path, codec_name(codec));
+		close(in);
+		close(out);
+		unlink(tmppath);
+		return;
+	}
+	close(in);
+	close(out);
+	if(rename(tmppath, path)) {
+		perror("[recovery] failed to rename decompressed file");
+		exit(18);
+	}
+	fprintf(stderr, "[INFO] decompressed %s (%s)\n", path, codec_name(codec));
+}
+
+// replace a delta object by the file, chunks come from the object and the .chunks store next to it
+void rebuild(char *path) {
+	char tmppath[300], store[300], keeppath[300];
+	snprintf(tmppath, sizeof(tmppath), "%s.rebuild", path);
+	snprintf(keeppath, sizeof(keeppath), "%s.delta", path);
+	strcpy(store, path);
+	strcpy(strrchr(store, '/') + 1, ".chunks");
+
+	int in = open(path, O_RDONLY);
+	int out = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if(in == -1 || out == -1) {
+		perror("[recovery] failed to open for rebuild");
+		exit(18);
+	}
+	if(delta_rebuild(in, out, store) == -1) {
+		if(errno == ENOENT)
+			fprintf(stderr, "[recovery] %s refers to a chunk that never arrived, keeping the delta object as %s\n", path, keeppath);
+		else
+			fprintf(stderr, "[recovery] %s failed to rebuild, keeping the delta object as %s\n", path, keeppath);
+		close(in);
+		close(out);
+		unlink(tmppath);
+		if(rename(path, keeppath))
+			perror("[recovery] failed to rename delta object");
+		return;
+	}
+	close(in);
+	close(out);
+	if(rename(tmppath, path)) {
+		perror("[recovery] failed to rename rebuilt file");
+		exit(18);
+	}
+	fprintf(stderr, "[INFO] rebuilt %s from its chunks\n", path);
+
+	int removed = delta_prune(store, CHUNK_KEEP);
+	if(removed == -1)
+		perror("[recovery] failed to prune the chunk store");
+	else if(removed > 0)
+		fprintf(stderr, "[INFO] pruned %d unused chunks from %s\n", removed, store);
+}
+
 void clean_tempfiles(char paths[][256], char *newpath) {
 	char inotifypath[256];
+	char place[SPOOL_NAMELEN + 1];
+	meta_t meta;
+	uint8_t codec = CODEC_NONE, delta = 0, spool = 0;
+	uint32_t mode = 0;
+	uint64_t mtime = 0;
+
+	// the descriptor goes away below, keep the codec and delta flag and the place of a spool file
+	if(access(paths[5], F_OK) == 0 && read_meta(paths[5], &meta) == 0) {
+		codec = (meta.flags & META_CODEC_MASK) >> META_CODEC_SHIFT;
+		delta = (meta.flags & META_DELTA) != 0;
+		spool = (read_place(paths[5], &mode, &mtime, place) == 0);
+	}
 
 	// clear-data
 	if(rename(paths[0], newpath)) {
@@ -447,10 +576,45 @@ void clean_tempfiles(char paths[][256], char *newpath) {
 		perror("[recovery] failed to delete temporary xor slice marker file");
 	}
 
+	if(access(paths[5], F_OK) == 0 && unlink(paths[5])) {
+		perror("[recovery] failed to delete temporary transfer descriptor file");
+	}
+
 	snprintf(inotifypath, 255, "%.100s.finished", newpath);
 	if(unlink(inotifypath)) {
 		perror("[recovery] failed to delete temporary inotify file");
 	} else fprintf(stderr, "Deleted |%s|\n", inotifypath);
+
+	if(codec != CODEC_NONE)
+		expand(newpath, codec);
+	if(delta)
+		rebuild(newpath);
+
+	// a spool file too large for a bundle goes to its relative name, like the members of a bundle
+	if(spool) {
+		char folder[256];
+		strcpy(folder, newpath);
+		*strrchr(folder, '/') = 0;
+		if(bundle_place(newpath, folder, place, mode, mtime) == 0)
+			fprintf(stderr, "[INFO] placed %s as %s\n", newpath, place);
+		else
+			fprintf(stderr, "[recovery] failed to place %s as %s, keeping it\n", newpath, place);
+	}
+
+	// bundles of small files are replaced by their content
+	if(bundle_check(newpath)) {
+		char folder[256];
+		strcpy(folder, newpath);
+		*strrchr(folder, '/') = 0;
+		int count = bundle_unpack(newpath, folder);
+		if(count == -1)
+			fprintf(stderr, "[recovery] failed to unpack bundle %s, keeping it\n", newpath);
+		else {
+			fprintf(stderr, "[INFO] unpacked %d files from %s\n", count, newpath);
+			if(unlink(newpath))
+				perror("[recovery] failed to delete unpacked bundle");
+		}
+	}
 }
 
 uint8_t recover(char paths[][256]) {
@@ -462,8 +626,11 @@ uint8_t recover(char paths[][256]) {
 	
 	// extract checksum and file size
 	unsigned char *checksum = NULL;
-	uint32_t file_size = 0;
-	extract_checksum_info(paths[2], &checksum, &file_size);
+	uint32_t header_size = 0;
+	uint32_t window = 0;
+	extract_checksum_info(paths[2], &checksum, &header_size);
+	uint64_t file_size = header_size;
+	extract_meta_info(paths[5], &window, &file_size);
 	
 	// start processing slices
 	uint32_t slices = (file_size + (DATALEN-1)) / DATALEN;
@@ -495,23 +662,13 @@ uint8_t recover(char paths[][256]) {
 	//	return 1;
 	}
 	
-	// prepare indices for fountain codes
-	uint32_t *index = NULL;
-	uint32_t *lookup = NULL;
-	prepare_fountain(&index, &lookup, slices);
-		
-	// keep track of how many times a xored packet was unxored
-	unsigned char *remaining = build_remainder(slices);
-	
-	// unxor clear packets from xored packets
-	unxor_clears_from_xor_file(clearfd, xorfd, slclearfd, slxorfd, checksum, remaining, slices, lookup);
-	
-	#ifdef DEBUG
-		log_after_first_round(slclearfd, slxorfd, slices, remaining);
-	#endif
-	
-	// try to recover clear slices from single xored slices
-	recovery_layer1(clearfd, xorfd, slclearfd, slxorfd, slices, checksum, remaining, index, lookup);
+	// source blocks are independent codes, recover them one at a time
+	uint32_t blocks = block_count(slices, window);
+	for(uint32_t b=0; b<blocks; b++) {
+		uint32_t base, len;
+		block_range(slices, window, b, &base, &len);
+		recover_block(clearfd, xorfd, slclearfd, slxorfd, checksum, base, len, b);
+	}
 	
 	uint8_t don = log_at_zero_round(slclearfd, slxorfd, slices, paths[0]);
 
@@ -528,28 +685,179 @@ uint8_t recover(char paths[][256]) {
 	close_file(slxorfd);
 
 	free(checksum);
-	free(remaining);
-	free(index);
-	free(lookup);
 	
 	return don;
 }
 
+// recover a source block of a stream and write it to out, then release its space in the temporary files
+uint64_t stream_block(char paths[][256], int outfd, unsigned char *checksum, uint32_t base, uint32_t len, uint32_t b, uint64_t limit) {
+	int clearfd = open_file(paths[0]);
+	int xorfd = open_file(paths[1]);
+	int slclearfd = open_file(paths[3]);
+	int slxorfd = open_file(paths[4]);
+
+	recover_block(clearfd, xorfd, slclearfd, slxorfd, checksum, base, len, b);
+
+	// a lost slice can not be taken back from a pipe, it goes out as zeroes
+	unsigned char *store = (unsigned char *)malloc(len);
+	if(store == NULL) {
+		perror("[recovery] stream_block failed to allocate\n");
+		exit(23);
+	}
+	uint32_t missing = 0;
+	if(pread(slclearfd, store, len, base) < len)
+		missing = len;
+	else for(uint32_t i=0; i<len; i++)
+		missing += (store[i] != MAGICNUMBER);
+	free(store);
+	if(missing)
+		fprintf(stderr, "[recovery] block %u: %u slices could not be recovered\n", b, missing);
+
+	unsigned char buf[DATALEN];
+	uint64_t written = 0;
+	off_t offset = (off_t)base * DATALEN;
+	for(uint32_t i=0; i<len && written<limit; i++) {
+		uint32_t n = (limit - written < DATALEN) ? limit - written : DATALEN;
+		memset(buf, 0, DATALEN);
+		if(pread(clearfd, buf, n, offset + (off_t)i * DATALEN) < 0) {
+			perror("[recovery] read failed for stream block");
+			exit(19);
+		}
+		for(uint32_t done=0; done<n; ) {
+			ssize_t w = write(outfd, buf + done, n - done);
+			if(w < 0) {
+				perror("[recovery] write failed for stream");
+				exit(20);
+			}
+			done += w;
+		}
+		written += n;
+	}
+
+	// data is out, keep the temporary files sparse (best effort, not every file system can punch holes)
+	fallocate(clearfd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, (off_t)len * DATALEN);
+	fallocate(xorfd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, (off_t)len * DATALEN);
+
+	close_file(clearfd);
+	close_file(xorfd);
+	close_file(slclearfd);
+	close_file(slxorfd);
+
+	return written;
+}
+
+// follow a transfer while it arrives and write it in order to out ("-" is stdout), every source block
+// is recovered once the sender finished the block after it; the last block waits for the EOF packets
+uint8_t follow(char paths[][256], char *out) {
+	int outfd = -1;
+	if(strcmp(out, "-") == 0) {
+		// keep stdout for the data, the statistics go to stderr
+		outfd = dup(STDOUT_FILENO);
+		dup2(STDERR_FILENO, STDOUT_FILENO);
+	}
+	else
+		outfd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if(outfd == -1) {
+		perror("[recovery] open failed for output");
+		exit(21);
+	}
+
+	char inotifypath[256];
+	snprintf(inotifypath, 255, "%.100s.finished", path);
+
+	// the checksum is only sent at the end of a stream, recovery does not need it
+	unsigned char *checksum = (unsigned char *)calloc(DATALEN, sizeof(char));
+	if(checksum == NULL) {
+		perror("[recovery] follow failed to allocate\n");
+		exit(22);
+	}
+
+	meta_t meta;
+	uint32_t next = 0;
+	uint64_t written = 0;
+	while(access(inotifypath, F_OK) != 0) {
+		if(read_meta(paths[5], &meta) == 0 && meta.window > 0 &&
+			meta.file_size >= ((uint64_t)next + 2) * meta.window * DATALEN) {
+			XOR_GROUP_SIZE = meta.xor_group_size;
+			written += stream_block(paths, outfd, checksum, next * meta.window, meta.window, next, UINT64_MAX);
+			next++;
+		}
+		else
+			usleep(100000);
+	}
+	free(checksum);
+
+	// the rest of the transfer, now with its final size
+	uint32_t header_size = 0;
+	uint32_t window = 0;
+	extract_checksum_info(paths[2], &checksum, &header_size);
+	uint64_t file_size = header_size;
+	extract_meta_info(paths[5], &window, &file_size);
+
+	uint32_t slices = (file_size + (DATALEN-1)) / DATALEN;
+	if(slices < XOR_GROUP_SIZE)
+		slices = XOR_GROUP_SIZE;
+	uint32_t blocks = block_count(slices, window);
+	for(uint32_t b=next; b<blocks; b++) {
+		uint32_t base, len;
+		block_range(slices, window, b, &base, &len);
+		written += stream_block(paths, outfd, checksum, base, len, b, file_size - written);
+	}
+	free(checksum);
+
+	close_file(outfd);
+
+	int slclearfd = open_file(paths[3]);
+	int slxorfd = open_file(paths[4]);
+	uint8_t don = log_at_zero_round(slclearfd, slxorfd, slices, paths[0]);
+	close_file(slclearfd);
+	close_file(slxorfd);
+
+	// the data went to out, an empty file marks the transfer as received
+	int clearfd = open_file(paths[0]);
+	if(don && ftruncate(clearfd, 0) == -1) {
+		perror("[recovery] truncating failed");
+		exit(16);
+	}
+	close_file(clearfd);
+
+	return don;
+}
+
 int main(int argc, char *argv[]) {
 	
 	// process data from outside
-	if(argc != 4) {
-		fprintf(stderr, "[usage] <program> <input-folder> <file-basename> <xor-size>\n");
+	char *out = NULL;
+	int opt;
+	while((opt = getopt(argc, argv, "o:k:")) != -1) {
+		switch(opt) {
+		case 'o':
+			out = optarg;
+			break;
+		case 'k':
+			CHUNK_KEEP = atoi(optarg);
+			break;
+		default:
+			argc = 0;
+			break;
+		}
+	}
+	if(argc - optind != 3) {
+		fprintf(stderr, "[usage] <program> [-o output] [-k days] <input-folder> <file-basename> <xor-size>\n");
+		fprintf(stderr, "[usage] -o follow the transfer while it arrives and write it in order to <output> (- for stdout)\n");
+		fprintf(stderr, "[usage] -k remove chunks of the delta store unused for <days> (default %u, not less: the sender counts on it; 0 = keep all)\n", DELTA_KEEP);
 		exit(17);
 	}
+	argv += optind - 1;
 	
 	// recovery data file names
-	char subpaths[5][256];
+	char subpaths[6][256];
 	strcpy(subpaths[0], "_clear_data.in");
 	strcpy(subpaths[1], "_xor_data.in");
 	strcpy(subpaths[2], "_checksum.in");
 	strcpy(subpaths[3], "_clear_list.in");
 	strcpy(subpaths[4], "_xor_list.in");
+	strcpy(subpaths[5], "_meta.in");
 	
 	// build path to files
 	strcpy(path, argv[1]);
@@ -566,10 +874,12 @@ int main(int argc, char *argv[]) {
 	strcat(paths[3], subpaths[3]);
 	strcpy(paths[4], path);
 	strcat(paths[4], subpaths[4]);
+	strcpy(paths[5], path);
+	strcat(paths[5], subpaths[5]);
 	
 	XOR_GROUP_SIZE = atoi(argv[3]);
 
-	uint8_t retval = recover(paths);
+	uint8_t retval = (out != NULL) ? follow(paths, out) : recover(paths);
 
 	if(retval)
 		clean_tempfiles(paths, path);
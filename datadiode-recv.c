@@ -42,10 +42,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <pthread.h>
 #include <sched.h>
 #include <errno.h>
+#include <getopt.h>
+#include <net/if.h>
+#include <linux/filter.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <time.h>
 
+#include "protocol.h"
+#include "rawrx.h"
+#include "uring.h"
 
 /* verbose debug information */
 //#define DEBUG
@@ -67,6 +77,75 @@
 #define MAXBUFLEN 1472
 #define MAGICNUMBER 42
 
+/* receive through a ring on this interface instead of the UDP sockets: "iface[,xdp|packet]" */
+char *RAW_SPEC = NULL;
+
+/* write slices through io_uring instead of lseek + write */
+uint8_t URING = 0;
+#define URING_ENTRIES 256
+#define URING_BUFFERS 256
+#define CACHED_FILES 8
+
+/* parallel diode links arriving on other port ranges, merged into the same temp files */
+#define MAX_LINKS 8
+char *LINK_PORTS[MAX_LINKS];
+uint32_t NLINKS = 1;
+
+/* metrics: -M path[,seconds] rewrites a Prometheus textfile, -M unix:path answers every connection with the same text */
+char *METRICS_SPEC = NULL;
+char *TEMP_FOLDER = NULL;
+#define METRICS_INTERVAL 10
+char METRICS_PATH[256], METRICS_TMPPATH[300];
+int METRICS_EVERY = METRICS_INTERVAL;
+
+/* slice counts of the transfers: a list is read again only when it changed, and then at most every METRICS_RESCAN
+ * seconds, so a scrape costs a stat per list instead of a read of every list. Only the metrics thread uses them. */
+#define METRICS_RESCAN 30
+typedef struct {
+	char path[600];
+	struct timespec mtime;
+	off_t size;
+	uint64_t count;
+	uint64_t scanned;	// CLOCK_MONOTONIC_COARSE of the last read, ns
+	uint8_t seen;
+} slice_count_t;
+slice_count_t *COUNTS = NULL;
+uint32_t NCOUNTS = 0, COUNTS_MAX = 0;
+
+// counters of one receiving thread: only that thread writes them, the exporter reads them without locks
+typedef struct {
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t duplicates;	// slices that were already stored
+	uint64_t overflows;	// datagrams dropped by the full socket buffer (SO_RXQ_OVFL)
+	uint64_t last_packet;	// CLOCK_MONOTONIC_COARSE, ns
+	uint16_t port;
+	const char *kind;
+} __attribute__((aligned(64))) port_stats_t;
+
+port_stats_t STATS[3 * MAX_LINKS];
+uint32_t NSTATS = 0;
+
+static inline void stat_set(uint64_t *counter, uint64_t value) {
+	__atomic_store_n(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t stat_get(uint64_t *counter) {
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+uint64_t coarse_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void stat_packet(port_stats_t *stats, uint64_t len) {
+	stat_set(&(stats->packets), stats->packets + 1);
+	stat_set(&(stats->bytes), stats->bytes + len);
+	stat_set(&(stats->last_packet), coarse_ns());
+}
+
 int set_affinity_thread(int core_id) {
    int num_cores = sysconf(_SC_NPROCESSORS_ONLN);
    if (core_id < 0 || core_id >= num_cores)
@@ -93,11 +172,33 @@ typedef struct {
 	char *file_path;
 	char *temp_folder;
 	char *slice_path;
+	char *meta_path;
 	destination_t *dest;
 	void (*process_information)(void *, unsigned char *);
 	int core;
+	uint16_t port;
+	rawrx_t *rx;
+	struct writer *writer;
+	uint8_t preallocate;
+	port_stats_t *stats;
 } receive_thread_arg_t;
 
+// slice list and data file of a transfer, kept open in registered slots 2i and 2i+1
+typedef struct {
+	char name[FILEIDLEN + 1];
+	char *suffix;
+	int fd[2];
+	ino_t ino[2];
+	uint64_t used;
+} cached_file_t;
+
+// io_uring writer, one per receiving thread
+typedef struct writer {
+	uring_t ring;
+	cached_file_t files[CACHED_FILES];
+	uint64_t clock;
+} writer_t;
+
 // configure socket related things
 void get_socket(destination_t *dest) {
 	int status;
@@ -136,6 +237,8 @@ void get_socket(destination_t *dest) {
 			continue;
 		}
 		
+		// the kernel reports its drop counter of the socket with every datagram
+		setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &yes, sizeof(yes));
 		break;
 	}
 		
@@ -150,6 +253,135 @@ void get_socket(destination_t *dest) {
 	dest->socketfd = sockfd;
 }
 
+writer_t *writer_open() {
+	writer_t *w = (writer_t *)calloc(1, sizeof(writer_t));
+	if(w == NULL) {
+		perror("[receiver] writer failed to allocate");
+		exit(29);
+	}
+	if(uring_open(&(w->ring), URING_ENTRIES, URING_BUFFERS, DATALEN, 2 * CACHED_FILES) == -1) {
+		perror("[receiver] io_uring setup failed");
+		exit(29);
+	}
+	w->ring.fixed[0] = MAGICNUMBER;
+	for(int i=0; i<CACHED_FILES; i++)
+		w->files[i].fd[0] = w->files[i].fd[1] = -1;
+	return w;
+}
+
+// reuse the open files of a transfer as long as recovery did not remove them
+cached_file_t *writer_files(writer_t *w, receive_thread_arg_t *args, unsigned char *buf, char paths[2][256], int *slot) {
+	struct stat st;
+	cached_file_t *c = NULL;
+	int i;
+
+	for(i=0; i<CACHED_FILES; i++)
+		if(w->files[i].suffix == args->file_path && strncmp(w->files[i].name, (char *)buf, FILEIDLEN) == 0)
+			break;
+	if(i < CACHED_FILES) {
+		c = &(w->files[i]);
+		uint8_t valid = 1;
+		for(int k=0; k<2; k++)
+			if(stat(paths[k], &st) == -1 || st.st_ino != c->ino[k])
+				valid = 0;
+		if(valid) {
+			c->used = ++(w->clock);
+			*slot = i;
+			return c;
+		}
+	}
+	else {
+		// least recently used
+		i = 0;
+		for(int k=1; k<CACHED_FILES; k++)
+			if(w->files[k].used < w->files[i].used)
+				i = k;
+		c = &(w->files[i]);
+	}
+
+	// fixed files are looked up when a write is issued, linked and punted ones included: the writes
+	// still queued for the slot have to be done before it points to another file
+	if((c->fd[0] != -1 || c->fd[1] != -1) && uring_drain(&(w->ring)) == -1) {
+		perror("[receiver] io_uring submit failed");
+		exit(29);
+	}
+	for(int k=0; k<2; k++) {
+		int fd = open(paths[k], O_RDWR | O_CREAT, 0666);
+		if(fd == -1) {
+			perror("[receiver] open failed for slice");
+			exit(10);
+		}
+		if(fstat(fd, &st) == -1) {
+			perror("[receiver] fstat failed");
+			exit(10);
+		}
+		// the clear data file size is known from the header, reserve it in one go
+		if(k == 1 && args->preallocate && st.st_size == 0 && st.st_blocks == 0) {
+			uint32_t size = 0;
+			for(uint8_t j=0; j<TOTALLEN; j++)
+				size = (size << 8) | buf[FILEIDLEN + j];
+			if(size > 0 && size != UINT32_MAX)
+				fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)((size + DATALEN - 1) / DATALEN) * DATALEN);
+		}
+		if(uring_set_file(&(w->ring), 2 * i + k, fd) == -1) {
+			perror("[receiver] io_uring file registration failed");
+			exit(29);
+		}
+		if(c->fd[k] != -1)
+			close(c->fd[k]);
+		c->fd[k] = fd;
+		c->ino[k] = st.st_ino;
+	}
+	strncpy(c->name, (char *)buf, FILEIDLEN);
+	c->name[FILEIDLEN] = 0;
+	c->suffix = args->file_path;
+	c->used = ++(w->clock);
+	*slot = i;
+	return c;
+}
+
+// queue the data and then its mark in the slice file, the receive path never waits on the disk
+void queue_data(receive_thread_arg_t *args, unsigned char *buf, uint32_t part_no) {
+	writer_t *w = args->writer;
+	char paths[2][256];
+	int slot;
+
+	snprintf(paths[0], 255, "%s/%.100s%s", args->temp_folder, buf, args->slice_path);
+	snprintf(paths[1], 255, "%s/%.100s%s", args->temp_folder, buf, args->file_path);
+	cached_file_t *c = writer_files(w, args, buf, paths, &slot);
+
+	// marks still in flight only let a duplicate write the same data twice
+	char aux = 0;
+	uint32_t offset = part_no - 1;
+	if(pread(c->fd[0], &aux, 1, offset) == 1 && aux == MAGICNUMBER) {
+		stat_set(&(args->stats->duplicates), args->stats->duplicates + 1);
+		return;
+	}
+
+	uint32_t index;
+	unsigned char *data = uring_buffer(&(w->ring), &index);
+	memcpy(data, buf + FILEIDLEN + TOTALLEN + PARTLEN, DATALEN);
+	uring_write_fixed(&(w->ring), 2 * slot + 1, index, data, DATALEN, (off_t)offset * DATALEN, 1);
+	uring_write_fixed(&(w->ring), 2 * slot, w->ring.nbufs, w->ring.fixed, 1, offset, 0);
+}
+
+// descriptors of a stream report how far the sender got, keep the latest one
+uint8_t stream_progress(char *path, unsigned char *buf) {
+	meta_t stored, meta;
+	unsigned char data[METALEN];
+
+	if(meta_parse(&meta, buf + FILEIDLEN + TOTALLEN + PARTLEN) == -1 || !(meta.flags & META_STREAM))
+		return 0;
+
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+		return 0;
+	int n = pread(fd, data, METALEN, FILEIDLEN + TOTALLEN);
+	close(fd);
+
+	return (n < METALEN || meta_parse(&stored, data) == -1 || meta.file_size > stored.file_size);
+}
+
 // store checksum in local file
 void process_checksum(void *arg, unsigned char *buf) {
 	receive_thread_arg_t *args = (receive_thread_arg_t *)(arg);
@@ -187,8 +419,9 @@ void process_checksum(void *arg, unsigned char *buf) {
 	// check if file already exists -> then no longer store
 	struct stat st;
 	char path[256];
-	snprintf(path, 255, "%s/%.100s%s", args->temp_folder, buf, args->file_path);
-	if(stat(path, &st) == 0)
+	char *suffix = (part_no == META_PART) ? args->meta_path : args->file_path;
+	snprintf(path, 255, "%s/%.100s%s", args->temp_folder, buf, suffix);
+	if(stat(path, &st) == 0 && (part_no != META_PART || !stream_progress(path, buf)))
 		return;
 	
 	// store fileid, file size and checksum
@@ -213,7 +446,7 @@ void process_checksum(void *arg, unsigned char *buf) {
 		exit(7);
 	}
 	
-	// save actual checksum
+	// save actual checksum or transfer descriptor
 	p = buf + FILEIDLEN + TOTALLEN + PARTLEN;
 	if((n = write(fd, p, DATALEN)) < 0) {
 		perror("[receiver] write failed for checksum");
@@ -238,6 +471,11 @@ void process_data(void *arg, unsigned char *buf) {
 		part_no = (part_no << 8) | (*(p+i));
 	}
 
+	if(args->writer != NULL) {
+		queue_data(args, buf, part_no);
+		return;
+	}
+
 	// build local files' names
 	char data_path[256], slice_path[256];
 	snprintf(data_path, 255, "%s/%.100s%s", args->temp_folder, buf, args->file_path);
@@ -254,6 +492,7 @@ void process_data(void *arg, unsigned char *buf) {
 	lseek(fd_slice, offset, SEEK_SET);	
 	if(read(fd_slice, &aux, 1) == 1 && aux == MAGICNUMBER) {
 		// slice exists -> skip
+		stat_set(&(args->stats->duplicates), args->stats->duplicates + 1);
 		if(close(fd_slice) == -1) {
 			perror("[receiver] close failed for slice");
 			exit(11);
@@ -278,7 +517,7 @@ void process_data(void *arg, unsigned char *buf) {
 	}
 	int n = 0;
 	p = buf + FILEIDLEN + TOTALLEN + PARTLEN;
-	lseek(fd_data, (part_no-1) * DATALEN, SEEK_SET);
+	lseek(fd_data, (off_t)(part_no-1) * DATALEN, SEEK_SET);
 	if((n = write(fd_data, p, DATALEN)) != DATALEN) {
 		perror("[receiver] write less than DATALEN");
 		exit(14);
@@ -295,10 +534,31 @@ void process_data(void *arg, unsigned char *buf) {
 	}
 }
 
+// one datagram, counted; the socket drop counter comes along as ancillary data
+int64_t receive_packet(int sockfd, unsigned char *buf, int flags, port_stats_t *stats) {
+	struct iovec iov = { buf, MAXBUFLEN };
+	char control[CMSG_SPACE(sizeof(uint32_t))];
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	int64_t numbytes = recvmsg(sockfd, &msg, flags);
+	if(numbytes == -1)
+		return -1;
+	for(cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+			stat_set(&(stats->overflows), *(uint32_t *)CMSG_DATA(cmsg));
+	stat_packet(stats, numbytes);
+	return numbytes;
+}
+
 void *thread_routine(void *arg) {
 	receive_thread_arg_t *args = (receive_thread_arg_t *)(arg);
-	struct sockaddr_storage their_addr;
-	socklen_t addr_len = sizeof(their_addr);
 	
 	printf("[receiver] Thread starting\n");
 	
@@ -309,7 +569,19 @@ void *thread_routine(void *arg) {
 	int sockfd = (args->dest)->socketfd;
 	
 	while(1) {
-		if ((numbytes = recvfrom(sockfd, buf, MAXBUFLEN, 0, (struct sockaddr *)&their_addr, &addr_len)) == -1) {
+		// with queued writes only wait for packets once the writes are done
+		int flags = (args->writer != NULL) ? MSG_DONTWAIT : 0;
+		if ((numbytes = receive_packet(sockfd, buf, flags, args->stats)) == -1) {
+			if(flags != 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				if(uring_drain(&(args->writer->ring)) == -1) {
+					perror("[receiver] io_uring submit failed");
+					exit(29);
+				}
+				if ((numbytes = receive_packet(sockfd, buf, 0, args->stats)) != -1) {
+					args->process_information(arg, buf);
+					continue;
+				}
+			}
 			perror("[receiver] recvfrom failed");
 			exit(17);
 		}	
@@ -320,22 +592,383 @@ void *thread_routine(void *arg) {
 	pthread_exit(NULL);	
 }
 
+// frames of all three ports come through one ring, hand each payload to the handler of its port
+void ring_handler(void *ctx, uint16_t port, unsigned char *payload, uint32_t len) {
+	receive_thread_arg_t *args = (receive_thread_arg_t *)(ctx);
+	unsigned char buf[MAXBUFLEN];
+	int i = port - args[0].port;
+
+	stat_packet(args[i].stats, len);
+	// handlers read a whole datagram, only short ones need a copy
+	if(len < MAXBUFLEN) {
+		memset(buf, 0, MAXBUFLEN);
+		memcpy(buf, payload, len);
+		payload = buf;
+	}
+	args[i].process_information(&args[i], payload);
+}
+
+void *ring_routine(void *arg) {
+	receive_thread_arg_t *args = (receive_thread_arg_t *)(arg);
+	rawrx_t *rx = args[0].rx;
+
+	printf("[receiver] Ring thread starting\n");
+
+	set_affinity_thread(args[0].core);
+
+	while(1) {
+		int count = rawrx_poll(rx, 100, ring_handler, arg);
+		if(count == -1) {
+			perror("[receiver] ring poll failed");
+			exit(17);
+		}
+		// the ring gives the frames back right away, the queued writes finish when it runs dry
+		if(args[0].writer != NULL && uring_submit(&(args[0].writer->ring), 0) == -1) {
+			perror("[receiver] io_uring submit failed");
+			exit(29);
+		}
+		if(count == 0 && args[0].writer != NULL && uring_drain(&(args[0].writer->ring)) == -1) {
+			perror("[receiver] io_uring submit failed");
+			exit(29);
+		}
+	}
+
+	printf("[receiver] Ring thread exiting\n");
+	pthread_exit(NULL);
+}
+
+// count the slices marked as stored in a slice list
+uint64_t count_slices(char *path) {
+	unsigned char buf[4096];
+	uint64_t count = 0;
+	int n, fd = open(path, O_RDONLY);
+
+	if(fd == -1)
+		return 0;
+	while((n = read(fd, buf, sizeof(buf))) > 0)
+		for(int i=0; i<n; i++)
+			count += (buf[i] == MAGICNUMBER);
+	close(fd);
+	return count;
+}
+
+// count_slices through the cache, a list that is gone counts 0 and drops out after the scrape;
+// once the transfer finished its lists are read again right away so the last counts are exact
+uint64_t cached_slices(char *path, uint64_t now, int finished) {
+	struct stat st;
+	slice_count_t *c = NULL;
+
+	if(stat(path, &st) == -1)
+		return 0;
+	for(uint32_t i=0; i<NCOUNTS && c == NULL; i++)
+		if(strcmp(COUNTS[i].path, path) == 0)
+			c = &COUNTS[i];
+	if(c == NULL) {
+		if(NCOUNTS == COUNTS_MAX) {
+			slice_count_t *grown = (slice_count_t *)realloc(COUNTS, (COUNTS_MAX + 64) * sizeof(slice_count_t));
+			if(grown == NULL)
+				return count_slices(path);
+			COUNTS = grown;
+			COUNTS_MAX += 64;
+		}
+		c = &COUNTS[NCOUNTS++];
+		snprintf(c->path, sizeof(c->path), "%s", path);
+		c->scanned = 0;
+	} else if((st.st_size == c->size && st.st_mtim.tv_sec == c->mtime.tv_sec && st.st_mtim.tv_nsec == c->mtime.tv_nsec) ||
+		(!finished && now - c->scanned < METRICS_RESCAN * 1000000000ULL)) {
+		c->seen = 1;
+		return c->count;
+	}
+	c->count = count_slices(path);
+	c->size = st.st_size;
+	c->mtime = st.st_mtim;
+	c->scanned = now;
+	c->seen = 1;
+	return c->count;
+}
+
+// slices of a transfer from its descriptor, else from the size stored with the checksum; 0 until one of them arrived
+uint64_t transfer_slices(char *prefix) {
+	char path[512];
+	unsigned char data[METALEN];
+	uint64_t size = 0;
+	meta_t meta;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s_meta.in", prefix);
+	if((fd = open(path, O_RDONLY)) != -1) {
+		if(pread(fd, data, METALEN, FILEIDLEN + TOTALLEN) == METALEN && meta_parse(&meta, data) == 0)
+			size = meta.file_size;
+		close(fd);
+	}
+	snprintf(path, sizeof(path), "%s_checksum.in", prefix);
+	if(size == 0 && (fd = open(path, O_RDONLY)) != -1) {
+		if(pread(fd, data, TOTALLEN, FILEIDLEN) == TOTALLEN)
+			for(uint8_t j=0; j<TOTALLEN; j++)
+				size = (size << 8) | data[j];
+		close(fd);
+	}
+	return (size + DATALEN - 1) / DATALEN;
+}
+
+// file names end up in label values
+void metrics_label(FILE *f, const char *s) {
+	for(; *s; s++) {
+		if(*s == '\\' || *s == '"')
+			fputc('\\', f);
+		if(*s == '\n')
+			fputs("\\n", f);
+		else
+			fputc(*s, f);
+	}
+}
+
+// Prometheus text exposition of the port counters and of every transfer in the temp folder
+void metrics_write(FILE *f) {
+	static const struct {
+		const char *name, *help, *type;
+		size_t offset;
+	} counters[] = {
+		{ "datadiode_recv_packets_total", "Datagrams received.", "counter", offsetof(port_stats_t, packets) },
+		{ "datadiode_recv_bytes_total", "Bytes received.", "counter", offsetof(port_stats_t, bytes) },
+		{ "datadiode_recv_duplicate_slices_total", "Slices received again after they were stored.", "counter", offsetof(port_stats_t, duplicates) },
+		{ "datadiode_recv_socket_overflows_total", "Datagrams dropped by a full socket receive buffer.", "counter", offsetof(port_stats_t, overflows) },
+	};
+	uint64_t now = coarse_ns(), last = 0;
+
+	for(uint32_t c=0; c<sizeof(counters) / sizeof(counters[0]); c++) {
+		fprintf(f, "# HELP %s %s\n# TYPE %s %s\n", counters[c].name, counters[c].help, counters[c].name, counters[c].type);
+		for(uint32_t i=0; i<NSTATS; i++)
+			fprintf(f, "%s{port=\"%u\",stream=\"%s\"} %lu\n", counters[c].name, STATS[i].port, STATS[i].kind,
+				stat_get((uint64_t *)((char *)&STATS[i] + counters[c].offset)));
+	}
+	fprintf(f, "# HELP datadiode_recv_seconds_since_last_packet Time since the last datagram.\n");
+	fprintf(f, "# TYPE datadiode_recv_seconds_since_last_packet gauge\n");
+	for(uint32_t i=0; i<NSTATS; i++) {
+		uint64_t t = stat_get(&(STATS[i].last_packet));
+		if(t == 0)
+			continue;
+		if(t > last)
+			last = t;
+		fprintf(f, "datadiode_recv_seconds_since_last_packet{port=\"%u\",stream=\"%s\"} %.3f\n", STATS[i].port, STATS[i].kind,
+			(now > t) ? (now - t) / 1e9 : 0.0);
+	}
+	if(last > 0)
+		fprintf(f, "datadiode_recv_seconds_since_last_packet %.3f\n", (now > last) ? (now - last) / 1e9 : 0.0);
+
+	// transfers still in the temp folder, coverage from their slice lists
+	DIR *dir = opendir(TEMP_FOLDER);
+	if(dir == NULL)
+		return;
+	fprintf(f, "# HELP datadiode_transfer_slices Slices of a transfer (0 until its size is known).\n# TYPE datadiode_transfer_slices gauge\n");
+	fprintf(f, "# HELP datadiode_transfer_clear_slices Clear slices stored.\n# TYPE datadiode_transfer_clear_slices gauge\n");
+	fprintf(f, "# HELP datadiode_transfer_xor_slices Xor groups stored.\n# TYPE datadiode_transfer_xor_slices gauge\n");
+	fprintf(f, "# HELP datadiode_transfer_finished The EOF of the transfer arrived.\n# TYPE datadiode_transfer_finished gauge\n");
+	struct dirent *e;
+	const char *suffix = "_clear_list.in";
+	for(uint32_t i=0; i<NCOUNTS; i++)
+		COUNTS[i].seen = 0;
+	while((e = readdir(dir)) != NULL) {
+		size_t len = strlen(e->d_name), slen = strlen(suffix);
+		if(len <= slen || strcmp(e->d_name + len - slen, suffix) != 0)
+			continue;
+		char name[256], prefix[512], path[600];
+		snprintf(name, sizeof(name), "%.*s", (int)(len - slen), e->d_name);
+		snprintf(prefix, sizeof(prefix), "%s/%s", TEMP_FOLDER, name);
+
+		uint64_t values[4];
+		values[0] = transfer_slices(prefix);
+		snprintf(path, sizeof(path), "%s.finished", prefix);
+		values[3] = (access(path, F_OK) == 0);
+		snprintf(path, sizeof(path), "%s_clear_list.in", prefix);
+		values[1] = cached_slices(path, now, values[3]);
+		snprintf(path, sizeof(path), "%s_xor_list.in", prefix);
+		values[2] = cached_slices(path, now, values[3]);
+
+		const char *names[4] = { "datadiode_transfer_slices", "datadiode_transfer_clear_slices", "datadiode_transfer_xor_slices",
+			"datadiode_transfer_finished" };
+		for(int k=0; k<4; k++) {
+			fprintf(f, "%s{file=\"", names[k]);
+			metrics_label(f, name);
+			fprintf(f, "\"} %lu\n", values[k]);
+		}
+	}
+	closedir(dir);
+
+	// forget the lists of transfers that were recovered
+	uint32_t kept = 0;
+	for(uint32_t i=0; i<NCOUNTS; i++)
+		if(COUNTS[i].seen)
+			COUNTS[kept++] = COUNTS[i];
+	NCOUNTS = kept;
+}
+
+// the metrics text is built in memory, a slow or vanished reader never sees half of it
+char *metrics_text(size_t *len) {
+	char *text = NULL;
+	FILE *f = open_memstream(&text, len);
+	if(f == NULL) {
+		perror("[receiver] open_memstream failed for metrics");
+		exit(30);
+	}
+	metrics_write(f);
+	fclose(f);
+	return text;
+}
+
+// textfile for the node exporter, replaced atomically
+int metrics_file() {
+	size_t len;
+	char *text = metrics_text(&len);
+	int ret = 0, fd = open(METRICS_TMPPATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if(fd == -1 || write(fd, text, len) != (ssize_t)len)
+		ret = -1;
+	if(fd != -1 && close(fd) == -1)
+		ret = -1;
+	if(ret == 0 && rename(METRICS_TMPPATH, METRICS_PATH) == -1)
+		ret = -1;
+	free(text);
+	return ret;
+}
+
+void *metrics_routine(void *arg) {
+	int listenfd = *(int *)arg;
+
+	if(listenfd != -1) {
+		while(1) {
+			int c = accept(listenfd, NULL, NULL);
+			if(c == -1) {
+				if(errno != EINTR)
+					perror("[receiver] metrics accept failed");
+				continue;
+			}
+			size_t len;
+			char *text = metrics_text(&len);
+			for(size_t done=0; done<len; ) {
+				ssize_t n = send(c, text + done, len - done, MSG_NOSIGNAL);
+				if(n <= 0)
+					break;
+				done += n;
+			}
+			free(text);
+			close(c);
+		}
+	}
+
+	// the first textfile was written by metrics_start, a later failure (full disk) is only reported
+	while(1) {
+		sleep(METRICS_EVERY);
+		if(metrics_file() == -1)
+			perror("[receiver] metrics textfile failed");
+	}
+	return NULL;
+}
+
+// the stats endpoint is set up before the receiving threads start, so a wrong path stops the receiver right away
+void metrics_start() {
+	static int listenfd = -1;
+	pthread_t thread;
+
+	if(METRICS_SPEC == NULL)
+		return;
+	if(strncmp(METRICS_SPEC, "unix:", 5) == 0) {
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if(strlen(METRICS_SPEC + 5) >= sizeof(addr.sun_path)) {
+			fprintf(stderr, "[receiver] metrics socket path too long\n");
+			exit(30);
+		}
+		strcpy(addr.sun_path, METRICS_SPEC + 5);
+		unlink(addr.sun_path);
+		if((listenfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 || bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+			listen(listenfd, 8) == -1) {
+			perror("[receiver] metrics socket failed");
+			exit(30);
+		}
+	} else {
+		char *comma = strrchr(METRICS_SPEC, ',');
+		size_t len = (comma != NULL) ? (size_t)(comma - METRICS_SPEC) : strlen(METRICS_SPEC);
+		if(len == 0 || len >= sizeof(METRICS_PATH)) {
+			fprintf(stderr, "[receiver] metrics textfile path empty or too long\n");
+			exit(30);
+		}
+		snprintf(METRICS_PATH, sizeof(METRICS_PATH), "%.*s", (int)len, METRICS_SPEC);
+		snprintf(METRICS_TMPPATH, sizeof(METRICS_TMPPATH), "%s.tmp", METRICS_PATH);
+		if(comma != NULL && atoi(comma + 1) > 0)
+			METRICS_EVERY = atoi(comma + 1);
+		if(metrics_file() == -1) {
+			perror("[receiver] metrics textfile failed");
+			exit(30);
+		}
+	}
+	if(pthread_create(&thread, NULL, metrics_routine, &listenfd)) {
+		perror("[receiver] metrics thread creation failed");
+		exit(30);
+	}
+	pthread_detach(thread);
+}
+
+// the ports stay bound so nothing answers with ICMP, but the ring gets the packets
+void mute_socket(destination_t *dest) {
+	struct sock_filter code[] = { BPF_STMT(BPF_RET | BPF_K, 0) };
+	struct sock_fprog filter = { 1, code };
+
+	if(setsockopt(dest->socketfd, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter)) == -1) {
+		perror("[receiver] setsockopt failed for filter");
+		exit(2);
+	}
+}
+
 int main(int argc, char *argv[]) {
+	int opt;
+
+	while((opt = getopt(argc, argv, "R:UL:M:")) != -1) {
+		switch(opt) {
+			case 'M':
+				METRICS_SPEC = optarg;
+				break;
+			case 'L':
+				if(NLINKS == MAX_LINKS) {
+					fprintf(stderr, "[receiver] at most %u links\n", MAX_LINKS);
+					exit(18);
+				}
+				LINK_PORTS[NLINKS++] = optarg;
+				break;
+			case 'R':
+				RAW_SPEC = optarg;
+				break;
+			case 'U':
+				URING = 1;
+				break;
+			default:
+				argc = 0;
+		}
+	}
+	argv += optind - 1;
+	argc -= optind - 1;
 
 	// process data from outside
-	if(argc != 3) {
-		fprintf(stderr, "[usage] <program> <port> <temp-folder>\n");
+	if(argc != 3 || (RAW_SPEC != NULL && NLINKS > 1)) {
+		fprintf(stderr, "[usage] <program> [-R iface[,xdp|packet]] [-U] [-L port]... [-M path[,seconds]|unix:path] <port> <temp-folder>\n");
 		fprintf(stderr, "[usage] File will be received on 3 consecutive ports starting with <port>\n");
+		fprintf(stderr, "[usage] -R receive through an AF_XDP or TPACKET_V3 ring on iface instead of the sockets\n");
+		fprintf(stderr, "[usage] -U write slices through io_uring\n");
+		fprintf(stderr, "[usage] -L also receive the 3 ports of another diode link starting with <port> (not with -R)\n");
+		fprintf(stderr, "[usage] -M packet, drop and per-transfer counters as a Prometheus textfile rewritten every %d seconds,\n", METRICS_INTERVAL);
+		fprintf(stderr, "[usage]    or answered to every connection on a unix socket\n");
 		exit(18);
 	}
 
 	// local temporary storage for file slices
-	char subpaths[5][256];
+	char subpaths[6][256];
 	strcpy(subpaths[0], "_clear_data.in");
 	strcpy(subpaths[1], "_xor_data.in");
 	strcpy(subpaths[2], "_checksum.in");
 	strcpy(subpaths[3], "_clear_list.in");
 	strcpy(subpaths[4], "_xor_list.in");
+	strcpy(subpaths[5], "_meta.in");
 	
 	
 	/* CONFIGURE SOCKET RELATED THINGS */
@@ -362,46 +995,162 @@ int main(int argc, char *argv[]) {
 	receive_thread_arg_t arg[3];
 	int ret;
 	
-	// create thread to receive clear packets on the first port
+	// clear packets on the first port
 	arg[0].dest = &dest_clear;
 	arg[0].file_path = subpaths[0];
 	arg[0].temp_folder = argv[2];
 	arg[0].slice_path = subpaths[3];
+	arg[0].meta_path = NULL;
 	arg[0].process_information = process_data;
 	arg[0].core = 0;
-	ret = pthread_create(&threadID[0], NULL, thread_routine, (void *)(&arg[0]));
-	if(ret) {
-		perror("[receiver] clear packet thread creation failed");
-		exit(19);
-	}
 
-	// create thread to receive xored packets on the second port
+	// xored packets on the second port
 	arg[1].dest = &dest_xored;
 	arg[1].file_path = subpaths[1];
 	arg[1].temp_folder = argv[2];
 	arg[1].slice_path = subpaths[4];
+	arg[1].meta_path = NULL;
 	arg[1].process_information = process_data;
 	arg[1].core = 1;
-	ret = pthread_create(&threadID[1], NULL, thread_routine, (void *)(&arg[1]));
-	if(ret) {
-		perror("[receiver] clear packet thread creation failed");
-		exit(20);
-	}
-	
-	// create thread to receive checksum packets on the third port
+
+	// checksum packets on the third port
 	arg[2].dest = &dest_check;
 	arg[2].file_path = subpaths[2];
 	arg[2].temp_folder = argv[2];
 	arg[2].slice_path = NULL;
+	arg[2].meta_path = subpaths[5];
 	arg[2].process_information = process_checksum;
 	arg[2].core = 2;
+
+	TEMP_FOLDER = argv[2];
+	const char *kinds[3] = { "clear", "xor", "checksum" };
+	for(int i=0; i<3; i++) {
+		arg[i].port = atoi(argv[1]) + i;
+		arg[i].rx = NULL;
+		arg[i].writer = NULL;
+		arg[i].preallocate = (i == 0);
+		arg[i].stats = &STATS[i];
+		STATS[i].port = arg[i].port;
+		STATS[i].kind = kinds[i];
+	}
+	NSTATS = 3;
+
+	if(RAW_SPEC != NULL) {
+		rawrx_t rx;
+		char ifname[IFNAMSIZ] = {0};
+		uint8_t mode = RAWRX_AUTO;
+		char *comma = strchr(RAW_SPEC, ',');
+
+		strncpy(ifname, RAW_SPEC, (comma != NULL && comma - RAW_SPEC < IFNAMSIZ) ? (size_t)(comma - RAW_SPEC) : IFNAMSIZ - 1);
+		if(comma != NULL && strcmp(comma + 1, "xdp") == 0)
+			mode = RAWRX_XDP;
+		else if(comma != NULL && strcmp(comma + 1, "packet") == 0)
+			mode = RAWRX_PACKET;
+		else if(comma != NULL) {
+			fprintf(stderr, "[receiver] unknown ring mode %s\n", comma + 1);
+			exit(18);
+		}
+
+		if(rawrx_open(&rx, ifname, arg[0].port, 3, mode) == -1) {
+			if(mode == RAWRX_XDP && errno == EOPNOTSUPP)
+				fprintf(stderr, "[receiver] AF_XDP takes queue 0 only and %s has %d receive queues, use ethtool -L %s combined 1 or %s,packet\n",
+					ifname, rawrx_queues(if_nametoindex(ifname)), ifname, ifname);
+			perror("[receiver] ring setup failed");
+			exit(28);
+		}
+		printf("[receiver] Receiving through %s ring on %s\n", (rx.mode == RAWRX_XDP) ? "AF_XDP" : "TPACKET_V3", ifname);
+
+		mute_socket(&dest_clear);
+		mute_socket(&dest_xored);
+		mute_socket(&dest_check);
+
+		// a single thread takes every port out of the ring
+		arg[0].rx = &rx;
+		if(URING)
+			arg[0].writer = arg[1].writer = writer_open();
+		metrics_start();
+		ret = pthread_create(&threadID[0], NULL, ring_routine, (void *)arg);
+		if(ret) {
+			perror("[receiver] ring thread creation failed");
+			exit(19);
+		}
+		if(pthread_join(threadID[0], NULL)) {
+			perror("[receiver] ring thread join failed");
+			exit(23);
+		}
+		rawrx_close(&rx);
+		exit(0);
+	}
+
+	// one thread per port, each with its own writer for the data ports
+	if(URING) {
+		arg[0].writer = writer_open();
+		arg[1].writer = writer_open();
+	}
+
+	// every further link gets its own sockets and threads, the handlers merge them by file name
+	LINK_PORTS[0] = argv[1];
+	destination_t *link_dest = (destination_t *)calloc(3 * NLINKS, sizeof(destination_t));
+	receive_thread_arg_t *link_arg = (receive_thread_arg_t *)calloc(3 * NLINKS, sizeof(receive_thread_arg_t));
+	pthread_t *link_thread = (pthread_t *)calloc(3 * NLINKS, sizeof(pthread_t));
+	if(link_dest == NULL || link_arg == NULL || link_thread == NULL) {
+		perror("[receiver] link state failed to allocate");
+		exit(19);
+	}
+	for(uint32_t l=1; l<NLINKS; l++) {
+		for(int i=0; i<3; i++) {
+			destination_t *d = &(link_dest[3 * l + i]);
+			snprintf(d->port, 12, "%d", atoi(LINK_PORTS[l]) + i);
+			get_socket(d);
+
+			receive_thread_arg_t *a = &(link_arg[3 * l + i]);
+			*a = arg[i];
+			a->dest = d;
+			a->port = atoi(LINK_PORTS[l]) + i;
+			a->core = 3 * l + i;
+			a->stats = &STATS[3 * l + i];
+			STATS[3 * l + i].port = a->port;
+			STATS[3 * l + i].kind = kinds[i];
+			if(URING && i < 2)
+				a->writer = writer_open();
+		}
+	}
+	NSTATS = 3 * NLINKS;
+	metrics_start();
+
+	ret = pthread_create(&threadID[0], NULL, thread_routine, (void *)(&arg[0]));
+	if(ret) {
+		perror("[receiver] clear packet thread creation failed");
+		exit(19);
+	}
+
+	ret = pthread_create(&threadID[1], NULL, thread_routine, (void *)(&arg[1]));
+	if(ret) {
+		perror("[receiver] clear packet thread creation failed");
+		exit(20);
+	}
+	
 	ret = pthread_create(&threadID[2], NULL, thread_routine, (void *)(&arg[2]));
 	if(ret) {
 		perror("[receiver] clear packet thread creation failed");
 		exit(21);
 	}
 	
+	for(uint32_t l=1; l<NLINKS; l++)
+		for(int i=0; i<3; i++)
+			if(pthread_create(&(link_thread[3 * l + i]), NULL, thread_routine, (void *)&(link_arg[3 * l + i]))) {
+				perror("[receiver] link thread creation failed");
+				exit(21);
+			}
+
 	// collect threads after they end
+	for(uint32_t l=1; l<NLINKS; l++)
+		for(int i=0; i<3; i++)
+			if(pthread_join(link_thread[3 * l + i], NULL)) {
+				perror("[receiver] link thread join failed");
+				exit(22);
+			}
+
 	if(pthread_join(threadID[2], NULL)) {
 		perror("[receiver] checksum packet thread join failed");
 		exit(22);
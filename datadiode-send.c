@@ -24,12 +24,14 @@
  *
 */ 
 
+#define _GNU_SOURCE
 #include <netinet/in.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <net/if.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -37,9 +39,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
 
 #include <sys/select.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <ftw.h>
+#include <libgen.h>
+#include <limits.h>
+#include <sys/file.h>
 
 /* CHUNK_SIZE is MTU > MAXBUFLEN */
 #define CHUNK_SIZE 1500 // 1048576 1 MB chunks for efficient high-speed transfer
@@ -51,10 +64,37 @@
 //#define DEBUG2
 
 #include "fountain.h"
-#define SEED 777		
+#include "schedule.h"
+#include "planner.h"
+#include "protocol.h"
+#include "ring.h"
+#include "rawtx.h"
+#include "bundle.h"
+#include "compress.h"
+#include "delta.h"
 uint8_t SPRAY = 6;
 uint8_t CLEAR_SPRAY = 6; // can be SPRAY/2+1
 uint8_t XOR_GROUP_SIZE = 4; 
+uint8_t ARG_XOR_GROUP_SIZE, ARG_CLEAR_SPRAY, ARG_SPRAY; // the command line values, every plan starts from them
+uint32_t INTERLEAVE_DEPTH = 0; // 0 = XOR_GROUP_SIZE, 1 = plain shuffled rounds
+uint32_t WINDOW_SLICES = 0; // 0 = whole file is one source block
+#define STREAM_WINDOW 16384 // default source block of a pipe, 22MB
+char *STREAM_NAME = "stdin";
+uint8_t PLANNER = 0;
+loss_model_t LOSS_MODEL = { 0.0, 1.0, 1e-6 };
+uint32_t ENCODERS = 0; // 0 = read, encode and send in one thread
+uint8_t DIRECT_IO = 0; // O_DIRECT reads of source blocks
+#define RING_SLOTS 1024 // packets queued between each encoder and the transmit thread
+#define READ_CHUNK 256 // slices read at once by the reader thread
+#define DIRECT_ALIGN 4096
+char *RAW_SPEC = NULL; // interface[,peer-mac][,xdp|packet] of the raw transmit backend
+rawtx_t *RAWTX = NULL;
+int CODEC = CODEC_NONE; // -Z: compress every file in chunks before it is sliced
+int CODEC_LEVEL = 0;
+uint32_t TRANSFER_FLAGS = 0; // descriptor flags of the file being sent
+uint64_t BUNDLE_SIZE = 0; // -B: <filename> is a spool directory, small files travel in bundles of up to this many bytes
+bundle_entry_t *SPOOL_MEMBER = NULL; // spool file too large for a bundle, sent on its own under SPOOL_OBJECT
+char SPOOL_OBJECT[101];
 
 /* protocol description 
 *		File ID 				: 100 bytes		-> FILEIDLEN
@@ -83,8 +123,34 @@ typedef struct {
 	int socketfd;
 	char port[13];
 	char IP[20];
+	uint8_t channel;		// CHANNEL_CLEAR, CHANNEL_XOR or CHANNEL_CHECK
 } destination_t;
 
+/* parallel diode links: every link has its own 3 ports and its own pacing budget, checksums, descriptors and EOF go on
+ * all of them. Clear and xor packets are spread over the links by weight: copy c of slice (or xor group) p goes on slot
+ * p + c of a wheel where consecutive slots hold different links as far as the weights allow, so the copies of a slice
+ * travel on different links and a clear spray of 1 or more survives a link that loses everything.
+ * The sender cannot see a cut on the far side, only local errors take a link out of the wheel for LINK_RETRY. */
+#define CHANNEL_CLEAR 0
+#define CHANNEL_XOR 1
+#define CHANNEL_CHECK 2
+#define MAX_LINKS 8
+#define LINK_RETRY 1.0			// seconds a link that failed a send is left out
+
+typedef struct {
+	destination_t dest[3];
+	int32_t weight;
+	int32_t current;		// smooth weighted round robin
+	double mbps;
+	uint64_t bytes;			// sent on this link, for pacing
+	double down_until;		// elapsed time when the link may be tried again
+} link_t;
+
+link_t LINKS[MAX_LINKS];
+uint32_t NLINKS = 1;
+uint8_t *LINK_WHEEL = NULL;		// link of every slot, smooth weighted round robin order
+uint32_t LINK_SLOTS = 0;
+
 // contain information related to data packets
 typedef struct {
 	char *file_path;
@@ -98,6 +164,74 @@ typedef struct {
 	1..N 	= packet with index
 */
 
+/* pipelined sender: encoders walk the same transmit plan and serialize every ENCODERS-th step into their own
+ * ring, the transmit thread pops the rings round robin so packets leave in plan order, paced in one place */
+#define SLOT_PACKET 0
+#define SLOT_END 1		// encoder finished the block, transmit order restarts at ring 0
+#define SLOT_QUIT 2
+
+typedef struct {
+	uint8_t type;
+	uint8_t count;			// packets in the slot, a checksum travels with its descriptor
+	uint32_t delay;			// usec to wait after sending
+	uint32_t copy;			// copy of a clear or xor packet, picks its link
+	destination_t *dest[2];
+	unsigned char pack[2][MAXBUFLEN];
+} slot_t;
+
+typedef struct {
+	ring_t *rings;
+	uint32_t encoders;
+	uint64_t seq;			// next step in transmit order, main thread side
+	pthread_t transmit;
+	pthread_t *threads;
+	_Atomic uint32_t ready;		// slices read by the reader thread of a whole file transfer
+	// current block, read-only while the encoders run
+	int fd;
+	unsigned char *block;
+	uint32_t base, len, b, hash, checksums;
+	uint64_t first;
+	uint32_t *index;
+	packet_t msg;
+	unsigned char *checksum, *metabuf;
+	destination_t *dest_clear, *dest_xored, *dest_check;
+} pipeline_t;
+
+typedef struct {
+	pipeline_t *pipe;
+	uint32_t id;
+} encoder_arg_t;
+
+pipeline_t *PIPE = NULL;
+
+/* concurrent transfers: -F adds files sent next to <filename>. Each transfer runs send_file in its own process and
+ * queues its packets in a shared ring, the parent alone paces the links and picks the next packet:
+ * strict order between priorities, weighted fair queueing (virtual time) within a priority */
+#define MAX_TRANSFERS 16
+#define MUX_SLOTS 256
+
+typedef struct {
+	uint8_t type;			// SLOT_PACKET or SLOT_QUIT
+	uint8_t channel;
+	uint32_t copy;
+	unsigned char pack[MAXBUFLEN];
+} mux_slot_t;
+
+typedef struct {
+	char *file_path;
+	uint32_t weight;
+	uint32_t priority;		// higher goes first
+	pid_t pid;
+	ring_t *ring;			// shared with the transfer process
+	double vtime;			// bytes sent / weight
+	uint8_t idle;
+	uint8_t done;
+} transfer_t;
+
+transfer_t TRANSFERS[MAX_TRANSFERS];
+uint32_t NTRANSFERS = 1;
+ring_t *MUX = NULL;			// inside a transfer process: send_slice queues here
+
 uint32_t fnv_hash (void* key, uint32_t len) {
     unsigned char* p = (unsigned char *)key;
     uint32_t h = 2166136261;
@@ -144,38 +278,13 @@ void get_socket(destination_t *dest) {
 	dest->socketfd = sockfd;
 }
 
-// randomize slice indexes to create xor groups
-uint32_t *prepare_fountain(uint32_t slices) {
-	// configure fountain seed
-	seed(SEED);
-	
-	// prepare indexes
-	uint32_t *index = (uint32_t*)malloc(slices * sizeof(uint32_t));
-	if(index == NULL) {
-		perror("[sender] prepare_fountain failed to allocate\n");
-		exit(3);
-	}
-	for (uint32_t i=0; i<slices; i++) 
-		*(index + i) = i;
-	
-	// create random pairings of 4 slices
-	shuffle32(index, slices);
-
-	#ifdef DEBUG
-		printArray32(index, slices);
-	#endif
-
-	return index;
-}
-
 // get data chunk from input file at specified location
 void fill_clear_data(int fd, uint32_t part, unsigned char *data_clear) {
 	memset(data_clear, 0, DATALEN * sizeof(char));
 	
 	// get data from file - padded with zero if less than DATALEN at last chunk
 	int n = 0;
-	lseek(fd, part*DATALEN, SEEK_SET);
-	if((n = read(fd, data_clear, DATALEN)) < 0) {
+	if((n = pread(fd, data_clear, DATALEN, (off_t)part * DATALEN)) < 0) {
 		perror("[sender] read failed");
 		exit(4);
 	}
@@ -185,7 +294,7 @@ void fill_clear_data(int fd, uint32_t part, unsigned char *data_clear) {
 void fill_xor_data(int fd, uint32_t *index, uint32_t group, uint32_t slices, unsigned char *data_xored) {
 	uint32_t slice_index[XOR_GROUP_SIZE];
 	for(uint8_t i=0; i<XOR_GROUP_SIZE; i++) {
-		slice_index[i] = index[(group+i) % slices];
+		slice_index[i] = fountain_member(index, slices, group, i);
 	}
 	#ifdef DEBUG2
 		printf("%d Xor group { %d, %d, %d, %d}\n", group, slice_index[0], slice_index[1], slice_index[2], slice_index[3]);
@@ -196,16 +305,14 @@ void fill_xor_data(int fd, uint32_t *index, uint32_t group, uint32_t slices, uns
 	int n = 0;
 	
 	// store first batch as it is
-	lseek(fd, slice_index[0] * DATALEN, SEEK_SET);
-	if((n = read(fd, data_xored, DATALEN)) < 0) {
+	if((n = pread(fd, data_xored, DATALEN, (off_t)slice_index[0] * DATALEN)) < 0) {
 		perror("[sender] read failed");
 		exit(5);
 	}
 		
 	// get data from file
 	for(uint8_t i=1; i<XOR_GROUP_SIZE; i++) {
-		lseek(fd, slice_index[i] * DATALEN, SEEK_SET);
-		if((n = read(fd, data, DATALEN)) < 0) {
+		if((n = pread(fd, data, DATALEN, (off_t)slice_index[i] * DATALEN)) < 0) {
 			perror("[sender] xor_data read failed");
 			exit(6);
 		}
@@ -217,43 +324,48 @@ void fill_xor_data(int fd, uint32_t *index, uint32_t group, uint32_t slices, uns
 	}
 }
 
-// build checksum
-unsigned char *get_checksum(int fd, uint32_t slices) {
-	unsigned char *checksum = (unsigned char *)malloc(DATALEN * sizeof(char));
-	if(checksum == NULL) {
-		perror("[sender] xor_data failed to allocate\n");
-		exit(7);
+// xor the slices of a source block into the checksum
+void add_checksum(unsigned char *block, uint32_t len, unsigned char *checksum) {
+	for(size_t i=0; i<(size_t)len * DATALEN; i+=DATALEN) {
+		for(uint32_t j=0; j<DATALEN; j++)
+			*(checksum + j) = *(checksum + j) ^ block[i + j];
 	}
-	memset(checksum, 0, DATALEN * sizeof(char));
-	
-	unsigned char data[DATALEN];
-	int n = 0;
-	
-	// store first batch as it is
-	lseek(fd, 0, SEEK_SET);
-	if((n = read(fd, checksum, DATALEN)) < 0) {
-		perror("[sender] read failed");
-		exit(8);
+}
+
+// read a whole source block sequentially, padded with zeroes, and add it to the checksum; returns where the block starts in buf
+// O_DIRECT reads are widened to DIRECT_ALIGN boundaries, buf is aligned and has DIRECT_ALIGN spare bytes at both ends
+unsigned char *read_block(int fd, uint32_t base, uint32_t len, unsigned char *buf, unsigned char *checksum) {
+	off_t offset = (off_t)base * DATALEN;
+	size_t size = (size_t)len * DATALEN;
+	size_t shift = DIRECT_IO ? offset % DIRECT_ALIGN : 0;
+	size_t total = DIRECT_IO ? (shift + size + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN : size;
+	size_t done = 0;
+	ssize_t n = 0;
+
+	while(done < total && (n = pread(fd, buf + done, total - done, offset - shift + done)) > 0) {
+		done += n;
+		// short direct read: end of file
+		if(DIRECT_IO && done % DIRECT_ALIGN)
+			break;
 	}
-		
-	// get rest from file
-	for(uint32_t i=1; i<slices; i++) {
-		if((n = read(fd, data, DATALEN)) < 0) {
-			perror("[sender] xor_data read failed");
-			exit(9);
-		}
-		// perform XOR - at last slice, xor until how much was read
-		// at receive clears padded with 0 -> neutral at xor
-		for(uint32_t j=0; j<n; j++) {
-			*(checksum + j) = *(checksum + j) ^ data[j];
-		}
+	if(n < 0) {
+		perror("[sender] read_block failed");
+		exit(20);
 	}
+	memset(buf + done, 0, total - done);
 
-	#ifdef DEBUG2
-		printf("Checksum computation finished.\n");
-	#endif
-	
-	return checksum;
+	add_checksum(buf + shift, len, checksum);
+	return buf + shift;
+}
+
+// build xored data for the current group from a source block held in memory
+void fill_xor_block(unsigned char *block, uint32_t *index, uint32_t group, uint32_t len, unsigned char *data_xored) {
+	memcpy(data_xored, block + (size_t)fountain_member(index, len, group, 0) * DATALEN, DATALEN);
+	for(uint8_t i=1; i<XOR_GROUP_SIZE; i++) {
+		unsigned char *data = block + (size_t)fountain_member(index, len, group, i) * DATALEN;
+		for(uint32_t j=0; j<DATALEN; j++)
+			*(data_xored + j) = *(data_xored + j) ^ data[j];
+	}
 }
 
 // serialize information from the struct into packet data field
@@ -289,34 +401,54 @@ void serialize(packet_t packet, unsigned char *msg) { //FIXME reversed
 	#endif
 }
 
-// send a slice from a file to the receiver
-void send_slice(int sockfd, unsigned char *msg, struct addrinfo *dest) {
-	int numbytes = 0;
+// seconds since the transfer started
+double elapsed() {
 	struct timespec current_time;
-		
-	if ((numbytes = sendto(sockfd, msg, MAXBUFLEN, 0, dest->ai_addr, dest->ai_addrlen)) == -1) { 
-		perror("[sender] sendto failed for socket1");
-		exit(10);
-	}
-
-	total_bytes += numbytes;
-
-   // Calculate the expected time to process CHUNK_SIZE at TARGET_MBPS
- //   double target_time_per_chunk = (8.0 * CHUNK_SIZE) / (TARGET_MBPS * 1000000.0);  // in seconds
 
-    // Calculate the expected elapsed time (in seconds) for the amount of data sent
-	double expected_time = (total_bytes * 8.0) / (TARGET_MBPS * 1000000.0);
-
-	// Get current time and compute actual elapsed time
 	if (clock_gettime(CLOCK_MONOTONIC, &current_time) != 0) {
 	    perror("clock_gettime");
 	    exit(EXIT_FAILURE);
 	}
-	double elapsed_time = (current_time.tv_sec - start_time.tv_sec) +
-        	              (current_time.tv_nsec - start_time.tv_nsec) / 1e9;
+	return (current_time.tv_sec - start_time.tv_sec) +
+		(current_time.tv_nsec - start_time.tv_nsec) / 1e9;
+}
+
+// send one packet on a link and keep it at its rate, -1 when the link itself failed
+int transmit(link_t *link, destination_t *dest, unsigned char *msg) {
+	int numbytes = 0;
+		
+	if(RAWTX != NULL) {
+		if((numbytes = rawtx_send(RAWTX, (struct sockaddr_in *)dest->dest->ai_addr, msg, MAXBUFLEN)) == -1) {
+			perror("[sender] raw transmit failed");
+			exit(10);
+		}
+	}
+	else {
+		while((numbytes = sendto(dest->socketfd, msg, MAXBUFLEN, 0, dest->dest->ai_addr, dest->dest->ai_addrlen)) == -1) {
+			// a full device queue drains by itself, the link is not down
+			if(NLINKS > 1 && errno == ENOBUFS) {
+				usleep(100);
+				continue;
+			}
+			if(NLINKS > 1 && (errno == ENETUNREACH || errno == EHOSTUNREACH || errno == ENETDOWN))
+				return -1;
+			perror("[sender] sendto failed for socket1");
+			exit(10);
+		}
+	}
+
+	total_bytes += numbytes;
+	link->bytes += numbytes;
+
+    // Calculate the expected elapsed time (in seconds) for the amount of data sent on this link
+	double expected_time = (link->bytes * 8.0) / (link->mbps * 1000000.0);
+	double elapsed_time = elapsed();
 
 	// If we’re ahead of schedule, sleep for the remaining time
 	if (elapsed_time < expected_time) {
+	    // queued raw frames go out before we sleep
+	    if(RAWTX != NULL)
+	        rawtx_flush(RAWTX);
 	    double sleep_time = expected_time - elapsed_time;
 	    struct timeval delay;
 	    delay.tv_sec = (int)sleep_time;
@@ -329,6 +461,528 @@ void send_slice(int sockfd, unsigned char *msg, struct addrinfo *dest) {
 		for(int64_t i=0; i<MAXBUFLEN; i++)
 			printf("[%ld]: %x\n", i, msg[i]);
 	#endif
+
+	return 0;
+}
+
+// links that failed come back after LINK_RETRY, without a burst to catch up on their budget
+uint8_t link_up(link_t *link) {
+	if(link->down_until == 0.0)
+		return 1;
+	double now = elapsed();
+	if(now < link->down_until)
+		return 0;
+	link->down_until = 0.0;
+	link->bytes = now * link->mbps * 1000000.0 / 8.0;
+	return 1;
+}
+
+void link_down(link_t *link) {
+	fprintf(stderr, "[sender] link %s:%s failed: %s\n", link->dest[0].IP, link->dest[0].port, strerror(errno));
+	link->down_until = elapsed() + LINK_RETRY;
+}
+
+// lay the links out on the wheel by smooth weighted round robin, weights reduced by their common divisor
+void link_wheel() {
+	uint32_t g = 0;
+	for(uint32_t i=0; i<NLINKS; i++) {
+		uint32_t a = LINKS[i].weight, b = g;
+		while(b) {
+			uint32_t t = a % b;
+			a = b;
+			b = t;
+		}
+		g = a;
+	}
+	LINK_SLOTS = 0;
+	for(uint32_t i=0; i<NLINKS; i++)
+		LINK_SLOTS += LINKS[i].weight / g;
+
+	LINK_WHEEL = (uint8_t *)malloc(LINK_SLOTS);
+	if(LINK_WHEEL == NULL) {
+		perror("[sender] malloc failed for the link wheel");
+		exit(27);
+	}
+	for(uint32_t s=0; s<LINK_SLOTS; s++) {
+		uint32_t best = 0;
+		for(uint32_t i=0; i<NLINKS; i++) {
+			LINKS[i].current += LINKS[i].weight / g;
+			if(LINKS[i].current > LINKS[best].current)
+				best = i;
+		}
+		LINKS[best].current -= LINK_SLOTS;
+		LINK_WHEEL[s] = best;
+	}
+}
+
+// first link that is up from the wheel slot of this copy of the packet, NULL when every link is down
+link_t *pick_link(unsigned char *msg, uint32_t copy) {
+	uint32_t part = 0;
+	for(uint32_t i=0; i<PARTLEN; i++)
+		part = (part << 8) | msg[FILEIDLEN + TOTALLEN + i];
+
+	uint32_t slot = (uint32_t)(((uint64_t)part + copy) % LINK_SLOTS);
+	for(uint32_t s=0; s<LINK_SLOTS; s++, slot = (slot + 1) % LINK_SLOTS) {
+		link_t *link = &LINKS[LINK_WHEEL[slot]];
+		if(link_up(link))
+			return link;
+	}
+	return NULL;
+}
+
+// send a slice from a file to the receiver, striped over the diode links, copy rotates it over them
+void send_slice(destination_t *dest, unsigned char *msg, uint32_t copy) {
+	link_t *link;
+
+	// a transfer process only queues, the scheduler sends
+	if(MUX != NULL) {
+		mux_slot_t *slot = ring_reserve(MUX);
+		slot->type = SLOT_PACKET;
+		slot->channel = dest->channel;
+		slot->copy = copy;
+		memcpy(slot->pack, msg, MAXBUFLEN);
+		ring_push(MUX);
+		return;
+	}
+
+	if(NLINKS == 1) {
+		transmit(&LINKS[0], dest, msg);
+		return;
+	}
+
+	// few and repeated anyway, every link carries them so any link can finish the transfer
+	if(dest->channel == CHANNEL_CHECK) {
+		uint8_t sent = 0;
+		for(uint32_t i=0; i<NLINKS; i++) {
+			if(!link_up(&LINKS[i]))
+				continue;
+			if(transmit(&LINKS[i], &(LINKS[i].dest[CHANNEL_CHECK]), msg) == -1)
+				link_down(&LINKS[i]);
+			else
+				sent = 1;
+		}
+		if(sent)
+			return;
+	}
+	else {
+		while((link = pick_link(msg, copy)) != NULL) {
+			if(transmit(link, &(link->dest[dest->channel]), msg) == 0)
+				return;
+			link_down(link);
+		}
+	}
+
+	fprintf(stderr, "[sender] every link failed\n");
+	exit(10);
+}
+
+// send a packet from the main thread, through the transmit thread when pipelined
+void emit(destination_t *dest, packet_t *msg, unsigned char *pack, uint32_t delay) {
+	if(PIPE != NULL) {
+		ring_t *ring = &(PIPE->rings[PIPE->seq % PIPE->encoders]);
+		slot_t *slot = ring_reserve(ring);
+		slot->type = SLOT_PACKET;
+		slot->count = 1;
+		slot->delay = delay;
+		slot->copy = 0;
+		slot->dest[0] = dest;
+		serialize(*msg, slot->pack[0]);
+		ring_push(ring);
+		PIPE->seq++;
+		return;
+	}
+
+	serialize(*msg, pack);
+	send_slice(dest, pack, 0);
+	if(delay)
+		usleep(delay);
+}
+
+// send the transfer descriptor on the checksum channel
+void send_descriptor(packet_t *msg, unsigned char *pack, unsigned char *metabuf, destination_t *dest_check) {
+	msg->part_no = META_PART;
+	msg->data = metabuf;
+	emit(dest_check, msg, pack, 0);
+}
+
+// transmit thread: the only one pacing and sending while pipelined
+void *transmit_routine(void *arg) {
+	pipeline_t *pipe = (pipeline_t *)arg;
+	uint64_t seq = 0;
+
+	for(;;) {
+		ring_t *ring = &(pipe->rings[seq % pipe->encoders]);
+		slot_t *slot = ring_peek(ring);
+		if(slot->type == SLOT_QUIT) {
+			ring_pop(ring);
+			break;
+		}
+		if(slot->type == SLOT_END) {
+			// every encoder closed the block, their END slots are next in all rings
+			for(uint32_t i=0; i<pipe->encoders; i++) {
+				ring_peek(&(pipe->rings[i]));
+				ring_pop(&(pipe->rings[i]));
+			}
+			seq = 0;
+			continue;
+		}
+
+		for(uint8_t i=0; i<slot->count; i++)
+			send_slice(slot->dest[i], slot->pack[i], slot->copy);
+		if(slot->delay)
+			usleep(slot->delay);
+		ring_pop(ring);
+		seq++;
+	}
+
+	return NULL;
+}
+
+// encoders wait for the reader thread before touching slices it has not read yet
+void wait_ready(pipeline_t *pipe, uint32_t slices) {
+	while(atomic_load_explicit(&(pipe->ready), memory_order_acquire) < slices)
+		usleep(50);
+}
+
+// encoder thread: walks the whole transmit plan, builds only its own share of the steps
+void *encode_routine(void *arg) {
+	encoder_arg_t *enc = (encoder_arg_t *)arg;
+	pipeline_t *pipe = enc->pipe;
+	ring_t *ring = &(pipe->rings[enc->id]);
+	packet_t msg = pipe->msg;
+	unsigned char databuf[DATALEN];
+	uint64_t step = pipe->first;
+	uint8_t sequential = 1;
+	uint32_t part;
+
+	txplan_t plan;
+	txplan_init(&plan, pipe->len, pipe->index, CLEAR_SPRAY, SPRAY, pipe->checksums, pipe->hash + pipe->b,
+		INTERLEAVE_DEPTH ? INTERLEAVE_DEPTH : XOR_GROUP_SIZE);
+	tx_stream_t stream;
+
+	while((stream = txplan_next(&plan, &part)) != TX_DONE) {
+		if(stream == TX_PAUSE)
+			sequential = 0;
+		if(step++ % pipe->encoders != enc->id)
+			continue;
+
+		slot_t *slot = ring_reserve(ring);
+		slot->type = SLOT_PACKET;
+		slot->count = 1;
+		slot->delay = 0;
+		slot->copy = plan.copy;
+		msg.part_no = pipe->base + part;
+		switch(stream) {
+		case TX_PAUSE:
+			slot->count = 0;
+			if(pipe->block == NULL)
+				slot->delay = 500000; // wait half a second
+			break;
+		case TX_CHECKSUM:
+			wait_ready(pipe, pipe->len);
+			msg.part_no = 0;
+			msg.data = pipe->checksum;
+			serialize(msg, slot->pack[0]);
+			slot->dest[0] = pipe->dest_check;
+			// descriptor rides along with every checksum
+			msg.part_no = META_PART;
+			msg.data = pipe->metabuf;
+			serialize(msg, slot->pack[1]);
+			slot->dest[1] = pipe->dest_check;
+			slot->count = 2;
+			break;
+		case TX_CLEAR:
+			if(pipe->block != NULL)
+				memcpy(databuf, pipe->block + (size_t)(part - 1) * DATALEN, DATALEN);
+			else {
+				if(sequential)
+					wait_ready(pipe, part);
+				fill_clear_data(pipe->fd, msg.part_no - 1, databuf);
+			}
+			msg.data = databuf;
+			serialize(msg, slot->pack[0]);
+			slot->dest[0] = pipe->dest_clear;
+			if(sequential)
+				slot->delay = 100;
+			break;
+		case TX_XOR:
+			if(pipe->block != NULL)
+				fill_xor_block(pipe->block, pipe->index, part - 1, pipe->len, databuf);
+			else
+				fill_xor_data(pipe->fd, pipe->index, part - 1, pipe->len, databuf);
+			msg.data = databuf;
+			serialize(msg, slot->pack[0]);
+			slot->dest[0] = pipe->dest_xored;
+			break;
+		default:
+			break;
+		}
+		ring_push(ring);
+	}
+
+	slot_t *slot = ring_reserve(ring);
+	slot->type = SLOT_END;
+	ring_push(ring);
+
+	txplan_free(&plan);
+	free(enc);
+	return NULL;
+}
+
+// hand a block to the encoders, the caller may read the next block until encode_join()
+void encode_start(int fd, unsigned char *block, uint32_t base, uint32_t len, uint32_t b, uint32_t hash, uint32_t checksums,
+	packet_t *msg, unsigned char *checksum, unsigned char *metabuf,
+	destination_t *dest_clear, destination_t *dest_xored, destination_t *dest_check) {
+	pipeline_t *pipe = PIPE;
+
+	// the fountain shuffle uses the global generator, build it here
+	prepare_fountain(&(pipe->index), NULL, len, b);
+	pipe->fd = fd;
+	pipe->block = block;
+	pipe->base = base;
+	pipe->len = len;
+	pipe->b = b;
+	pipe->hash = hash;
+	pipe->checksums = checksums;
+	pipe->first = pipe->seq;
+	pipe->msg = *msg;
+	pipe->checksum = checksum;
+	pipe->metabuf = metabuf;
+	pipe->dest_clear = dest_clear;
+	pipe->dest_xored = dest_xored;
+	pipe->dest_check = dest_check;
+
+	for(uint32_t i=0; i<pipe->encoders; i++) {
+		encoder_arg_t *enc = (encoder_arg_t *)malloc(sizeof(encoder_arg_t));
+		if(enc == NULL) {
+			perror("[sender] encoder failed to allocate\n");
+			exit(21);
+		}
+		enc->pipe = pipe;
+		enc->id = i;
+		if(pthread_create(&(pipe->threads[i]), NULL, encode_routine, enc) != 0) {
+			perror("[sender] pthread_create failed for encoder");
+			exit(22);
+		}
+	}
+}
+
+// wait for the encoders of the current block, its packets may still be queued for the transmit thread
+void encode_join() {
+	pipeline_t *pipe = PIPE;
+
+	for(uint32_t i=0; i<pipe->encoders; i++)
+		pthread_join(pipe->threads[i], NULL);
+	free(pipe->index);
+
+	// the END slots restart the transmit order
+	pipe->seq = 0;
+}
+
+// reader thread of a whole file transfer: sequential prefetch, builds the checksum ahead of the encoders
+typedef struct {
+	pipeline_t *pipe;
+	int fd;
+	uint32_t slices;
+	unsigned char *checksum;
+} reader_arg_t;
+
+void *reader_routine(void *arg) {
+	reader_arg_t *rd = (reader_arg_t *)arg;
+	unsigned char *buf = (unsigned char *)malloc((size_t)READ_CHUNK * DATALEN);
+	if(buf == NULL) {
+		perror("[sender] reader failed to allocate\n");
+		exit(23);
+	}
+	posix_fadvise(rd->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	for(uint32_t part=0; part<rd->slices; part+=READ_CHUNK) {
+		uint32_t n = (rd->slices - part < READ_CHUNK) ? rd->slices - part : READ_CHUNK;
+		// keep the next chunk on its way while this one is xored
+		readahead(rd->fd, (off_t)(part + n) * DATALEN, (size_t)READ_CHUNK * DATALEN);
+		size_t done = 0;
+		ssize_t r = 0;
+		while(done < (size_t)n * DATALEN && (r = pread(rd->fd, buf + done, (size_t)n * DATALEN - done, (off_t)part * DATALEN + done)) > 0)
+			done += r;
+		if(r < 0) {
+			perror("[sender] reader failed");
+			exit(24);
+		}
+		memset(buf + done, 0, (size_t)n * DATALEN - done);
+		add_checksum(buf, n, rd->checksum);
+		atomic_store_explicit(&(rd->pipe->ready), part + n, memory_order_release);
+	}
+
+	free(buf);
+	return NULL;
+}
+
+void pipeline_start(uint32_t encoders) {
+	PIPE = (pipeline_t *)calloc(1, sizeof(pipeline_t));
+	if(PIPE == NULL) {
+		perror("[sender] pipeline failed to allocate\n");
+		exit(21);
+	}
+	PIPE->encoders = encoders;
+	PIPE->rings = (ring_t *)malloc(encoders * sizeof(ring_t));
+	PIPE->threads = (pthread_t *)malloc(encoders * sizeof(pthread_t));
+	if(PIPE->rings == NULL || PIPE->threads == NULL) {
+		perror("[sender] pipeline failed to allocate\n");
+		exit(21);
+	}
+	for(uint32_t i=0; i<encoders; i++) {
+		if(ring_init(&(PIPE->rings[i]), RING_SLOTS, sizeof(slot_t)) == -1) {
+			perror("[sender] ring failed to allocate\n");
+			exit(21);
+		}
+	}
+	atomic_init(&(PIPE->ready), UINT32_MAX);
+
+	if(pthread_create(&(PIPE->transmit), NULL, transmit_routine, PIPE) != 0) {
+		perror("[sender] pthread_create failed for transmit");
+		exit(22);
+	}
+}
+
+// drain the rings and stop the transmit thread
+void pipeline_stop() {
+	ring_t *ring = &(PIPE->rings[PIPE->seq % PIPE->encoders]);
+	slot_t *slot = ring_reserve(ring);
+	slot->type = SLOT_QUIT;
+	ring_push(ring);
+	pthread_join(PIPE->transmit, NULL);
+
+	for(uint32_t i=0; i<PIPE->encoders; i++)
+		ring_free(&(PIPE->rings[i]));
+	free(PIPE->rings);
+	free(PIPE->threads);
+	free(PIPE);
+	PIPE = NULL;
+}
+
+// encode and send one source block: sequential pass in file order, then clear/xor/checksum mix interleaved against burst losses
+// block holds the slices in memory, NULL reads them from fd (whole file as a single block)
+void send_block(int fd, unsigned char *block, uint32_t base, uint32_t len, uint32_t b, uint32_t hash, uint32_t checksums,
+	packet_t *msg, unsigned char *pack, unsigned char *databuf, unsigned char *checksum, unsigned char *metabuf,
+	destination_t *dest_clear, destination_t *dest_xored, destination_t *dest_check) {
+	if(PIPE != NULL) {
+		encode_start(fd, block, base, len, b, hash, checksums, msg, checksum, metabuf, dest_clear, dest_xored, dest_check);
+		encode_join();
+		return;
+	}
+
+	uint32_t *index = NULL;
+	uint32_t part;
+	prepare_fountain(&index, NULL, len, b);
+
+	txplan_t plan;
+	txplan_init(&plan, len, index, CLEAR_SPRAY, SPRAY, checksums, hash + b,
+		INTERLEAVE_DEPTH ? INTERLEAVE_DEPTH : XOR_GROUP_SIZE);
+	tx_stream_t stream;
+	uint8_t sequential = 1;
+
+	while((stream = txplan_next(&plan, &part)) != TX_DONE) {
+		msg->part_no = base + part;
+		switch(stream) {
+		case TX_PAUSE:
+			sequential = 0;
+			if(block != NULL)
+				break;
+			fprintf(stderr, "Sent the sequencial packets.\n");
+			fprintf(stderr, "Wait half a second...\n");
+			usleep(500000); // wait half a second
+			fprintf(stderr, "Now sending interleaved clear/XORed packets mix + checksum\n");
+			break;
+		case TX_CHECKSUM:
+			msg->part_no = 0;
+			msg->data = checksum;
+			serialize(*msg, pack);
+			send_slice(dest_check, pack, 0);
+			// descriptor rides along with every checksum
+			send_descriptor(msg, pack, metabuf, dest_check);
+			break;
+		case TX_CLEAR:
+			// part numbers are numbered from 1
+			if(block != NULL)
+				memcpy(databuf, block + (size_t)(part - 1) * DATALEN, DATALEN);
+			else {
+				fill_clear_data(fd, msg->part_no - 1, databuf);
+				// the sequential pass reads every slice once, the checksum is complete before the first checksum packet
+				if(sequential)
+					add_checksum(databuf, 1, checksum);
+			}
+			msg->data = databuf;
+			serialize(*msg, pack);
+			// send over clear channel, this call must be bw paced
+			send_slice(dest_clear, pack, plan.copy);
+			if(sequential)
+				usleep(100);
+			break;
+		case TX_XOR:
+			if(block != NULL)
+				fill_xor_block(block, index, part - 1, len, databuf);
+			else
+				fill_xor_data(fd, index, part - 1, len, databuf);
+			msg->data = databuf;
+			serialize(*msg, pack);
+			send_slice(dest_xored, pack, plan.copy);
+			break;
+		default:
+			break;
+		}
+	}
+
+	txplan_free(&plan);
+	free(index);
+}
+
+// checksum of a windowed transfer is complete after the last block, then EOF packets trigger the recovery
+void send_trailer(packet_t *msg, unsigned char *pack, unsigned char *checksum, unsigned char *metabuf, uint8_t windowed,
+	destination_t *dest_check) {
+	for(uint32_t i=0; windowed && i<20; i++) {
+		msg->part_no = 0;
+		msg->data = checksum;
+		emit(dest_check, msg, pack, 0);
+		send_descriptor(msg, pack, metabuf, dest_check);
+	}
+
+	fprintf(stderr, "Done sending shuffled clear/XORed packets mix.\n");
+	fprintf(stderr, "Now sending 1000 EOF packets for 10 seconds..\n");
+	// send EOF packet 
+	for(uint32_t j=0; j<10000; j++)
+	{
+		msg->part_no = (unsigned)(-1);
+		msg->data = checksum;
+		emit(dest_check, msg, pack, 1000); // could use send_slice paced at 70 Mbps
+	}
+	
+	fprintf(stderr, "Finished sending EOF.\n");
+	fprintf(stderr, "Done.\n");
+}
+
+// the cheapest redundancy meeting the loss profile replaces XOR_GROUP_SIZE, CLEAR_SPRAY and SPRAY
+void plan_parameters(uint32_t slices) {
+	// a spool sends many objects, the plan of the previous one is not the fallback of the next
+	XOR_GROUP_SIZE = ARG_XOR_GROUP_SIZE;
+	CLEAR_SPRAY = ARG_CLEAR_SPRAY;
+	SPRAY = ARG_SPRAY;
+	redundancy_t r = { XOR_GROUP_SIZE, CLEAR_SPRAY, SPRAY, 0, 1.0 };
+	int ret = plan_redundancy(slices, &LOSS_MODEL, INTERLEAVE_DEPTH, &r);
+	if(ret == -2) {
+		fprintf(stderr, "[sender] planner: target %g is below what the simulation can show for %u slices, keeping xor-size=%u spray=%u\n",
+			LOSS_MODEL.target, slices, XOR_GROUP_SIZE, SPRAY);
+		return;
+	}
+	if(ret == -1) {
+		fprintf(stderr, "[sender] planner found no parameters for target %g, keeping xor-size=%u spray=%u\n",
+			LOSS_MODEL.target, XOR_GROUP_SIZE, SPRAY);
+		return;
+	}
+	XOR_GROUP_SIZE = r.xor_group_size;
+	CLEAR_SPRAY = r.clear_spray;
+	SPRAY = r.spray;
+	printf("[INFO] planner loss=%g burst=%g: xor-size=%u clear-spray=%u spray=%u p_fail=%g p_fail<=%g\n", 
+		LOSS_MODEL.loss, LOSS_MODEL.burst, XOR_GROUP_SIZE, CLEAR_SPRAY, SPRAY, r.p_fail, r.p_bound);
 }
 
 // send over the file with clear, xored and checksum type packets
@@ -341,29 +995,53 @@ void send_file(char *file_path, destination_t *dest_clear, destination_t *dest_x
 	}
 	uint32_t slices = (st.st_size + (DATALEN - 1))/ DATALEN; //round up
 
-	// prepare file for processing
-	int fd = open(file_path, O_RDONLY);
-	if(fd == -1) {
-		perror("[sender] open failed");
-		exit(12);
-	}
-	
-	// build checksum
-	unsigned char *checksum = get_checksum(fd, slices);
+	// pick the cheapest redundancy meeting the loss profile
+	if(PLANNER)
+		plan_parameters(slices > 0 ? slices : 1);
 
 	uint32_t len = strlen(file_path); 	
 	uint32_t hash = fnv_hash(file_path, len);
-	srand(hash); 
 
 	// file too small pad with zeroes
 	if(slices < XOR_GROUP_SIZE) {
 		slices = XOR_GROUP_SIZE;
 	}
-	printf("[INFO] %s file_size=%lu slices=%u\n", file_path, st.st_size, slices);
 
-	// prepare indices for fountain codes
-	uint32_t *index = prepare_fountain(slices);
-	
+	// windowed mode: source blocks of WINDOW_SLICES slices with local xor groups, read once and sent one after the other
+	uint32_t window = (WINDOW_SLICES > 0 && WINDOW_SLICES < XOR_GROUP_SIZE) ? XOR_GROUP_SIZE : WINDOW_SLICES;
+	uint32_t blocks = block_count(slices, window);
+	uint8_t windowed = (blocks > 1);
+	printf("[INFO] %s file_size=%lu slices=%u blocks=%u\n", file_path, st.st_size, slices, blocks);
+
+	// prepare file for processing, only whole source blocks can bypass the page cache
+	int fd = -1;
+	if(windowed && DIRECT_IO && (fd = open(file_path, O_RDONLY | O_DIRECT)) == -1 && errno == EINVAL) {
+		fprintf(stderr, "[sender] O_DIRECT not supported for %s, using the page cache\n", file_path);
+		DIRECT_IO = 0;
+	}
+	if(fd == -1 && (fd = open(file_path, O_RDONLY)) == -1) {
+		perror("[sender] open failed");
+		exit(12);
+	}
+	if(!DIRECT_IO || !windowed)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	// checksum is built while the slices are read for the first time, the first packet goes out right away
+	unsigned char *checksum = (unsigned char *)calloc(DATALEN, sizeof(char));
+	// windowed: two buffers, the next block is read while the encoders work on the current one
+	// the last block takes the remainder, at most 2*window-1 slices
+	unsigned char *buf[2] = { NULL, NULL };
+	for(uint8_t i=0; windowed && i<2; i++) {
+		if(posix_memalign((void **)&(buf[i]), DIRECT_ALIGN, (size_t)2 * window * DATALEN + 2 * DIRECT_ALIGN) != 0) {
+			perror("[sender] source block failed to allocate\n");
+			exit(7);
+		}
+	}
+	if(checksum == NULL) {
+		perror("[sender] checksum failed to allocate\n");
+		exit(7);
+	}
+
 	/* BUILD DATA PACKETS */
 	packet_t msg;
 	unsigned char *pack = (unsigned char *)malloc(MAXBUFLEN * sizeof(char));
@@ -377,10 +1055,10 @@ void send_file(char *file_path, destination_t *dest_clear, destination_t *dest_x
 	p = strrchr(file_path, '/'); 
 	if(p == NULL) p = file_path;
 	else p++;
-	msg.file_path = p;
+	msg.file_path = (SPOOL_MEMBER != NULL) ? SPOOL_OBJECT : p;
 	
-	// add total file size
-	msg.file_size = st.st_size;
+	// add total file size, larger files are described by the transfer descriptor
+	msg.file_size = (st.st_size > UINT32_MAX) ? UINT32_MAX : st.st_size;
 
 	// allocate message field
 	unsigned char *databuf = (unsigned char *)malloc(DATALEN * sizeof(char));
@@ -388,94 +1066,88 @@ void send_file(char *file_path, destination_t *dest_clear, destination_t *dest_x
 		perror("[sender] msg.data failed to allocate\n");
 		exit(14);
 	}
+
+	// transfer descriptor, tells recovery the xor group size chosen for this file
+	unsigned char *metabuf = (unsigned char *)calloc(DATALEN, sizeof(char));
+	if(metabuf == NULL) {
+		perror("[sender] meta failed to allocate\n");
+		exit(14);
+	}
+	meta_t meta = { META_VERSION, XOR_GROUP_SIZE, SPRAY, CLEAR_SPRAY, TRANSFER_FLAGS, st.st_size, window };
+	if(SPOOL_MEMBER != NULL)
+		meta.flags |= META_SPOOL;
+	meta_serialize(&meta, metabuf);
+	if(SPOOL_MEMBER != NULL)
+		spool_serialize(metabuf, SPOOL_MEMBER->mode, SPOOL_MEMBER->mtime, SPOOL_MEMBER->name);
+	send_descriptor(&msg, pack, metabuf, dest_check);
 	
-    /* === NEW LOOP: Send the full file in clear, sequentially === */
-	for (uint32_t s = 0; s < slices; s++) {
-		msg.part_no = s + 1;  
-		// Use slice index+1 as part number (parts are numbered from 1)
-		fill_clear_data(fd, msg.part_no - 1, databuf);  
-		msg.data = databuf;
-		// Read the slice from file at position s
-		serialize(msg, pack);  
-     		// Build the packet (file id, size, part number, and data)
-		send_slice(dest_clear->socketfd, pack, dest_clear->dest);  
-		// Send over clear channel, this call must be bw paced
-		usleep(100); //usleep(100);
-	}
-
-	fprintf(stderr, "Sent the sequencial packets.\n");
-	fprintf(stderr, "Wait half a second...\n");
-	usleep(500000); // wait half a second
-	fprintf(stderr, "Now sending shuffled clear/XORed packets mix + checksum\n");
-
-	// add part number and content corresponding to each slice
-	uint32_t rounds = (slices + (10 - 1))/ 10;		// 10% of the slices rounded up
-	uint32_t parts1 = 0, parts2 = 0;
-
-	// send: checksum -> 10% clear -> checksum -> 10% xored | repeat 10 times
-	for(uint32_t i=0; i<10; i++) {	
-		
-		{	
-			// send checksum
-			msg.part_no = 0;
-			msg.data = checksum;
-			serialize(msg, pack);
-			send_slice(dest_check -> socketfd, pack, dest_check -> dest);
+	// pipelined whole file: the reader thread builds the checksum, encoders send it once complete
+	pthread_t reader;
+	reader_arg_t rd = { PIPE, fd, slices, checksum };
+	if(PIPE != NULL && !windowed) {
+		atomic_store(&(PIPE->ready), 0);
+		if(pthread_create(&reader, NULL, reader_routine, &rd) != 0) {
+			perror("[sender] pthread_create failed for reader");
+			exit(22);
 		}
-		
-		// send packets in clear ; make CLEAR_SPRAY=1 here
-		msg.data = databuf;
-		for(uint32_t j=0; j<rounds*CLEAR_SPRAY; j++) {
-			if(parts1 >= slices*CLEAR_SPRAY) 	// skip rest of the cycle if already sent all packets
-				break;
-			//msg.part_no = i*rounds + j + 1; ---> for in order transmission
-			msg.part_no = rand() % slices + 1;
-			fill_clear_data(fd, msg.part_no - 1, databuf);	
-			serialize(msg, pack);
-			send_slice(dest_clear -> socketfd, pack, dest_clear -> dest);
-			parts1++;
+	}
+
+	/* per block: sequential pass in file order, then clear/xor/checksum mix interleaved against burst losses */
+	uint32_t base, blen;
+	unsigned char *block = NULL;
+	if(windowed) {
+		block_range(slices, window, 0, &base, &blen);
+		block = read_block(fd, base, blen, buf[0], checksum);
+	}
+	for(uint32_t b=0; b<blocks; b++) {
+		unsigned char *next = NULL;
+		block_range(slices, window, b, &base, &blen);
+
+		// ask the kernel for the block after the next one
+		if(windowed && !DIRECT_IO && b + 2 < blocks) {
+			uint32_t abase, alen;
+			block_range(slices, window, b + 2, &abase, &alen);
+			posix_fadvise(fd, (off_t)abase * DATALEN, (off_t)alen * DATALEN, POSIX_FADV_WILLNEED);
 		}
-		
-		{	
-			// send checksum
-			msg.part_no = 0;
-			msg.data = checksum;
-			serialize(msg, pack);
-			send_slice(dest_check -> socketfd, pack, dest_check -> dest);
+
+		// the checksum of a windowed file is only complete after the last block
+		if(PIPE != NULL) {
+			encode_start(fd, block, base, blen, b, hash, windowed ? 0 : 20, &msg, checksum, metabuf, 
+				dest_clear, dest_xored, dest_check);
 		}
-		
-		// send packets in xor mode
-		msg.data = databuf;
-		for(uint32_t j=0; j<rounds*SPRAY; j++) {
-			if(parts2 >= slices*SPRAY) 	// skip rest of the cycle if already sent all packets
-				break;
-			//msg.part_no = i*rounds + j + 1; ---> for in order transmission
-			msg.part_no = rand() % slices + 1;
-			fill_xor_data(fd, index, msg.part_no-1, slices, databuf);	
-			serialize(msg, pack);
-			send_slice(dest_xored -> socketfd, pack, dest_xored -> dest);
-			parts2++;
+		else
+			send_block(fd, block, base, blen, b, hash, windowed ? 0 : 20, &msg, pack, databuf, checksum, metabuf, 
+				dest_clear, dest_xored, dest_check);
+
+		if(windowed && b + 1 < blocks) {
+			uint32_t nbase, nlen;
+			block_range(slices, window, b + 1, &nbase, &nlen);
+			next = read_block(fd, nbase, nlen, buf[(b + 1) % 2], checksum);
+		}
+		if(PIPE != NULL)
+			encode_join();
+		block = next;
+
+		if(windowed) {
+			#ifdef DEBUG2
+				fprintf(stderr, "Sent block %u/%u.\n", b + 1, blocks);
+			#endif
+			send_descriptor(&msg, pack, metabuf, dest_check);
 		}
 	}
 
-	fprintf(stderr, "Done sending shuffled clear/XORed packets mix.\n");
-	fprintf(stderr, "Now sending 1000 EOF packets for 10 seconds..\n");
-	// send EOF packet 
-	for(uint32_t j=0; j<10000; j++)
-	{
-		msg.part_no = (unsigned)(-1);
-		msg.data = checksum;
-		serialize(msg, pack);
-		send_slice(dest_check -> socketfd, pack, dest_check -> dest);
-		usleep(1000); // could use send_slice paced at 70 Mbps
+	if(PIPE != NULL && !windowed) {
+		pthread_join(reader, NULL);
+		atomic_store(&(PIPE->ready), UINT32_MAX);
 	}
-	
-	fprintf(stderr, "Finished sending EOF.\n");
-	fprintf(stderr, "Done.\n");
 
+	send_trailer(&msg, pack, checksum, metabuf, windowed, dest_check);
+	
 	/* CLEAN UP */
-	free(index);
+	free(buf[0]);
+	free(buf[1]);
 	free(databuf);
+	free(metabuf);
 	free(checksum);
 	free(pack);
 	
@@ -485,40 +1157,706 @@ void send_file(char *file_path, destination_t *dest_clear, destination_t *dest_x
 	}
 }
 
+// fill buf from a pipe, returns the number of bytes read, less than size only at the end of the stream
+size_t read_stream(int fd, unsigned char *buf, size_t size) {
+	size_t done = 0;
+	ssize_t n = 0;
+
+	while(done < size && (n = read(fd, buf + done, size - done)) > 0)
+		done += n;
+	if(n < 0) {
+		perror("[sender] read_stream failed");
+		exit(20);
+	}
+
+	return done;
+}
+
+// send a pipe of unknown length in one pass: source blocks are sent as soon as the next window is buffered,
+// so the block layout matches block_range() once the total is known
+void send_stream(int fd, char *name, destination_t *dest_clear, destination_t *dest_xored, destination_t *dest_check) {
+	uint32_t window = WINDOW_SLICES ? WINDOW_SLICES : STREAM_WINDOW;
+	if(window < XOR_GROUP_SIZE)
+		window = XOR_GROUP_SIZE;
+
+	if(PLANNER) {
+		plan_parameters(window);
+		if(window < XOR_GROUP_SIZE)
+			window = XOR_GROUP_SIZE;
+	}
+
+	uint32_t hash = fnv_hash(name, strlen(name));
+	size_t wsize = (size_t)window * DATALEN;
+	unsigned char *block = (unsigned char *)malloc(2 * wsize);
+	unsigned char *checksum = (unsigned char *)calloc(DATALEN, sizeof(char));
+	unsigned char *pack = (unsigned char *)malloc(MAXBUFLEN * sizeof(char));
+	unsigned char *databuf = (unsigned char *)malloc(DATALEN * sizeof(char));
+	unsigned char *metabuf = (unsigned char *)calloc(DATALEN, sizeof(char));
+	if(block == NULL || checksum == NULL || pack == NULL || databuf == NULL || metabuf == NULL) {
+		perror("[sender] stream buffers failed to allocate\n");
+		exit(7);
+	}
+
+	packet_t msg;
+	msg.file_path = name;
+	msg.file_size = 0;
+	meta_t meta = { META_VERSION, XOR_GROUP_SIZE, SPRAY, CLEAR_SPRAY, META_STREAM, 0, window };
+	meta_serialize(&meta, metabuf);
+	send_descriptor(&msg, pack, metabuf, dest_check);
+
+	uint32_t base = 0;
+	size_t have = 0;
+	for(uint32_t b=0; ; b++) {
+		have += read_stream(fd, block + have, 2 * wsize - have);
+
+		// keep a whole window buffered behind the block, the last block takes the remainder
+		if(have == 2 * wsize) {
+			add_checksum(block, window, checksum);
+			send_block(fd, block, base, window, b, hash, 0, &msg, pack, databuf, checksum, metabuf,
+				dest_clear, dest_xored, dest_check);
+			base += window;
+			memmove(block, block + wsize, wsize);
+			have = wsize;
+		}
+		else {
+			uint32_t len = (have + (DATALEN - 1)) / DATALEN;
+			// stream too small pad with zeroes
+			if(base + len < XOR_GROUP_SIZE)
+				len = XOR_GROUP_SIZE - base;
+			memset(block + have, 0, (size_t)len * DATALEN - have);
+			add_checksum(block, len, checksum);
+			meta.file_size = (uint64_t)base * DATALEN + have;
+			send_block(fd, block, base, len, b, hash, 0, &msg, pack, databuf, checksum, metabuf,
+				dest_clear, dest_xored, dest_check);
+			printf("[INFO] %s stream_size=%lu slices=%u blocks=%u\n", name, meta.file_size, base + len, b + 1);
+			break;
+		}
+
+		// tell the receiver how far the stream got
+		meta.file_size = (uint64_t)base * DATALEN;
+		meta_serialize(&meta, metabuf);
+		send_descriptor(&msg, pack, metabuf, dest_check);
+		#ifdef DEBUG2
+			fprintf(stderr, "Sent block %u, %lu bytes.\n", b + 1, meta.file_size);
+		#endif
+	}
+
+	// final size goes with the checksum
+	msg.file_size = (meta.file_size > UINT32_MAX) ? UINT32_MAX : meta.file_size;
+	meta_serialize(&meta, metabuf);
+	send_trailer(&msg, pack, checksum, metabuf, 1, dest_check);
+
+	free(block);
+	free(databuf);
+	free(metabuf);
+	free(checksum);
+	free(pack);
+}
+
+// interface[,peer-mac][,xdp|packet]
+void open_raw(rawtx_t *tx, char *spec, struct sockaddr_in *dest) {
+	char ifname[IF_NAMESIZE] = { 0 };
+	unsigned char mac[6];
+	uint8_t has_mac = 0;
+	uint8_t mode = RAWTX_AUTO;
+	char *copy = strdup(spec);
+	char *token = strtok(copy, ",");
+
+	if(token == NULL) {
+		fprintf(stderr, "[sender] invalid raw backend %s\n", spec);
+		exit(16);
+	}
+	strncpy(ifname, token, IF_NAMESIZE - 1);
+	while((token = strtok(NULL, ",")) != NULL) {
+		if(strcmp(token, "xdp") == 0)
+			mode = RAWTX_XDP;
+		else if(strcmp(token, "packet") == 0)
+			mode = RAWTX_PACKET;
+		else if(parse_mac(token, mac) == 0)
+			has_mac = 1;
+		else {
+			fprintf(stderr, "[sender] invalid raw backend option %s\n", token);
+			exit(16);
+		}
+	}
+	free(copy);
+
+	if(rawtx_open(tx, ifname, dest->sin_addr.s_addr, has_mac ? mac : NULL, mode) == -1) {
+		if(errno == EHOSTUNREACH)
+			fprintf(stderr, "[sender] no static ARP entry for the receiver on %s, set one or give the MAC\n", ifname);
+		perror("[sender] raw transmit backend failed");
+		exit(24);
+	}
+	printf("[INFO] raw transmit on %s with %s\n", ifname, tx->mode == RAWTX_XDP ? "AF_XDP" : "TPACKET_V3");
+	RAWTX = tx;
+}
+
+// -C: manifest of the chunks sent so far, serialized between transfers by a lock file next to it
+char *MANIFEST_PATH = NULL;
+uint32_t MANIFEST_REFRESH = DELTA_REFRESH;
+
+static int manifest_lock() {
+	char lock_path[PATH_MAX + 8];
+	snprintf(lock_path, sizeof(lock_path), "%s.lock", MANIFEST_PATH);
+	int fd = open(lock_path, O_RDWR | O_CREAT, 0600);
+	if(fd == -1 || flock(fd, LOCK_EX) == -1) {
+		perror("[sender] manifest lock failed");
+		exit(26);
+	}
+	return fd;
+}
+
+// -C: write the delta object of file_path to out against the manifest, returns the manifest with the chunks sent
+static void make_delta(char *file_path, int out, manifest_t *m) {
+	delta_stats_t stats;
+
+	int lock = manifest_lock();
+	if(manifest_load(m, MANIFEST_PATH) == -1) {
+		perror("[sender] manifest load failed");
+		exit(26);
+	}
+	close(lock);
+
+	int in = open(file_path, O_RDONLY);
+	if(in == -1) {
+		perror("[sender] open failed for delta");
+		exit(26);
+	}
+	posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+	if(delta_write(in, out, m, MANIFEST_REFRESH, &stats) == -1) {
+		perror("[sender] delta failed");
+		exit(26);
+	}
+	close(in);
+	printf("[INFO] %s delta: %lu of %lu chunks, %lu -> %lu bytes\n", file_path, stats.sent, stats.chunks, stats.raw,
+		stats.packed);
+}
+
+// after the transfer: the chunks it carried count as delivered, entries of every other file stay as they are
+static void commit_delta(manifest_t *m) {
+	manifest_t disk;
+
+	int lock = manifest_lock();
+	if(manifest_load(&disk, MANIFEST_PATH) == -1) {
+		perror("[sender] manifest load failed");
+		exit(26);
+	}
+	disk.transfers++;
+	if(manifest_merge(&disk, m) == -1 || manifest_save(&disk, MANIFEST_PATH) == -1)
+		goto fail;
+	manifest_free(&disk);
+	manifest_free(m);
+	close(lock);
+	return;
+
+fail:
+	perror("[sender] manifest save failed");
+	exit(26);
+}
+
+/* send a file, with -C as a delta object and with -Z as a chunked compressed object (of the delta object), both
+ * under the same name; what was done travels in the descriptor flags. Files that do not shrink by at least 1/32
+ * are not compressed */
+void send_object(char *file_path, destination_t *dest_clear, destination_t *dest_xored, destination_t *dest_check) {
+	char tmpdir[PATH_MAX], delta_path[2 * PATH_MAX], packed_path[2 * PATH_MAX];
+	uint64_t raw = 0, packed = 0;
+	manifest_t m;
+
+	TRANSFER_FLAGS = 0;
+	if(CODEC == CODEC_NONE && MANIFEST_PATH == NULL) {
+		send_file(file_path, dest_clear, dest_xored, dest_check);
+		return;
+	}
+
+	char *tmp = getenv("TMPDIR");
+	snprintf(tmpdir, sizeof(tmpdir), "%s/datadiode.XXXXXX", (tmp != NULL) ? tmp : "/tmp");
+	if(mkdtemp(tmpdir) == NULL) {
+		perror("[sender] staging directory failed");
+		exit(25);
+	}
+	char *p = strrchr(file_path, '/');
+	char *name = (p == NULL) ? file_path : p + 1;
+	snprintf(delta_path, sizeof(delta_path), "%s/delta", tmpdir);
+	snprintf(packed_path, sizeof(packed_path), "%s/%s", tmpdir, name);
+
+	char *source = file_path;
+	if(MANIFEST_PATH != NULL) {
+		int out = open(delta_path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+		if(out == -1) {
+			perror("[sender] open failed for delta");
+			exit(26);
+		}
+		make_delta(file_path, out, &m);
+		close(out);
+		source = delta_path;
+		TRANSFER_FLAGS |= META_DELTA;
+	}
+
+	if(CODEC != CODEC_NONE) {
+		int in = open(source, O_RDONLY);
+		int out = open(packed_path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+		if(in == -1 || out == -1) {
+			perror("[sender] open failed for compression");
+			exit(25);
+		}
+		posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+		if(compress_file(in, out, CODEC, CODEC_LEVEL, &raw, &packed) == -1) {
+			perror("[sender] compression failed");
+			exit(25);
+		}
+		close(in);
+		close(out);
+
+		if(packed + packed / 32 < raw) {
+			printf("[INFO] %s %s: %lu -> %lu bytes\n", file_path, codec_name(CODEC), raw, packed);
+			TRANSFER_FLAGS |= (uint32_t)CODEC << META_CODEC_SHIFT;
+			unlink(delta_path);
+			source = packed_path;
+		}
+		else {
+			printf("[INFO] %s does not compress (%lu -> %lu bytes), sent as is\n", file_path, raw, packed);
+			unlink(packed_path);
+		}
+	}
+
+	// the object goes out under the name of the file
+	if(source == delta_path && rename(delta_path, packed_path) == -1) {
+		perror("[sender] staging failed");
+		exit(26);
+	}
+	send_file((source == file_path) ? file_path : packed_path, dest_clear, dest_xored, dest_check);
+	TRANSFER_FLAGS = 0;
+
+	if(MANIFEST_PATH != NULL)
+		commit_delta(&m);
+	unlink(packed_path);
+	rmdir(tmpdir);
+}
+
+// files of the spool directory, collected by nftw
+bundle_entry_t *SPOOL = NULL;
+uint32_t SPOOL_COUNT = 0, SPOOL_CAP = 0;
+size_t SPOOL_ROOT = 0;
+
+int spool_add(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+	if(type != FTW_F || !S_ISREG(st->st_mode))
+		return 0;
+	if(SPOOL_COUNT == SPOOL_CAP) {
+		SPOOL_CAP = SPOOL_CAP ? 2 * SPOOL_CAP : 1024;
+		SPOOL = (bundle_entry_t *)realloc(SPOOL, SPOOL_CAP * sizeof(bundle_entry_t));
+		if(SPOOL == NULL) {
+			perror("[sender] spool index failed to allocate");
+			exit(24);
+		}
+	}
+	bundle_entry_t *e = &SPOOL[SPOOL_COUNT++];
+	e->path = strdup(path);
+	e->name = strdup(path + SPOOL_ROOT + 1);
+	e->mode = st->st_mode;
+	e->mtime = st->st_mtime;
+	e->size = st->st_size;
+	if(e->path == NULL || e->name == NULL) {
+		perror("[sender] spool index failed to allocate");
+		exit(24);
+	}
+	return 0;
+}
+
+// pack entries [first, last) into one bundle object and send it as a single transfer
+void send_bundle(char *tmpdir, char *spool, uint32_t n, uint32_t first, uint32_t last,
+	destination_t *dest_clear, destination_t *dest_xored, destination_t *dest_check) {
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%.60s-%ld-%u%s", tmpdir, spool, (long)time(NULL), n, BUNDLE_SUFFIX);
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+	if(fd == -1 || bundle_write(fd, SPOOL + first, last - first) == -1) {
+		perror("[sender] bundle failed");
+		exit(24);
+	}
+	close(fd);
+
+	printf("[INFO] bundle %s: %u files\n", path, last - first);
+	send_object(path, dest_clear, dest_xored, dest_check);
+	unlink(path);
+}
+
+/* every regular file below dir: small ones share bundles of up to BUNDLE_SIZE bytes (one descriptor, one FEC code
+ * and one EOF tail each), larger ones go as transfers of their own */
+void send_spool(char *dir, destination_t *dest_clear, destination_t *dest_xored, destination_t *dest_check) {
+	char root[PATH_MAX], tmpdir[PATH_MAX];
+
+	strncpy(root, dir, PATH_MAX - 1);
+	root[PATH_MAX - 1] = 0;
+	while(strlen(root) > 1 && root[strlen(root) - 1] == '/')
+		root[strlen(root) - 1] = 0;
+	SPOOL_ROOT = strlen(root);
+	if(nftw(root, spool_add, 16, FTW_PHYS) == -1) {
+		perror("[sender] spool walk failed");
+		exit(24);
+	}
+	if(SPOOL_COUNT == 0) {
+		printf("[INFO] spool %s is empty\n", root);
+		return;
+	}
+
+	char *tmp = getenv("TMPDIR");
+	snprintf(tmpdir, sizeof(tmpdir), "%s/datadiode.XXXXXX", (tmp != NULL) ? tmp : "/tmp");
+	if(mkdtemp(tmpdir) == NULL) {
+		perror("[sender] bundle directory failed");
+		exit(24);
+	}
+	char *spool = basename(root);
+
+	/* large files first, the small ones stay in the index in their order. A large file goes under a name of its own,
+	 * its relative name rides with the descriptor; a name too long for that makes it a bundle of one */
+	uint32_t small = 0, n = 0;
+	for(uint32_t i=0; i<SPOOL_COUNT; i++) {
+		if(22 + strlen(SPOOL[i].name) + SPOOL[i].size + BUNDLE_MAGICLEN + 4 > BUNDLE_SIZE) {
+			if(strlen(SPOOL[i].name) > SPOOL_NAMELEN)
+				send_bundle(tmpdir, spool, n++, i, i + 1, dest_clear, dest_xored, dest_check);
+			else {
+				snprintf(SPOOL_OBJECT, sizeof(SPOOL_OBJECT), "%.30s-%ld-%u-%.45s", spool, (long)time(NULL), i,
+					strrchr(SPOOL[i].path, '/') + 1);
+				SPOOL_MEMBER = &SPOOL[i];
+				send_object(SPOOL[i].path, dest_clear, dest_xored, dest_check);
+				SPOOL_MEMBER = NULL;
+			}
+			free(SPOOL[i].path);
+			free(SPOOL[i].name);
+		}
+		else
+			SPOOL[small++] = SPOOL[i];
+	}
+	SPOOL_COUNT = small;
+
+	uint32_t first = 0;
+	uint64_t size = BUNDLE_MAGICLEN + 4;
+	for(uint32_t i=0; i<SPOOL_COUNT; i++) {
+		uint64_t cost = 22 + strlen(SPOOL[i].name) + SPOOL[i].size;
+		if(size + cost > BUNDLE_SIZE) {
+			send_bundle(tmpdir, spool, n++, first, i, dest_clear, dest_xored, dest_check);
+			size = BUNDLE_MAGICLEN + 4;
+			first = i;
+		}
+		size += cost;
+	}
+	if(SPOOL_COUNT > 0)
+		send_bundle(tmpdir, spool, n, first, SPOOL_COUNT, dest_clear, dest_xored, dest_check);
+
+	rmdir(tmpdir);
+	for(uint32_t i=0; i<SPOOL_COUNT; i++) {
+		free(SPOOL[i].path);
+		free(SPOOL[i].name);
+	}
+	free(SPOOL);
+}
+
+// run every transfer in its own process, feeding a shared ring
+void mux_start(destination_t *dest_clear, destination_t *dest_xored, destination_t *dest_check) {
+	ring_t *rings = mmap(NULL, NTRANSFERS * sizeof(ring_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if(rings == MAP_FAILED) {
+		perror("[sender] transfer rings failed to allocate");
+		exit(23);
+	}
+
+	fflush(stdout);
+	for(uint32_t t=0; t<NTRANSFERS; t++) {
+		transfer_t *tr = &TRANSFERS[t];
+		tr->ring = &rings[t];
+		if(ring_init_shared(tr->ring, MUX_SLOTS, sizeof(mux_slot_t)) == -1) {
+			perror("[sender] transfer ring failed to allocate");
+			exit(23);
+		}
+		tr->vtime = 0.0;
+		tr->idle = 1;
+		tr->done = 0;
+
+		tr->pid = fork();
+		if(tr->pid == -1) {
+			perror("[sender] fork failed");
+			exit(23);
+		}
+		if(tr->pid == 0) {
+			// transfer process: globals are its own, the packets go to the ring
+			MUX = tr->ring;
+			if(ENCODERS > 0)
+				pipeline_start(ENCODERS);
+			if(strcmp(tr->file_path, "-") == 0)
+				send_stream(STDIN_FILENO, STREAM_NAME, dest_clear, dest_xored, dest_check);
+			else
+				send_object(tr->file_path, dest_clear, dest_xored, dest_check);
+			if(PIPE != NULL)
+				pipeline_stop();
+			mux_slot_t *slot = ring_reserve(MUX);
+			slot->type = SLOT_QUIT;
+			ring_push(MUX);
+			fflush(stdout);
+			_exit(0);
+		}
+	}
+}
+
+// scheduler: pace all transfers through the links until every one of them finished
+void mux_run() {
+	uint32_t active = NTRANSFERS;
+	uint32_t spins = 0;
+	double vclock = 0.0;		// virtual time of the last packet sent
+	int status;
+
+	while(active > 0) {
+		transfer_t *best = NULL;
+		mux_slot_t *slot = NULL;
+
+		for(uint32_t t=0; t<NTRANSFERS; t++) {
+			transfer_t *tr = &TRANSFERS[t];
+			if(tr->done)
+				continue;
+			mux_slot_t *s = ring_poll(tr->ring);
+			if(s == NULL) {
+				// a transfer that died without its QUIT slot
+				if(waitpid(tr->pid, &status, WNOHANG) == tr->pid && ring_poll(tr->ring) == NULL) {
+					fprintf(stderr, "[sender] transfer %s ended with status %d\n", tr->file_path, 
+						WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+					tr->done = 1;
+					tr->pid = -1;
+					active--;
+				}
+				else
+					tr->idle = 1;
+				continue;
+			}
+			// no credit for the time spent idle
+			if(tr->idle) {
+				if(tr->vtime < vclock)
+					tr->vtime = vclock;
+				tr->idle = 0;
+			}
+			if(best == NULL || tr->priority > best->priority || (tr->priority == best->priority && tr->vtime < best->vtime)) {
+				best = tr;
+				slot = s;
+			}
+		}
+
+		if(best == NULL) {
+			if(spins++ < 64)
+				sched_yield();
+			else
+				usleep(50);
+			continue;
+		}
+		spins = 0;
+
+		if(slot->type == SLOT_QUIT) {
+			ring_pop(best->ring);
+			if(best->pid != -1 && waitpid(best->pid, &status, 0) == best->pid && WIFEXITED(status) && WEXITSTATUS(status) != 0)
+				fprintf(stderr, "[sender] transfer %s ended with status %d\n", best->file_path, WEXITSTATUS(status));
+			printf("[INFO] transfer %s finished\n", best->file_path);
+			best->done = 1;
+			active--;
+			continue;
+		}
+
+		send_slice(&(LINKS[0].dest[slot->channel]), slot->pack, slot->copy);
+		ring_pop(best->ring);
+		vclock = best->vtime;
+		best->vtime += (double)MAXBUFLEN / best->weight;
+	}
+
+	for(uint32_t t=0; t<NTRANSFERS; t++)
+		ring_free(TRANSFERS[t].ring);
+}
+
 int main(int argc, char *argv[]) {
 
 	// process data from outside
-	if(argc != 6) {
-		fprintf(stderr, "[usage] <program> <IP> <port> <filename> <xor-size> <spray>\n");
+	int opt;
+	char *link_spec[MAX_LINKS];
+	while((opt = getopt(argc, argv, "i:P:w:n:j:DR:L:F:B:Z:C:")) != -1) {
+		switch(opt) {
+		case 'Z': {
+			// codec[,level]
+			char *comma = strchr(optarg, ',');
+			if(comma != NULL) {
+				*comma = 0;
+				CODEC_LEVEL = atoi(comma + 1);
+			}
+			if((CODEC = codec_parse(optarg)) == -1) {
+				fprintf(stderr, "[sender] codec %s is unknown or not built in\n", optarg);
+				exit(16);
+			}
+			break;
+		}
+		case 'C': {
+			// manifest[,refresh]
+			char *comma = strchr(optarg, ',');
+			if(comma != NULL) {
+				*comma = 0;
+				MANIFEST_REFRESH = atoi(comma + 1);
+			}
+			MANIFEST_PATH = optarg;
+			break;
+		}
+		case 'B':
+			BUNDLE_SIZE = strtoull(optarg, NULL, 10);
+			if(BUNDLE_SIZE == 0) {
+				fprintf(stderr, "[sender] invalid bundle size %s\n", optarg);
+				exit(16);
+			}
+			break;
+		case 'F':
+			// file[,weight[,priority]]
+			if(NTRANSFERS == MAX_TRANSFERS) {
+				fprintf(stderr, "[sender] at most %u transfers\n", MAX_TRANSFERS);
+				exit(16);
+			}
+			transfer_t *tr = &TRANSFERS[NTRANSFERS++];
+			int weight = 1, priority = 0;
+			char *comma = strchr(optarg, ',');
+			if(comma != NULL) {
+				*comma = 0;
+				if(sscanf(comma + 1, "%d,%d", &weight, &priority) < 1 || weight <= 0 || priority < 0) {
+					fprintf(stderr, "[sender] invalid transfer %s,%s\n", optarg, comma + 1);
+					exit(16);
+				}
+			}
+			tr->file_path = optarg;
+			tr->weight = weight;
+			tr->priority = priority;
+			break;
+		case 'L':
+			if(NLINKS == MAX_LINKS) {
+				fprintf(stderr, "[sender] at most %u links\n", MAX_LINKS);
+				exit(16);
+			}
+			link_spec[NLINKS++] = optarg;
+			break;
+		case 'i':
+			INTERLEAVE_DEPTH = atoi(optarg);
+			break;
+		case 'P':
+			// loss[,burst[,target]]
+			if(sscanf(optarg, "%lf,%lf,%lf", &LOSS_MODEL.loss, &LOSS_MODEL.burst, &LOSS_MODEL.target) < 1 ||
+				LOSS_MODEL.loss < 0.0 || LOSS_MODEL.loss >= 1.0) {
+				fprintf(stderr, "[sender] invalid loss profile %s\n", optarg);
+				exit(16);
+			}
+			PLANNER = 1;
+			break;
+		case 'w':
+			WINDOW_SLICES = atoi(optarg);
+			break;
+		case 'n':
+			STREAM_NAME = optarg;
+			break;
+		case 'j':
+			ENCODERS = atoi(optarg);
+			break;
+		case 'D':
+			DIRECT_IO = 1;
+			break;
+		case 'R':
+			RAW_SPEC = optarg;
+			break;
+		default:
+			argc = 0;
+			break;
+		}
+	}
+	if(argc - optind != 5 || (RAW_SPEC != NULL && NLINKS > 1) || (BUNDLE_SIZE > 0 && NTRANSFERS > 1)) {
+		fprintf(stderr, "[usage] <program> [-i interleave-depth] [-P loss[,burst[,target]]] [-w window] [-n name] [-j encoders] [-D] [-R iface[,mac][,xdp|packet]] [-L IP:port[,mbps[,weight]]]... [-F file[,weight[,priority]]]... [-B bundle-size] [-Z lz4|zstd[,level]] [-C manifest[,refresh]] <IP> <port> <filename> <xor-size> <spray>\n");
 		fprintf(stderr, "[usage] File will be sent on 3 consecutive ports starting with <port> at %u Mbps\n", TARGET_MBPS);
+		fprintf(stderr, "[usage] -i xor groups sharing a slice are sent ~slices/depth packets apart (default xor-size, 1 = off)\n");
+		fprintf(stderr, "[usage] -P choose xor-size and spray per file for the measured loss rate, mean burst length in packets\n");
+		fprintf(stderr, "[usage]    and acceptable failure probability (default 1,1e-6); <xor-size> <spray> are the fallback\n");
+		fprintf(stderr, "[usage] -w encode and send source blocks of <window> slices one after the other (bounded memory, sequential reads)\n");
+		fprintf(stderr, "[usage] -j read, encode on <encoders> threads and transmit in a pipeline\n");
+		fprintf(stderr, "[usage] -D read source blocks with O_DIRECT (with -w)\n");
+		fprintf(stderr, "[usage] -R write pre-framed packets to a ring on <iface>: AF_XDP, else TPACKET_V3; the peer MAC\n");
+		fprintf(stderr, "[usage]    comes from the static ARP entry of <IP> unless given\n");
+		fprintf(stderr, "[usage] -L stripe over another diode link paced at <mbps> (default %u), data split by <weight> (default mbps);\n", TARGET_MBPS);
+		fprintf(stderr, "[usage]    the copies of a slice go on different links, a link with a local send error is skipped\n");
+		fprintf(stderr, "[usage]    for a while (not with -R)\n");
+		fprintf(stderr, "[usage] -F send another file at the same time, sharing the bandwidth by <weight> (default 1, <filename> has 1)\n");
+		fprintf(stderr, "[usage]    within the same <priority> (default 0), higher priorities go first\n");
+		fprintf(stderr, "[usage] -B <filename> is a spool directory: its files are sent in bundles of up to <bundle-size> bytes,\n");
+		fprintf(stderr, "[usage]    unpacked by recovery; larger files are sent on their own, keeping their relative name (not with -F)\n");
+		fprintf(stderr, "[usage] -Z compress files in chunks before slicing, expanded by recovery; chunks and files that\n");
+		fprintf(stderr, "[usage]    do not shrink are sent as they are (not for stdin)\n");
+		fprintf(stderr, "[usage] -C send only content-defined chunks not listed in <manifest> plus a recipe, recovery rebuilds the\n");
+		fprintf(stderr, "[usage]    file from its chunk store; a chunk used by <refresh> transfers (default %u) is sent again\n", DELTA_REFRESH);
+		fprintf(stderr, "[usage]    (not for stdin)\n");
+		fprintf(stderr, "[usage] <filename> - streams stdin in source blocks (default window %u) under <name> (default %s)\n", STREAM_WINDOW, STREAM_NAME);
 		exit(16);
 	}
+	argv += optind - 1;
+
+	// the receiver keys every transfer by its base name
+	TRANSFERS[0].file_path = argv[3];
+	for(uint32_t t=0; t<NTRANSFERS; t++) {
+		for(uint32_t u=0; u<t; u++) {
+			char *a = strrchr(TRANSFERS[t].file_path, '/'), *b = strrchr(TRANSFERS[u].file_path, '/');
+			a = (a == NULL) ? TRANSFERS[t].file_path : a + 1;
+			b = (b == NULL) ? TRANSFERS[u].file_path : b + 1;
+			if(strcmp(a, b) == 0 || (strcmp(TRANSFERS[t].file_path, "-") == 0 && strcmp(b, STREAM_NAME) == 0) ||
+				(strcmp(TRANSFERS[u].file_path, "-") == 0 && strcmp(a, STREAM_NAME) == 0)) {
+				fprintf(stderr, "[sender] two transfers named %s\n", a);
+				exit(16);
+			}
+		}
+	}
 		
 	/* CONFIGURE SOCKET RELATED ELEMENTS */
-	destination_t dest_clear, dest_xored, dest_check;
-	char receiver_port[13];
-	
-	// configure target for clear packets
-	strcpy(dest_clear.port, argv[2]);
-	strcpy(dest_clear.IP, argv[1]);
-	get_socket(&dest_clear);
-	
-	// configure target for xored packets
-	int iport = atoi(argv[2]); 
-	iport++; snprintf(receiver_port, 12, "%d", iport);
-	strcpy(dest_xored.port, receiver_port);
-	strcpy(dest_xored.IP, argv[1]);
-	get_socket(&dest_xored);
-	
-	// configure target for checksum
-	iport++; snprintf(receiver_port, 12, "%d", iport);
-	strcpy(dest_check.port, receiver_port);
-	strcpy(dest_check.IP, argv[1]);
-	get_socket(&dest_check);
+	// <IP> <port> is the first link, -L adds the others
+	for(uint32_t l=0; l<NLINKS; l++) {
+		char IP[20] = {0};
+		int iport = 0;
+		double mbps = TARGET_MBPS;
+		int weight = 0;
+
+		if(l == 0) {
+			strncpy(IP, argv[1], 19);
+			iport = atoi(argv[2]);
+		}
+		else {
+			char *colon = strrchr(link_spec[l], ':');
+			if(colon == NULL || colon - link_spec[l] > 19 ||
+				sscanf(colon + 1, "%d,%lf,%d", &iport, &mbps, &weight) < 1 || iport <= 0 || mbps <= 0.0 || weight < 0) {
+				fprintf(stderr, "[sender] invalid link %s\n", link_spec[l]);
+				exit(16);
+			}
+			strncpy(IP, link_spec[l], colon - link_spec[l]);
+		}
+
+		link_t *link = &LINKS[l];
+		link->mbps = mbps;
+		link->weight = (weight > 0) ? weight : ((mbps >= 1.0) ? (int32_t)mbps : 1);
+		link->current = 0;
+		link->bytes = 0;
+		link->down_until = 0.0;
+
+		// configure targets for clear, xored and checksum packets
+		for(uint8_t c=0; c<3; c++) {
+			snprintf(link->dest[c].port, 12, "%d", iport + c);
+			strcpy(link->dest[c].IP, IP);
+			link->dest[c].channel = c;
+			get_socket(&(link->dest[c]));
+		}
+	}
+	if(NLINKS > 1)
+		link_wheel();
+	destination_t *dest_clear = &(LINKS[0].dest[CHANNEL_CLEAR]);
+	destination_t *dest_xored = &(LINKS[0].dest[CHANNEL_XOR]);
+	destination_t *dest_check = &(LINKS[0].dest[CHANNEL_CHECK]);
+
+	// raw transmit backend on the diode interface
+	rawtx_t rawtx;
+	if(RAW_SPEC != NULL)
+		open_raw(&rawtx, RAW_SPEC, (struct sockaddr_in *)dest_clear->dest->ai_addr);
 
 	// configure fountain related elements
-	XOR_GROUP_SIZE = atoi(argv[4]);
-	SPRAY = atoi(argv[5]);
+	XOR_GROUP_SIZE = ARG_XOR_GROUP_SIZE = atoi(argv[4]);
+	SPRAY = ARG_SPRAY = atoi(argv[5]);
+	ARG_CLEAR_SPRAY = CLEAR_SPRAY;
 	
 	/* SEND FILE */
 	// Get the start time for the overall copy
@@ -526,27 +1864,40 @@ int main(int argc, char *argv[]) {
 	    perror("clock_gettime");
 	    exit(EXIT_FAILURE);
 	}
-	send_file(argv[3], &dest_clear, &dest_xored, &dest_check);
+	if(NTRANSFERS > 1) {
+		TRANSFERS[0].weight = 1;
+		TRANSFERS[0].priority = 0;
+		mux_start(dest_clear, dest_xored, dest_check);
+		mux_run();
+	}
+	else {
+		if(ENCODERS > 0)
+			pipeline_start(ENCODERS);
+		if(BUNDLE_SIZE > 0)
+			send_spool(argv[3], dest_clear, dest_xored, dest_check);
+		else if(strcmp(argv[3], "-") == 0)
+			send_stream(STDIN_FILENO, STREAM_NAME, dest_clear, dest_xored, dest_check);
+		else
+			send_object(argv[3], dest_clear, dest_xored, dest_check);
+		if(PIPE != NULL)
+			pipeline_stop();
+	}
 
 	/* CLEAN UP */
-	freeaddrinfo(dest_clear.res);
-	freeaddrinfo(dest_xored.res);
-	freeaddrinfo(dest_check.res);
-	
-	if(close(dest_clear.socketfd) == -1) {
-		perror("[sender] close socketfd failed");
-		exit(17);
-	}
-	
-	if(close(dest_xored.socketfd) == -1) {
-		perror("[sender] close socketfd failed");
-		exit(18);
+	if(RAWTX != NULL) {
+		rawtx_close(RAWTX);
+		RAWTX = NULL;
 	}
-	
-	if(close(dest_check.socketfd) == -1) {
-		perror("[sender] close socketfd failed");
-		exit(19);
+	for(uint32_t l=0; l<NLINKS; l++) {
+		for(uint8_t c=0; c<3; c++) {
+			freeaddrinfo(LINKS[l].dest[c].res);
+			if(close(LINKS[l].dest[c].socketfd) == -1) {
+				perror("[sender] close socketfd failed");
+				exit(17 + c);
+			}
+		}
 	}
+	free(LINK_WHEEL);
 	
 	return 0;
 }
@@ -0,0 +1,213 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+/*
+ * Channel simulator: the fountain of the sender and recovery (prepare_fountain() in fountain.c) and the shuffled-phase
+ * transmission plan are run through an in-memory loss channel and peeled like recovery_layer1() does, on the same
+ * group layout (fountain_member(), fountain_group()), without sockets or files. Prints CSV
+ * recovery curves (probability that a block of slices is recovered, per loss model, loss rate and redundancy) or,
+ * with -r, the cheapest redundancy reaching the given recovery probability at every loss rate (overhead curve).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include "fountain.h"
+#include "schedule.h"
+#include "planner.h"
+
+#define MAXLIST 64
+#define CHECKSUMS 20	// checksum packets per block, as sent by datadiode-send
+
+uint32_t SLICES = 1024;
+uint32_t TRIALS = 100;
+uint32_t DEPTH = 0;	// 0 = xor size, like datadiode-send -i
+double TARGET = 0;	// -r: overhead curve instead of recovery curves
+
+typedef struct {
+	double v[MAXLIST];
+	uint32_t n;
+} list_t;
+
+// "a,b,c" or "from:to:step"
+void parse_list(list_t *l, char *s) {
+	double from, to, step;
+	l->n = 0;
+	if(sscanf(s, "%lf:%lf:%lf", &from, &to, &step) == 3 && step > 0) {
+		for(double x=from; x<=to + step / 2 && l->n<MAXLIST; x+=step)
+			l->v[l->n++] = x;
+		return;
+	}
+	for(char *tok=strtok(s, ","); tok!=NULL && l->n<MAXLIST; tok=strtok(NULL, ","))
+		l->v[l->n++] = atof(tok);
+}
+
+typedef struct {
+	double p_recover;
+	double missing;		// mean slices left unrecovered
+	double sent;		// packets sent per slice
+	double clear_rx;	// share of the clear slices received
+	double xor_rx;		// share of the xor groups received
+} result_t;
+
+void simulate(double loss, double burst, redundancy_t *r, uint64_t seed, result_t *res) {
+	uint32_t n = (SLICES < r->xor_group_size) ? r->xor_group_size : SLICES;
+	uint8_t *have_clear = (uint8_t *)malloc(n);
+	uint8_t *have_xor = (uint8_t *)malloc(n);
+	if(have_clear == NULL || have_xor == NULL) {
+		perror("[sim] failed to allocate\n");
+		exit(2);
+	}
+
+	channel_t ch;
+	channel_init(&ch, loss, burst, seed);
+	uint64_t state;
+	seed_r(&state, seed ^ 0x5DEECE66DLL);
+
+	uint64_t recovered = 0, missing = 0, sent = 0, clear_rx = 0, xor_rx = 0;
+	for(uint32_t t=0; t<TRIALS; t++) {
+		// the fountain of datadiode-send and datadiode-recovery, every trial is another block of the file
+		uint32_t *index, *lookup;
+		prepare_fountain(&index, &lookup, n, t);
+		memset(have_clear, 0, n);
+		memset(have_xor, 0, n);
+
+		txplan_t plan;
+		txplan_init(&plan, n, index, r->clear_spray, r->spray, CHECKSUMS, int64_r(&state), DEPTH ? DEPTH : r->xor_group_size);
+		sent += plan_channel(&plan, &ch, have_clear, have_xor);
+		txplan_free(&plan);
+		for(uint32_t i=0; i<n; i++) {
+			clear_rx += have_clear[i];
+			xor_rx += have_xor[i];
+		}
+
+		uint32_t m = peel_decode(n, r->xor_group_size, index, lookup, have_clear, have_xor);
+		recovered += (m == 0);
+		missing += m;
+		free(index);
+		free(lookup);
+	}
+
+	res->p_recover = (double)recovered / TRIALS;
+	res->missing = (double)missing / TRIALS;
+	res->sent = (double)sent / TRIALS / n;
+	res->clear_rx = (double)clear_rx / TRIALS / n;
+	res->xor_rx = (double)xor_rx / TRIALS / n;
+
+	free(have_clear);
+	free(have_xor);
+}
+
+int main(int argc, char *argv[]) {
+	char xors[] = "2,4,8", clears[] = "0,2,6", sprays[] = "2,4,6", losses[] = "0.01,0.05,0.1,0.2,0.3", bursts[] = "1,8";
+	list_t xor_list, clear_list, spray_list, loss_list, burst_list;
+	uint64_t seed = 1;
+	int opt;
+
+	parse_list(&xor_list, xors);
+	parse_list(&clear_list, clears);
+	parse_list(&spray_list, sprays);
+	parse_list(&loss_list, losses);
+	parse_list(&burst_list, bursts);
+
+	while((opt = getopt(argc, argv, "n:t:x:c:s:l:b:i:r:S:")) != -1) {
+		switch(opt) {
+		case 'n': SLICES = atoi(optarg); break;
+		case 't': TRIALS = atoi(optarg); break;
+		case 'x': parse_list(&xor_list, optarg); break;
+		case 'c': parse_list(&clear_list, optarg); break;
+		case 's': parse_list(&spray_list, optarg); break;
+		case 'l': parse_list(&loss_list, optarg); break;
+		case 'b': parse_list(&burst_list, optarg); break;
+		case 'i': DEPTH = atoi(optarg); break;
+		case 'r': TARGET = atof(optarg); break;
+		case 'S': seed = strtoull(optarg, NULL, 10); break;
+		default:
+			fprintf(stderr, "[usage] <program> [-n slices] [-t trials] [-x xor-sizes] [-c clear-sprays] [-s sprays] [-l losses] [-b bursts]\n");
+			fprintf(stderr, "[usage]           [-i interleave-depth] [-r recovery-probability] [-S seed]\n");
+			fprintf(stderr, "[usage] lists are a,b,c or from:to:step; -b is the mean loss burst in packets, 1 = independent losses\n");
+			fprintf(stderr, "[usage] -n slices per block (default %u), -t blocks simulated per point (default %u)\n", SLICES, TRIALS);
+			fprintf(stderr, "[usage] -r print the cheapest redundancy that recovers a block with at least this probability, per loss\n");
+			exit(1);
+		}
+	}
+	if(SLICES == 0 || TRIALS == 0) {
+		fprintf(stderr, "[sim] -n and -t must be positive\n");
+		exit(1);
+	}
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	uint64_t trials = 0;
+
+	if(TARGET > 0)
+		printf("burst,loss,xor,clear_spray,spray,slices,trials,p_recover,packets_per_slice\n");
+	else
+		printf("burst,loss,xor,clear_spray,spray,slices,trials,p_recover,mean_missing,packets_per_slice,clear_rx,xor_rx,analytic_p_recover\n");
+
+	for(uint32_t b=0; b<burst_list.n; b++) {
+		for(uint32_t l=0; l<loss_list.n; l++) {
+			double loss = loss_list.v[l], burst = burst_list.v[b];
+			loss_model_t model = { loss, burst, 0.0 };
+			redundancy_t best = { 0, 0, 0, 0, 0 };
+			result_t best_res = { 0, 0, 0, 0, 0 };
+
+			for(uint32_t x=0; x<xor_list.n; x++)
+			for(uint32_t c=0; c<clear_list.n; c++)
+			for(uint32_t s=0; s<spray_list.n; s++) {
+				redundancy_t r = { xor_list.v[x], clear_list.v[c], spray_list.v[s], 1 + clear_list.v[c] + spray_list.v[s], 0 };
+				result_t res;
+
+				simulate(loss, burst, &r, seed, &res);
+				trials += TRIALS;
+				if(TARGET > 0) {
+					if(res.p_recover >= TARGET && (best.cost == 0 || res.sent < best_res.sent)) {
+						best = r;
+						best_res = res;
+					}
+					continue;
+				}
+				printf("%g,%g,%u,%u,%u,%u,%u,%.6f,%.3f,%.4f,%.4f,%.4f,%.6f\n", burst, loss, r.xor_group_size, r.clear_spray, r.spray,
+					SLICES, TRIALS, res.p_recover, res.missing, res.sent, res.clear_rx, res.xor_rx,
+					1.0 - plan_analytic(SLICES, &model, DEPTH ? DEPTH : r.xor_group_size, &r));
+			}
+
+			if(TARGET > 0 && best.cost == 0)
+				printf("%g,%g,,,,%u,%u,,\n", burst, loss, SLICES, TRIALS);
+			else if(TARGET > 0)
+				printf("%g,%g,%u,%u,%u,%u,%u,%.6f,%.4f\n", burst, loss, best.xor_group_size, best.clear_spray, best.spray,
+					SLICES, TRIALS, best_res.p_recover, best_res.sent);
+			fflush(stdout);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	fprintf(stderr, "[sim] %lu trials of %u slices in %.1f s, %.0f trials/hour\n", trials, SLICES, elapsed, trials / elapsed * 3600);
+
+	return 0;
+}
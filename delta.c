@@ -0,0 +1,515 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <dirent.h>
+#include <time.h>
+#include "delta.h"
+
+#define DELTA_BUF (4 << 20)
+#define MANIFEST_MAGIC "DDM3"
+#define MANIFEST_MAGIC_DDM2 "DDM2"
+#define MANIFEST_MAGIC_OLD "DDM1"
+#define MANIFEST_ENTRY (DELTA_HASHLEN + 16)
+#define DELTA_STALE ((DELTA_KEEP - 1) * 86400ULL)	// inline age at which recovery may have pruned the chunk, a day to spare
+
+/* SHA-256, FIPS 180-4 */
+static const uint32_t K256[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(uint32_t *h, const unsigned char *p) {
+	uint32_t w[64], a, b, c, d, e, f, g, k;
+
+	for(int i=0; i<16; i++)
+		w[i] = ((uint32_t)p[4*i] << 24) | ((uint32_t)p[4*i+1] << 16) | ((uint32_t)p[4*i+2] << 8) | p[4*i+3];
+	for(int i=16; i<64; i++) {
+		uint32_t s0 = ROR(w[i-15], 7) ^ ROR(w[i-15], 18) ^ (w[i-15] >> 3);
+		uint32_t s1 = ROR(w[i-2], 17) ^ ROR(w[i-2], 19) ^ (w[i-2] >> 10);
+		w[i] = w[i-16] + s0 + w[i-7] + s1;
+	}
+	a = h[0]; b = h[1]; c = h[2]; d = h[3]; e = h[4]; f = h[5]; g = h[6]; k = h[7];
+	for(int i=0; i<64; i++) {
+		uint32_t t1 = k + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+		uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		k = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+	h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+static void sha256(const unsigned char *data, uint64_t len, unsigned char *out) {
+	uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	unsigned char tail[128];
+	uint64_t full = len & ~63ULL;
+
+	for(uint64_t i=0; i<full; i+=64)
+		sha256_block(h, data + i);
+
+	uint32_t rest = len - full;
+	memset(tail, 0, sizeof(tail));
+	memcpy(tail, data + full, rest);
+	tail[rest] = 0x80;
+	uint32_t n = (rest < 56) ? 64 : 128;
+	for(int i=0; i<8; i++)
+		tail[n - 1 - i] = ((len * 8) >> (8 * i)) & 0xFF;
+	sha256_block(h, tail);
+	if(n == 128)
+		sha256_block(h, tail + 64);
+
+	for(int i=0; i<8; i++) {
+		out[4*i] = h[i] >> 24;
+		out[4*i+1] = h[i] >> 16;
+		out[4*i+2] = h[i] >> 8;
+		out[4*i+3] = h[i];
+	}
+}
+
+/* gear table, fixed so both sides of any two runs cut the same data the same way */
+static uint64_t GEAR[256];
+
+static void gear_init() {
+	uint64_t x = 0x9E3779B97F4A7C15ULL;
+	if(GEAR[0] != 0)
+		return;
+	for(int i=0; i<256; i++) {
+		// splitmix64
+		uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		GEAR[i] = z ^ (z >> 31);
+	}
+}
+
+// length of the next chunk in data[0, len), cut where the rolling hash has its top DELTA_AVG_BITS clear
+static uint32_t cut(const unsigned char *data, uint32_t len) {
+	const uint64_t mask = ~0ULL << (64 - DELTA_AVG_BITS);
+	uint64_t fp = 0;
+
+	if(len <= DELTA_MIN)
+		return len;
+	if(len > DELTA_MAX)
+		len = DELTA_MAX;
+	for(uint32_t i=DELTA_MIN - 64; i<len; i++) {
+		fp = (fp << 1) + GEAR[data[i]];
+		if(i >= DELTA_MIN && !(fp & mask))
+			return i + 1;
+	}
+	return len;
+}
+
+static void put(unsigned char *p, uint64_t v, uint8_t len) {
+	for(uint8_t i=0; i<len; i++)
+		p[i] = (v >> ((len - 1 - i) * 8)) & 0xFF;
+}
+
+static uint64_t get(unsigned char *p, uint8_t len) {
+	uint64_t v = 0;
+	for(uint8_t i=0; i<len; i++)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static int write_all(int fd, const unsigned char *buf, size_t len) {
+	while(len > 0) {
+		ssize_t n = write(fd, buf, len);
+		if(n == -1) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static ssize_t read_full(int fd, unsigned char *buf, size_t len) {
+	size_t got = 0;
+	while(got < len) {
+		ssize_t n = read(fd, buf + got, len - got);
+		if(n == -1 && errno == EINTR)
+			continue;
+		if(n == -1)
+			return -1;
+		if(n == 0)
+			break;
+		got += n;
+	}
+	return got;
+}
+
+/* manifest: set of chunk hashes, each with the last transfer that used it, the transfers since it went inline and
+ * when that was */
+static int manifest_init(manifest_t *m, uint64_t size) {
+	m->hashes = (unsigned char *)calloc(size, DELTA_HASHLEN);
+	m->used = (uint32_t *)calloc(size, sizeof(uint32_t));
+	m->uses = (uint32_t *)calloc(size, sizeof(uint32_t));
+	m->sent = (uint64_t *)calloc(size, sizeof(uint64_t));
+	m->size = size;
+	m->count = 0;
+	if(m->hashes == NULL || m->used == NULL || m->uses == NULL || m->sent == NULL) {
+		manifest_free(m);
+		return -1;
+	}
+	return 0;
+}
+
+static uint64_t slot(manifest_t *m, const unsigned char *hash) {
+	static const unsigned char zero[DELTA_HASHLEN];
+	uint64_t i = get((unsigned char *)hash, 8) & (m->size - 1);
+	for(;; i = (i + 1) & (m->size - 1)) {
+		unsigned char *s = m->hashes + i * DELTA_HASHLEN;
+		if(memcmp(s, zero, DELTA_HASHLEN) == 0 || memcmp(s, hash, DELTA_HASHLEN) == 0)
+			return i;
+	}
+}
+
+static uint8_t manifest_has(manifest_t *m, uint64_t i, const unsigned char *hash) {
+	return memcmp(m->hashes + i * DELTA_HASHLEN, hash, DELTA_HASHLEN) == 0;
+}
+
+// set the entry of the chunk, returns its slot or -1
+static int64_t manifest_put(manifest_t *m, const unsigned char *hash, uint32_t used, uint32_t uses, uint64_t sent) {
+	if(2 * (m->count + 1) > m->size) {
+		manifest_t bigger;
+		if(manifest_init(&bigger, 2 * m->size) == -1)
+			return -1;
+		static const unsigned char zero[DELTA_HASHLEN];
+		for(uint64_t i=0; i<m->size; i++) {
+			unsigned char *s = m->hashes + i * DELTA_HASHLEN;
+			if(memcmp(s, zero, DELTA_HASHLEN) != 0) {
+				uint64_t j = slot(&bigger, s);
+				memcpy(bigger.hashes + j * DELTA_HASHLEN, s, DELTA_HASHLEN);
+				bigger.used[j] = m->used[i];
+				bigger.uses[j] = m->uses[i];
+				bigger.sent[j] = m->sent[i];
+			}
+		}
+		bigger.count = m->count;
+		bigger.transfers = m->transfers;
+		manifest_free(m);
+		*m = bigger;
+	}
+	uint64_t i = slot(m, hash);
+	if(!manifest_has(m, i, hash)) {
+		memcpy(m->hashes + i * DELTA_HASHLEN, hash, DELTA_HASHLEN);
+		m->count++;
+	}
+	m->used[i] = used;
+	m->uses[i] = uses;
+	m->sent[i] = sent;
+	return i;
+}
+
+/* a missing manifest is an empty one, the chunks of a DDM1 manifest count as used since its last full transfer;
+ * older manifests do not say when a chunk went inline, it goes inline again in the next transfer using it */
+int manifest_load(manifest_t *m, char *path) {
+	unsigned char head[12], entry[MANIFEST_ENTRY];
+
+	if(manifest_init(m, 1024) == -1)
+		return -1;
+	m->transfers = 0;
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+		return (errno == ENOENT) ? 0 : -1;
+
+	int ret = -1;
+	if(read_full(fd, head, 12) != 12)
+		goto done;
+	uint8_t old = (memcmp(head, MANIFEST_MAGIC_OLD, 4) == 0), ddm2 = (memcmp(head, MANIFEST_MAGIC_DDM2, 4) == 0);
+	if(!old && !ddm2 && memcmp(head, MANIFEST_MAGIC, 4) != 0)
+		goto done;
+	m->transfers = get(head + 4, 4);
+	uint32_t count = get(head + 8, 4), len = old ? DELTA_HASHLEN : ddm2 ? DELTA_HASHLEN + 8 : MANIFEST_ENTRY;
+	for(uint32_t i=0; i<count; i++) {
+		if(read_full(fd, entry, len) != len)
+			goto done;
+		uint32_t used = old ? m->transfers : get(entry + DELTA_HASHLEN, 4);
+		uint32_t uses = old ? m->transfers : get(entry + DELTA_HASHLEN + 4, 4);
+		uint64_t sent = (old || ddm2) ? 0 : get(entry + DELTA_HASHLEN + 8, 8);
+		if(manifest_put(m, entry, used, uses, sent) == -1)
+			goto done;
+	}
+	ret = 0;
+
+done:
+	close(fd);
+	return ret;
+}
+
+// the entries src used in its own transfer replace those of dst, the others in dst stay as they are
+int manifest_merge(manifest_t *dst, manifest_t *src) {
+	static const unsigned char zero[DELTA_HASHLEN];
+	for(uint64_t i=0; i<src->size; i++) {
+		unsigned char *s = src->hashes + i * DELTA_HASHLEN;
+		if(memcmp(s, zero, DELTA_HASHLEN) != 0 && src->used[i] == src->transfers &&
+			manifest_put(dst, s, src->used[i], src->uses[i], src->sent[i]) == -1)
+			return -1;
+	}
+	return 0;
+}
+
+// written next to the old one and renamed over it, without chunks no transfer used for DELTA_FORGET transfers
+int manifest_save(manifest_t *m, char *path) {
+	static const unsigned char zero[DELTA_HASHLEN];
+	unsigned char head[12], entry[MANIFEST_ENTRY];
+	char tmp[4200];
+	uint32_t count = 0;
+
+	for(uint64_t i=0; i<m->size; i++)
+		if(memcmp(m->hashes + i * DELTA_HASHLEN, zero, DELTA_HASHLEN) != 0 && m->transfers - m->used[i] < DELTA_FORGET)
+			count++;
+
+	snprintf(tmp, sizeof(tmp), "%s.new", path);
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if(fd == -1)
+		return -1;
+	memcpy(head, MANIFEST_MAGIC, 4);
+	put(head + 4, m->transfers, 4);
+	put(head + 8, count, 4);
+	if(write_all(fd, head, 12) == -1)
+		goto fail;
+	for(uint64_t i=0; i<m->size; i++) {
+		unsigned char *s = m->hashes + i * DELTA_HASHLEN;
+		if(memcmp(s, zero, DELTA_HASHLEN) == 0 || m->transfers - m->used[i] >= DELTA_FORGET)
+			continue;
+		memcpy(entry, s, DELTA_HASHLEN);
+		put(entry + DELTA_HASHLEN, m->used[i], 4);
+		put(entry + DELTA_HASHLEN + 4, m->uses[i], 4);
+		put(entry + DELTA_HASHLEN + 8, m->sent[i], 8);
+		if(write_all(fd, entry, MANIFEST_ENTRY) == -1)
+			goto fail;
+	}
+	if(fsync(fd) == -1 || close(fd) == -1)
+		return -1;
+	return rename(tmp, path);
+
+fail:
+	close(fd);
+	return -1;
+}
+
+void manifest_free(manifest_t *m) {
+	free(m->hashes);
+	free(m->used);
+	free(m->uses);
+	free(m->sent);
+	m->hashes = NULL;
+	m->used = m->uses = NULL;
+	m->sent = NULL;
+}
+
+/* cut in into chunks and write the delta object to out; a chunk goes inline when it is not in the manifest, refresh
+ * transfers used it since it last went inline or that was DELTA_STALE ago, the entries of all chunks are stamped
+ * with the transfer (m->transfers); -1 on error */
+int delta_write(int in, int out, manifest_t *m, uint32_t refresh, delta_stats_t *stats) {
+	unsigned char *buf = (unsigned char *)malloc(DELTA_BUF);
+	unsigned char head[DELTA_HASHLEN + 5];
+	struct stat st;
+	uint32_t have = 0;
+	uint64_t now = time(NULL);
+	int ret = -1;
+
+	gear_init();
+	memset(stats, 0, sizeof(delta_stats_t));
+	if(buf == NULL || fstat(in, &st) == -1)
+		goto done;
+
+	memcpy(head, DELTA_MAGIC, DELTA_MAGICLEN);
+	put(head + DELTA_MAGICLEN, st.st_size, 8);
+	if(write_all(out, head, DELTA_MAGICLEN + 8) == -1)
+		goto done;
+	stats->packed = DELTA_MAGICLEN + 8;
+
+	for(;;) {
+		// keep at least DELTA_MAX bytes ahead of the cut point while the file lasts
+		ssize_t n = read_full(in, buf + have, DELTA_BUF - have);
+		if(n == -1)
+			goto done;
+		have += n;
+		if(have == 0)
+			break;
+
+		uint32_t pos = 0;
+		while(have - pos >= DELTA_MAX || (n == 0 && pos < have)) {
+			uint32_t len = cut(buf + pos, have - pos);
+			sha256(buf + pos, len, head);
+			put(head + DELTA_HASHLEN, len, 4);
+			uint64_t i = slot(m, head);
+			uint8_t listed = manifest_has(m, i, head), send = 1;
+			if(listed && m->used[i] == m->transfers)
+				send = 0;		// earlier in this file
+			else if(listed && m->uses[i] < refresh && now - m->sent[i] < DELTA_STALE) {
+				send = 0;
+				m->used[i] = m->transfers;
+				m->uses[i]++;
+			}
+			else if(manifest_put(m, head, m->transfers, 0, now) == -1)
+				goto done;
+			head[DELTA_HASHLEN + 4] = send;
+			if(write_all(out, head, DELTA_HASHLEN + 5) == -1 || (send && write_all(out, buf + pos, len) == -1))
+				goto done;
+
+			stats->chunks++;
+			stats->sent += send;
+			stats->raw += len;
+			stats->packed += DELTA_HASHLEN + 5 + (send ? len : 0);
+			pos += len;
+		}
+		memmove(buf, buf + pos, have - pos);
+		have -= pos;
+		if(n == 0)
+			break;
+	}
+	ret = 0;
+
+done:
+	free(buf);
+	return ret;
+}
+
+static void chunk_path(char *store, const unsigned char *hash, char *path, size_t size) {
+	char hex[2 * DELTA_HASHLEN + 1];
+	for(int i=0; i<DELTA_HASHLEN; i++)
+		sprintf(hex + 2 * i, "%02x", hash[i]);
+	snprintf(path, size, "%s/%.2s/%s", store, hex, hex + 2);
+}
+
+/* rebuild the file from the delta object in, inline chunks are added to the store first and every chunk used
+ * is touched for delta_prune(); -1 with errno ENOENT when a chunk is neither inline nor in the store */
+int delta_rebuild(int in, int out, char *store) {
+	unsigned char *buf = (unsigned char *)malloc(DELTA_MAX);
+	unsigned char head[DELTA_HASHLEN + 5], hash[DELTA_HASHLEN];
+	char path[4200], tmp[4300];
+	int ret = -1;
+
+	mkdir(store, 0700);
+	if(buf == NULL || read_full(in, head, DELTA_MAGICLEN + 8) != DELTA_MAGICLEN + 8 || memcmp(head, DELTA_MAGIC, DELTA_MAGICLEN) != 0)
+		goto done;
+	uint64_t size = get(head + DELTA_MAGICLEN, 8), written = 0;
+
+	for(;;) {
+		ssize_t n = read_full(in, head, DELTA_HASHLEN + 5);
+		if(n == 0)
+			break;
+		uint32_t len = get(head + DELTA_HASHLEN, 4);
+		if(n != DELTA_HASHLEN + 5 || len > DELTA_MAX)
+			goto done;
+		chunk_path(store, head, path, sizeof(path));
+
+		if(head[DELTA_HASHLEN + 4]) {
+			if(read_full(in, buf, len) != len)
+				goto done;
+			sha256(buf, len, hash);
+			if(memcmp(hash, head, DELTA_HASHLEN) != 0)
+				goto done;
+			if(access(path, F_OK) != 0) {
+				// store it under its hash, complete or not at all
+				snprintf(tmp, sizeof(tmp), "%s.%d", path, getpid());
+				*strrchr(path, '/') = 0;
+				mkdir(path, 0700);
+				path[strlen(path)] = '/';
+				int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+				if(fd == -1 || write_all(fd, buf, len) == -1 || close(fd) == -1 || rename(tmp, path) == -1)
+					goto done;
+			}
+			else
+				utimensat(AT_FDCWD, path, NULL, 0);
+		}
+		else {
+			int fd = open(path, O_RDONLY);
+			if(fd == -1) {
+				errno = ENOENT;
+				goto done;
+			}
+			ssize_t got = read_full(fd, buf, len);
+			futimens(fd, NULL);
+			close(fd);
+			if(got != len)
+				goto done;
+		}
+
+		if(write_all(out, buf, len) == -1)
+			goto done;
+		written += len;
+	}
+	ret = (written == size) ? 0 : -1;
+
+done:
+	free(buf);
+	return ret;
+}
+
+/* remove the chunks of the store nobody used for keep days (0 = never), at most once a day: the .pruned
+ * marker remembers the last walk. Returns the number of chunks removed or -1 */
+int delta_prune(char *store, uint32_t keep) {
+	char path[4200];
+	struct stat st;
+	int removed = 0;
+
+	if(keep == 0)
+		return 0;
+	time_t now = time(NULL);
+	snprintf(path, sizeof(path), "%s/.pruned", store);
+	if(stat(path, &st) == 0 && st.st_mtime > now - 86400)
+		return 0;
+	int fd = open(path, O_WRONLY | O_CREAT, 0600);
+	if(fd == -1)
+		return -1;
+	futimens(fd, NULL);
+	close(fd);
+
+	time_t cutoff = now - (time_t)keep * 86400;
+	for(int d=0; d<256; d++) {
+		snprintf(path, sizeof(path), "%s/%02x", store, d);
+		DIR *dir = opendir(path);
+		if(dir == NULL)
+			continue;
+		struct dirent *e;
+		while((e = readdir(dir)) != NULL) {
+			if(e->d_name[0] == '.')
+				continue;
+			if(fstatat(dirfd(dir), e->d_name, &st, 0) == 0 && st.st_mtime < cutoff && unlinkat(dirfd(dir), e->d_name, 0) == 0)
+				removed++;
+		}
+		closedir(dir);
+	}
+	return removed;
+}
@@ -0,0 +1,88 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __DELTA_FOUNTAIN__
+#define __DELTA_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Delta objects of repeated transfers (-C): files are cut into content-defined chunks (gear rolling hash,
+ * 16 KiB min, ~64 KiB average, 256 KiB max) named by their SHA-256. The sender remembers in a manifest which
+ * chunks it already sent and only sends the new ones, next to a recipe; recovery rebuilds the file from
+ * the object and its chunk store.
+ *		Magic					: 4 bytes		-> "DDD1"
+ *		File size				: 8 bytes
+ *		per chunk				: SHA-256 (32), length (4), inline (1), the chunk if inline
+ * all numbers big endian
+ *
+ * There is no way back through the diode: the manifest only says what was sent. It numbers the transfers made
+ * against it and counts, per chunk, the transfers that used the chunk since it last went inline; after refresh
+ * of them it goes inline again. Every file thus refreshes on its own schedule and keeps the manifest entries of
+ * the others; a chunk no transfer used for DELTA_FORGET transfers is dropped (and sent inline if it comes back).
+ * Recovery touches the chunks of its store when it uses them and removes the ones left unused for DELTA_KEEP days
+ * (-k), so a chunk also goes inline again once it last went inline a day less than that ago, however few
+ * transfers used it since.
+ *		Magic					: 4 bytes		-> "DDM3"
+ *		Transfers				: 4 bytes
+ *		Count					: 4 bytes
+ *		per chunk				: SHA-256 (32), last transfer using it (4), transfers since it went inline (4),
+ *								  time it last went inline (8, seconds since the epoch) */
+
+#define DELTA_MAGIC "DDD1"
+#define DELTA_MAGICLEN 4
+#define DELTA_HASHLEN 32
+#define DELTA_MIN (16 << 10)
+#define DELTA_AVG_BITS 16
+#define DELTA_MAX (256 << 10)
+#define DELTA_REFRESH 7
+#define DELTA_FORGET 4096		// transfers
+#define DELTA_KEEP 30		// days, the store of recovery and the inline age of the sender
+
+typedef struct {
+	unsigned char *hashes;		// open addressing table of DELTA_HASHLEN keys, all zero = empty
+	uint32_t *used;			// per slot: last transfer that used the chunk
+	uint32_t *uses;			// per slot: transfers that used it since it last went inline
+	uint64_t *sent;			// per slot: when it last went inline, 0 = unknown
+	uint64_t size;			// slots, power of two
+	uint64_t count;
+	uint32_t transfers;		// transfers made against the manifest
+} manifest_t;
+
+typedef struct {
+	uint64_t chunks;
+	uint64_t sent;			// chunks carried inline
+	uint64_t raw;
+	uint64_t packed;
+} delta_stats_t;
+
+int manifest_load(manifest_t *m, char *path);
+int manifest_merge(manifest_t *dst, manifest_t *src);
+int manifest_save(manifest_t *m, char *path);
+void manifest_free(manifest_t *m);
+int delta_write(int in, int out, manifest_t *m, uint32_t refresh, delta_stats_t *stats);
+int delta_rebuild(int in, int out, char *store);
+int delta_prune(char *store, uint32_t keep);
+
+#endif
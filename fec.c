@@ -0,0 +1,136 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include <string.h>
+#include "fec.h"
+
+// GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1
+static uint8_t EXP[512], LOG[256];
+static uint8_t ready = 0;
+
+static void gf_init() {
+	uint16_t x = 1;
+	if(ready)
+		return;
+	for(int i=0; i<255; i++) {
+		EXP[i] = EXP[i + 255] = x;
+		LOG[x] = i;
+		x <<= 1;
+		if(x & 0x100)
+			x ^= 0x11D;
+	}
+	ready = 1;
+}
+
+static uint8_t gf_mul(uint8_t a, uint8_t b) {
+	return (a == 0 || b == 0) ? 0 : EXP[LOG[a] + LOG[b]];
+}
+
+static uint8_t gf_inv(uint8_t a) {
+	return EXP[255 - LOG[a]];
+}
+
+// dst ^= c * src
+static void gf_addmul(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+	uint8_t row[256];
+
+	if(c == 0)
+		return;
+	if(c == 1) {
+		for(size_t i=0; i<len; i++)
+			dst[i] ^= src[i];
+		return;
+	}
+	row[0] = 0;
+	for(int v=1; v<256; v++)
+		row[v] = EXP[LOG[v] + LOG[c]];
+	for(size_t i=0; i<len; i++)
+		dst[i] ^= row[src[i]];
+}
+
+// Cauchy element of repair row i and data column j: 1 / (x_i + y_j), x_i = k + i, y_j = j
+static uint8_t cauchy(uint8_t k, uint8_t i, uint8_t j) {
+	return gf_inv((uint8_t)(k + i) ^ j);
+}
+
+void fec_encode(uint8_t k, uint8_t r, uint8_t **data, uint8_t **repair, size_t len) {
+	gf_init();
+	for(uint8_t i=0; i<r; i++) {
+		memset(repair[i], 0, len);
+		for(uint8_t j=0; j<k; j++)
+			gf_addmul(repair[i], data[j], cauchy(k, i, j), len);
+	}
+}
+
+/* blocks[0, k) data, blocks[k, k+r) repair, all len bytes; missing data blocks are rebuilt in place.
+ * -1 when fewer than k blocks are present */
+int fec_decode(uint8_t k, uint8_t r, uint8_t **blocks, uint8_t *present, size_t len) {
+	uint8_t missing[FEC_MAXBLOCKS], rows[FEC_MAXBLOCKS], m = 0, n = 0;
+	uint8_t a[FEC_MAXBLOCKS][FEC_MAXBLOCKS];
+
+	gf_init();
+	for(int j=0; j<k; j++)
+		if(!present[j])
+			missing[m++] = j;
+	if(m == 0)
+		return 0;
+	for(int i=0; i<r && n<m; i++)
+		if(present[k + i])
+			rows[n++] = i;
+	if(n < m)
+		return -1;
+
+	// right hand side: the repair blocks minus the data that arrived, computed into the missing data blocks
+	for(uint8_t t=0; t<m; t++) {
+		uint8_t *s = blocks[missing[t]];
+		memcpy(s, blocks[k + rows[t]], len);
+		for(uint8_t j=0; j<k; j++)
+			if(present[j])
+				gf_addmul(s, blocks[j], cauchy(k, rows[t], j), len);
+		for(uint8_t u=0; u<m; u++)
+			a[t][u] = cauchy(k, rows[t], missing[u]);
+	}
+
+	// Gauss-Jordan on the m x m Cauchy submatrix
+	for(uint8_t c=0; c<m; c++) {
+		// leading minors of a Cauchy matrix are Cauchy determinants, no pivoting needed
+		if(a[c][c] == 0)
+			return -1;
+		uint8_t inv = gf_inv(a[c][c]);
+		for(uint8_t u=0; u<m; u++)
+			a[c][u] = gf_mul(a[c][u], inv);
+		uint8_t *row = blocks[missing[c]];
+		for(size_t i=0; i<len; i++)
+			row[i] = gf_mul(row[i], inv);
+		for(uint8_t t=0; t<m; t++) {
+			uint8_t f = a[t][c];
+			if(t == c || f == 0)
+				continue;
+			for(uint8_t u=0; u<m; u++)
+				a[t][u] ^= gf_mul(f, a[c][u]);
+			gf_addmul(blocks[missing[t]], row, f, len);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __FEC_FOUNTAIN__
+#define __FEC_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Systematic Reed-Solomon erasure code over GF(2^8) with a Cauchy generator: k data blocks and r repair blocks of
+ * the same length, any k of the k+r blocks give back the data (k + r <= 256). With r = 1 it protects like a plain
+ * xor group. Used for the short windows of the coded syslog mode, where the peeling decoder of whole files does not fit. */
+
+#define FEC_MAXBLOCKS 256
+
+void fec_encode(uint8_t k, uint8_t r, uint8_t **data, uint8_t **repair, size_t len);
+int fec_decode(uint8_t k, uint8_t r, uint8_t **blocks, uint8_t *present, size_t len);
+
+#endif
@@ -21,15 +21,23 @@
  *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
 */ 
 
+#include <stdlib.h>
 #include "fountain.h"
 
-uint64_t v = 4101842887655102017LL;
+#define IV 4101842887655102017LL
+
+uint64_t v = IV;
 uint64_t vv = 2685821657736338717LL;
 
 void seed(uint64_t seed) {
 	Random32(seed);
 }
 
+void reseed(uint64_t seed) {
+	v = IV;
+	Random32(seed);
+}
+
 uint32_t int32() { 
 	return (uint32_t) int64(); 
 } 
@@ -102,3 +110,68 @@ void indexed_shuffle32(uint32_t arr32[], uint32_t lookup[], uint32_t n) // Knuth
         	swap32(&arr32[i], &arr32[j]);
 	}
 }
+
+void seed_r(uint64_t *state, uint64_t seed) {
+	*state = IV ^ seed;
+	*state = int64_r(state);
+}
+
+uint64_t int64_r(uint64_t *state) {
+	*state ^= *state >> 21; 
+	*state ^= *state << 35; 
+	*state ^= *state >> 4;
+	return *state * vv;
+}
+
+void shuffle32_r(uint32_t arr32[], uint32_t n, uint64_t *state) // Knuth version of Fisher-Yates
+{
+	uint32_t i,j;
+
+	for (i = n-1; i > 0; i--) {
+		// Pick a random 32bit index from 0 to i
+		j = int64_r(state) % (i+1);
+		swap32(&arr32[i], &arr32[j]);
+	}
+}
+
+// index and its inverse (lookup, NULL when not needed) of a source block
+void prepare_fountain(uint32_t **index, uint32_t **lookup, uint32_t slices, uint32_t block) {
+	reseed(FOUNTAIN_SEED + block);
+
+	*index = (uint32_t *)malloc(slices * sizeof(uint32_t));
+	if(*index == NULL) {
+		perror("[fountain] prepare_fountain failed to allocate\n");
+		exit(3);
+	}
+	for (uint32_t i=0; i<slices; i++)
+		(*index)[i] = i;
+
+	// both shuffles draw the same permutation, the indexed one also builds the inverse
+	if(lookup == NULL)
+		shuffle32(*index, slices);
+	else {
+		*lookup = (uint32_t *)malloc(slices * sizeof(uint32_t));
+		if(*lookup == NULL) {
+			perror("[fountain] prepare_fountain failed to allocate\n");
+			exit(3);
+		}
+		for (uint32_t i=0; i<slices; i++)
+			(*lookup)[i] = i;
+		indexed_shuffle32(*index, *lookup, slices);
+	}
+
+	#ifdef DEBUG
+		printf("Fountain shuffle:\n");
+		printlineArray32(*index, slices);
+	#endif
+}
+
+// j-th slice of xor group group
+uint32_t fountain_member(uint32_t *index, uint32_t slices, uint32_t group, uint32_t j) {
+	return index[(group + j) % slices];
+}
+
+// i-th xor group holding the slice at shuffled position pos
+uint32_t fountain_group(uint32_t pos, uint32_t slices, uint32_t i) {
+	return (pos < i) ? (slices + pos - i) : (pos - i);
+}
@@ -32,6 +32,7 @@
 /* Ranq1 supports 10^12 calls, we only need one good shuffle */
 
 void seed(uint64_t seed);
+void reseed(uint64_t seed);	// restart from the IV, independent shuffles per source block
 
 uint32_t int32();
 uint64_t int64();
@@ -50,4 +51,18 @@ void printlineArray32(uint32_t arr[], uint32_t n);
 void shuffle32(uint32_t arr32[], uint32_t n);
 void indexed_shuffle32(uint32_t arr32[], uint32_t lookup[], uint32_t n);
 
+/* reentrant variants keep their own state, they never disturb the fountain shuffle above */
+void seed_r(uint64_t *state, uint64_t seed);
+uint64_t int64_r(uint64_t *state);
+void shuffle32_r(uint32_t arr32[], uint32_t n, uint64_t *state);
+
+/* fountain code of a source block, shared by sender, recovery and the simulations: the slices are shuffled by the
+ * generator restarted at FOUNTAIN_SEED + block (block 0 is the whole-file shuffle), xor group g covers the slices
+ * at shuffled positions g .. g+k-1 (cyclic), so the slice at position lookup[s] is in groups lookup[s]-k+1 .. lookup[s] */
+#define FOUNTAIN_SEED 777
+
+void prepare_fountain(uint32_t **index, uint32_t **lookup, uint32_t slices, uint32_t block);
+uint32_t fountain_member(uint32_t *index, uint32_t slices, uint32_t group, uint32_t j);
+uint32_t fountain_group(uint32_t pos, uint32_t slices, uint32_t i);
+
 #endif
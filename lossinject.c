@@ -0,0 +1,121 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+/*
+ * Loss injector for the loopback benchmark, loaded into datadiode-send with LD_PRELOAD: every sendto() is
+ * dropped (reported as sent) according to DD_LOSS
+ *
+ *	DD_LOSS=0.01			Bernoulli, every packet is lost with probability 0.01
+ *	DD_LOSS=ge:p,r[,bad[,good]]	Gilbert-Elliott, good->bad with probability p, bad->good with probability r,
+ *					packets are lost with probability bad (default 1) in the bad state and good (default 0)
+ *					in the good one, the mean burst is 1/r packets
+ *
+ * DD_LOSS_SEED seeds the generator (default 1), DD_LOSS_REPORT names a file the packet and drop counts are
+ * appended to at exit ("sent N dropped M"), stderr when unset
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static ssize_t (*real_sendto)(int, const void *, size_t, int, const struct sockaddr *, socklen_t) = NULL;
+
+static uint8_t gilbert = 0;
+static double loss = 0, p_gb = 0, p_bg = 1, loss_bad = 1, loss_good = 0;
+static uint64_t seed = 1;
+static uint64_t packets = 0, dropped = 0;
+
+// every sending thread has its own generator and channel state
+static __thread uint64_t state = 0;
+static __thread uint8_t bad = 0;
+
+static double uniform() {
+	// xorshift64*
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return (state * 2685821657736338717ULL >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int lost() {
+	if(state == 0)
+		state = seed * 0x9E3779B97F4A7C15ULL + (uint64_t)gettid();
+	if(!gilbert)
+		return uniform() < loss;
+	bad = bad ? (uniform() >= p_bg) : (uniform() < p_gb);
+	return uniform() < (bad ? loss_bad : loss_good);
+}
+
+// transfers of -F run in their own processes, each one counts and draws for itself
+static void lossinject_fork() {
+	state = 0;
+	packets = dropped = 0;
+}
+
+__attribute__((constructor)) static void lossinject_init() {
+	char *model = getenv("DD_LOSS"), *s = getenv("DD_LOSS_SEED");
+
+	real_sendto = dlsym(RTLD_NEXT, "sendto");
+	pthread_atfork(NULL, NULL, lossinject_fork);
+	if(s != NULL)
+		seed = strtoull(s, NULL, 10);
+	if(model == NULL)
+		return;
+	if(strncmp(model, "ge:", 3) == 0) {
+		gilbert = 1;
+		if(sscanf(model + 3, "%lf,%lf,%lf,%lf", &p_gb, &p_bg, &loss_bad, &loss_good) < 2)
+			fprintf(stderr, "[lossinject] DD_LOSS=ge:p,r[,bad[,good]], got %s\n", model);
+	}
+	else
+		loss = atof(model);
+}
+
+__attribute__((destructor)) static void lossinject_report() {
+	char line[128], *path = getenv("DD_LOSS_REPORT");
+	int fd = 2;
+
+	int n = snprintf(line, sizeof(line), "sent %lu dropped %lu\n", packets, dropped);
+	if(path != NULL && (fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644)) == -1)
+		return;
+	if(write(fd, line, n) < n)
+		perror("[lossinject] report");
+	if(fd != 2)
+		close(fd);
+}
+
+ssize_t sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *dest, socklen_t addrlen) {
+	__atomic_fetch_add(&packets, 1, __ATOMIC_RELAXED);
+	if(lost()) {
+		__atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+		return len;
+	}
+	return real_sendto(fd, buf, len, flags, dest, addrlen);
+}
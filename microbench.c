@@ -0,0 +1,393 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+/*
+ * Microbenchmarks of the per-packet and per-slice kernels. The kernels live in the programs themselves, so this file
+ * is built once per program with the program source included and its main() renamed:
+ *
+ *	-DBENCH_SEND		serialize(), fill_xor_block(), fill_xor_data(), add_checksum(), shuffle32(), indexed_shuffle32()
+ *	-DBENCH_RECV		process_data() into a tmpfs directory, new slices and duplicates
+ *	-DBENCH_RECOVERY	get_checksum(), unxor_from_checksum(), unxor_clears_from_xor_file(), recovery_layer1()
+ *
+ * One line per kernel: ns/op (best of REPEATS runs), bytes/cycle (hardware cycle counter, else the TSC) and heap
+ * allocations per op (malloc/calloc/realloc, counted by linking with --wrap). CSV by default, JSON lines with -j.
+ */
+
+#define main program_main
+#if defined(BENCH_SEND)
+#include "datadiode-send.c"
+#define PROGRAM "send"
+#elif defined(BENCH_RECV)
+#include "datadiode-recv.c"
+#define PROGRAM "recv"
+#elif defined(BENCH_RECOVERY)
+#include "datadiode-recovery.c"
+#define PROGRAM "recovery"
+#else
+#error "build with -DBENCH_SEND, -DBENCH_RECV or -DBENCH_RECOVERY"
+#endif
+#undef main
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define REPEATS 5
+#define BENCH_SLICES 4096	// source block of the file based kernels
+#define SHUFFLE_LEN 65536
+
+uint64_t TARGET_NS = 50000000;	// one run lasts at least this long, -t ms
+char *BENCH_DIR = "/dev/shm";	// tmpfs for the file based kernels, -d
+uint8_t JSON = 0;
+uint8_t HEADER = 1;
+
+/* allocation counter, the link wraps malloc, calloc and realloc */
+uint64_t allocations = 0;
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+void *__wrap_malloc(size_t size) { allocations++; return __real_malloc(size); }
+void *__wrap_calloc(size_t n, size_t size) { allocations++; return __real_calloc(n, size); }
+void *__wrap_realloc(void *p, size_t size) { allocations++; return __real_realloc(p, size); }
+
+/* cycles: the core cycle counter when perf events are allowed, the TSC otherwise */
+int cycles_fd = -1;
+
+void cycles_open() {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	cycles_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+uint64_t cycles() {
+	uint64_t count = 0;
+	if(cycles_fd != -1 && read(cycles_fd, &count, sizeof(count)) == sizeof(count))
+		return count;
+	#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+	#else
+		return 0;
+	#endif
+}
+
+uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+typedef struct {
+	const char *name;
+	size_t bytes;			// bytes processed by one op
+	void (*setup)(void);		// untimed, before every op; kernels with setup are timed op by op
+	void (*run)(void);
+} kernel_t;
+
+void report(kernel_t *k, uint64_t ops, double ns, double cyc, double allocs) {
+	double per_cycle = (cyc > 0) ? k->bytes / cyc : 0;
+	if(JSON)
+		printf("{\"program\":\"%s\",\"kernel\":\"%s\",\"bytes\":%zu,\"ops\":%lu,\"ns_per_op\":%.1f,\"bytes_per_cycle\":%.4f,\"allocs_per_op\":%.2f}\n",
+			PROGRAM, k->name, k->bytes, ops, ns, per_cycle, allocs);
+	else
+		printf("%s,%s,%zu,%lu,%.1f,%.4f,%.2f\n", PROGRAM, k->name, k->bytes, ops, ns, per_cycle, allocs);
+	fflush(stdout);
+}
+
+// ops runs of the kernel, setup excluded; returns the allocations of the timed part
+uint64_t measure(kernel_t *k, uint64_t ops, uint64_t *ns, uint64_t *cyc) {
+	uint64_t untimed = 0;
+
+	*ns = *cyc = 0;
+	allocations = 0;
+	if(k->setup == NULL) {
+		uint64_t t0 = now_ns(), c0 = cycles();
+		for(uint64_t i=0; i<ops; i++)
+			k->run();
+		*cyc = cycles() - c0;
+		*ns = now_ns() - t0;
+	}
+	else for(uint64_t i=0; i<ops; i++) {
+		uint64_t a = allocations;
+		k->setup();
+		untimed += allocations - a;
+		uint64_t t0 = now_ns(), c0 = cycles();
+		k->run();
+		*cyc += cycles() - c0;
+		*ns += now_ns() - t0;
+	}
+	return allocations - untimed;
+}
+
+void bench(kernel_t *k) {
+	uint64_t ops = 1, ns, cyc, allocs = 0;
+	double best_ns = 0, best_cyc = 0;
+
+	// warm up and find how many ops last TARGET_NS
+	while(measure(k, ops, &ns, &cyc), ns < TARGET_NS / 4 && ops < (1ULL << 40))
+		ops *= 2;
+	if(ns < TARGET_NS)
+		ops = ops * TARGET_NS / (ns ? ns : 1);
+
+	for(int r=0; r<REPEATS; r++) {
+		allocs = measure(k, ops, &ns, &cyc);
+		if(r == 0 || (double)ns / ops < best_ns) {
+			best_ns = (double)ns / ops;
+			best_cyc = (double)cyc / ops;
+		}
+	}
+	report(k, ops, best_ns, best_cyc, (double)allocs / ops);
+}
+
+// test data only, the programs keep their own generators
+uint64_t bench_state = 0x9E3779B97F4A7C15ULL;
+
+uint32_t bench_random() {
+	bench_state ^= bench_state >> 12;
+	bench_state ^= bench_state << 25;
+	bench_state ^= bench_state >> 27;
+	return (bench_state * 2685821657736338717ULL) >> 32;
+}
+
+void fill_random(unsigned char *buf, size_t len) {
+	for(size_t i=0; i<len; i++)
+		buf[i] = bench_random();
+}
+
+int bench_file(char *name, unsigned char *data, size_t len) {
+	char p[512];
+	snprintf(p, sizeof(p), "%s/%s", BENCH_DIR, name);
+	int fd = open(p, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if(fd == -1 || (len > 0 && pwrite(fd, data, len, 0) != (ssize_t)len)) {
+		perror("[microbench] bench file");
+		exit(1);
+	}
+	unlink(p);
+	return fd;
+}
+
+#if defined(BENCH_SEND)
+unsigned char *block, xored[DATALEN], checksum_buf[DATALEN], msg[MAXBUFLEN];
+uint32_t *index_arr, *lookup_arr, *shuffle_arr, group = 0;
+int block_fd;
+packet_t packet;
+
+void run_serialize() { serialize(packet, msg); }
+void run_fill_xor_block() { fill_xor_block(block, index_arr, group++ % BENCH_SLICES, BENCH_SLICES, xored); }
+void run_fill_xor_data() { fill_xor_data(block_fd, index_arr, group++ % BENCH_SLICES, BENCH_SLICES, xored); }
+void run_add_checksum() { add_checksum(block, 1, checksum_buf); }
+void run_shuffle32() { shuffle32(shuffle_arr, SHUFFLE_LEN); }
+void run_indexed_shuffle32() { indexed_shuffle32(shuffle_arr, lookup_arr, SHUFFLE_LEN); }
+
+void kernels() {
+	block = (unsigned char *)malloc((size_t)BENCH_SLICES * DATALEN);
+	shuffle_arr = (uint32_t *)malloc(SHUFFLE_LEN * sizeof(uint32_t));
+	if(block == NULL || shuffle_arr == NULL) {
+		perror("[microbench] malloc");
+		exit(1);
+	}
+	fill_random(block, (size_t)BENCH_SLICES * DATALEN);
+	block_fd = bench_file("microbench.send", block, (size_t)BENCH_SLICES * DATALEN);
+	prepare_fountain(&index_arr, &lookup_arr, BENCH_SLICES, 0);
+	free(lookup_arr);
+	lookup_arr = (uint32_t *)malloc(SHUFFLE_LEN * sizeof(uint32_t));
+	for(uint32_t i=0; i<SHUFFLE_LEN; i++)
+		shuffle_arr[i] = lookup_arr[i] = i;
+	packet.file_path = "microbench.bin";
+	packet.file_size = BENCH_SLICES * DATALEN;
+	packet.part_no = 1;
+	packet.data = block;
+
+	kernel_t list[] = {
+		{ "serialize", MAXBUFLEN, NULL, run_serialize },
+		{ "fill_xor_block_4", 4 * DATALEN, NULL, run_fill_xor_block },
+		{ "fill_xor_block_8", 8 * DATALEN, NULL, run_fill_xor_block },
+		{ "fill_xor_data_4", 4 * DATALEN, NULL, run_fill_xor_data },
+		{ "add_checksum", DATALEN, NULL, run_add_checksum },
+		{ "shuffle32", SHUFFLE_LEN * sizeof(uint32_t), NULL, run_shuffle32 },
+		{ "indexed_shuffle32", SHUFFLE_LEN * sizeof(uint32_t), NULL, run_indexed_shuffle32 },
+	};
+	for(uint32_t i=0; i<sizeof(list) / sizeof(list[0]); i++) {
+		XOR_GROUP_SIZE = (strstr(list[i].name, "_8") != NULL) ? 8 : 4;
+		bench(&list[i]);
+	}
+}
+#endif
+
+#if defined(BENCH_RECV)
+unsigned char packet_buf[MAXBUFLEN];
+receive_thread_arg_t bench_args;
+char clear_name[] = "_clear_data.in", clear_list_name[] = "_clear_list.in";
+uint32_t part = 0;
+
+void set_part(uint32_t part_no) {
+	for(uint8_t i=0; i<sizeof(uint32_t); i++)
+		packet_buf[FILEIDLEN + TOTALLEN + i] = (part_no >> ((3-i)*8)) & 0xFF;
+}
+
+// the temp files of the transfer start empty once every slice of the block was written
+void setup_new_slice() {
+	if(part % BENCH_SLICES == 0) {
+		char p[512];
+		snprintf(p, sizeof(p), "%s/microbench.bin%s", BENCH_DIR, clear_list_name);
+		truncate(p, 0);
+	}
+	set_part(part++ % BENCH_SLICES + 1);
+}
+
+void run_process_data() { process_data(&bench_args, packet_buf); }
+
+void kernels() {
+	char p[512];
+
+	memset(packet_buf, 0, sizeof(packet_buf));
+	strcpy((char *)packet_buf, "microbench.bin");
+	fill_random(packet_buf + FILEIDLEN + TOTALLEN + PARTLEN, DATALEN);
+	bench_args.temp_folder = BENCH_DIR;
+	bench_args.file_path = clear_name;
+	bench_args.slice_path = clear_list_name;
+	bench_args.stats = &STATS[0];
+
+	kernel_t list[] = {
+		{ "process_data_new", DATALEN, setup_new_slice, run_process_data },
+		{ "process_data_duplicate", DATALEN, NULL, run_process_data },
+	};
+	bench(&list[0]);
+	set_part(1);
+	bench(&list[1]);
+
+	snprintf(p, sizeof(p), "%s/microbench.bin%s", BENCH_DIR, clear_name);
+	unlink(p);
+	snprintf(p, sizeof(p), "%s/microbench.bin%s", BENCH_DIR, clear_list_name);
+	unlink(p);
+}
+#endif
+
+#if defined(BENCH_RECOVERY)
+#define BENCH_LOSS 10		// percent of clear slices missing before recovery_layer1()
+
+unsigned char *clear_orig, *xor_orig, *clear_list_orig, *xor_list_orig, *remaining_buf;
+unsigned char slice_buf[DATALEN], checksum_buf[DATALEN];
+uint32_t *index_arr, *lookup_arr;
+int clearfd, xorfd, slclearfd, slxorfd, checkfd;
+
+// the block as it arrived: every xor group, all but BENCH_LOSS percent of the clear slices
+void restore() {
+	size_t size = (size_t)BENCH_SLICES * DATALEN;
+	if(pwrite(clearfd, clear_orig, size, 0) != (ssize_t)size || pwrite(xorfd, xor_orig, size, 0) != (ssize_t)size ||
+		pwrite(slclearfd, clear_list_orig, BENCH_SLICES, 0) != BENCH_SLICES || pwrite(slxorfd, xor_list_orig, BENCH_SLICES, 0) != BENCH_SLICES) {
+		perror("[microbench] restore");
+		exit(1);
+	}
+	for(uint32_t i=0; i<BENCH_SLICES; i++)
+		remaining_buf[i] = XOR_GROUP_SIZE;
+}
+
+void setup_layer1() {
+	restore();
+	unxor_clears_from_xor_file(clearfd, xorfd, slclearfd, slxorfd, checksum_buf, remaining_buf, BENCH_SLICES, 0, lookup_arr);
+}
+
+void run_get_checksum() { free(get_checksum(checkfd)); }
+void run_unxor_from_checksum() { unxor_from_checksum(slice_buf, checksum_buf); }
+void run_unxor_clears() { unxor_clears_from_xor_file(clearfd, xorfd, slclearfd, slxorfd, checksum_buf, remaining_buf, BENCH_SLICES, 0, lookup_arr); }
+void run_layer1() { recovery_layer1(clearfd, xorfd, slclearfd, slxorfd, BENCH_SLICES, 0, checksum_buf, remaining_buf, index_arr, lookup_arr); }
+
+void kernels() {
+	size_t size = (size_t)BENCH_SLICES * DATALEN;
+	unsigned char header[FILEIDLEN + TOTALLEN + DATALEN];
+
+	clear_orig = (unsigned char *)malloc(size);
+	xor_orig = (unsigned char *)calloc(size, 1);
+	clear_list_orig = (unsigned char *)malloc(BENCH_SLICES);
+	xor_list_orig = (unsigned char *)malloc(BENCH_SLICES);
+	remaining_buf = (unsigned char *)malloc(BENCH_SLICES);
+	if(clear_orig == NULL || xor_orig == NULL || clear_list_orig == NULL || xor_list_orig == NULL || remaining_buf == NULL) {
+		perror("[microbench] malloc");
+		exit(1);
+	}
+	fill_random(clear_orig, size);
+	prepare_fountain(&index_arr, &lookup_arr, BENCH_SLICES, 0);
+	for(uint32_t g=0; g<BENCH_SLICES; g++)
+		for(uint32_t j=0; j<XOR_GROUP_SIZE; j++) {
+			unsigned char *s = clear_orig + (size_t)fountain_member(index_arr, BENCH_SLICES, g, j) * DATALEN;
+			for(uint32_t i=0; i<DATALEN; i++)
+				xor_orig[(size_t)g * DATALEN + i] ^= s[i];
+		}
+	for(uint32_t i=0; i<BENCH_SLICES; i++) {
+		clear_list_orig[i] = (bench_random() % 100 < BENCH_LOSS) ? 0 : MAGICNUMBER;
+		xor_list_orig[i] = MAGICNUMBER;
+	}
+	fill_random(header, sizeof(header));
+	fill_random(slice_buf, DATALEN);
+
+	clearfd = bench_file("microbench.clear", NULL, 0);
+	xorfd = bench_file("microbench.xor", NULL, 0);
+	slclearfd = bench_file("microbench.clear_list", NULL, 0);
+	slxorfd = bench_file("microbench.xor_list", NULL, 0);
+	checkfd = bench_file("microbench.checksum", header, sizeof(header));
+
+	kernel_t list[] = {
+		{ "get_checksum", DATALEN, NULL, run_get_checksum },
+		{ "unxor_from_checksum", DATALEN, NULL, run_unxor_from_checksum },
+		{ "unxor_clears_from_xor_file", size, restore, run_unxor_clears },
+		{ "recovery_layer1", size, setup_layer1, run_layer1 },
+	};
+	for(uint32_t i=0; i<sizeof(list) / sizeof(list[0]); i++)
+		bench(&list[i]);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+	int opt;
+
+	while((opt = getopt(argc, argv, "jHd:t:")) != -1) {
+		switch(opt) {
+		case 'j': JSON = 1; break;
+		case 'H': HEADER = 0; break;
+		case 'd': BENCH_DIR = optarg; break;
+		case 't': TARGET_NS = (uint64_t)atoi(optarg) * 1000000ULL; break;
+		default:
+			fprintf(stderr, "[usage] <program> [-j] [-H] [-d tmpfs-dir] [-t ms]\n");
+			fprintf(stderr, "[usage] -j JSON lines instead of CSV, -H no CSV header, -d directory of the file based kernels\n");
+			fprintf(stderr, "[usage] (default %s), -t minimum duration of one of the %d timed runs (default %lu)\n",
+				BENCH_DIR, REPEATS, TARGET_NS / 1000000);
+			exit(1);
+		}
+	}
+
+	cycles_open();
+	if(HEADER && !JSON)
+		printf("program,kernel,bytes,ops,ns_per_op,bytes_per_cycle,allocs_per_op\n");
+	kernels();
+
+	return 0;
+}
@@ -0,0 +1,344 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include <string.h>
+#include <math.h>
+#include "planner.h"
+#include "fountain.h"
+#include "schedule.h"
+
+/* search space of the planner */
+#define PLAN_MAX_CLEAR_SPRAY 8
+#define PLAN_MAX_SPRAY 12
+#define PLAN_MODEL_SLICES 4096		// Monte-Carlo runs on at most this many slices, failure rate is scaled to the file
+#define PLAN_MODEL_PACKETS 2000000	// packets simulated per candidate
+#define PLAN_MAX_MONTECARLO 64		// candidates verified by Monte-Carlo before giving up
+#define PLAN_ANALYTIC_ERROR 2.0		// the analytic estimate is within this factor of the simulation (datadiode-sim)
+
+static const uint8_t group_sizes[] = {2, 3, 4, 5, 6, 8};
+
+/* one-sided 95% upper bound of the mean number of failures when failed were seen, within 5% of the Poisson bound
+ * (3 for none, the rule of three) */
+static double failure_bound(uint32_t failed) {
+	return failed + 1.645 * sqrt(failed + 1.0) + 1.5;
+}
+
+static double uniform_r(uint64_t *state) {
+	return (int64_r(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void channel_init(channel_t *ch, double loss, double burst, uint64_t seed) {
+	ch->loss = loss;
+	ch->bernoulli = (burst <= 1.0 || loss <= 0.0 || loss >= 1.0);
+	ch->p_bg = (burst > 1.0) ? 1.0 / burst : 1.0;
+	// stationary share of the bad state equals the average loss
+	ch->p_gb = (loss < 1.0) ? loss * ch->p_bg / (1.0 - loss) : 1.0;
+	seed_r(&(ch->state), seed);
+	channel_reset(ch);
+}
+
+// start in the good state, e.g. after a pause that drained the receiver buffers
+void channel_reset(channel_t *ch) {
+	ch->bad = 0;
+}
+
+uint8_t channel_drop(channel_t *ch) {
+	if(ch->bernoulli)
+		return uniform_r(&(ch->state)) < ch->loss;
+
+	if(ch->bad) {
+		if(uniform_r(&(ch->state)) < ch->p_bg)
+			ch->bad = 0;
+	}
+	else if(uniform_r(&(ch->state)) < ch->p_gb)
+		ch->bad = 1;
+	return ch->bad;
+}
+
+/* same rules as recovery_layer1() in datadiode-recovery.c on presence flags only, on the group layout of fountain.c:
+ * a stored group with one unknown component reveals it.
+ * Returns the number of slices left unrecovered, have_clear is updated with the recovered slices. */
+uint32_t peel_decode(uint32_t slices, uint8_t xor_group_size, uint32_t *index, uint32_t *lookup,
+	uint8_t *have_clear, uint8_t *have_xor) {
+	uint8_t *remaining = (uint8_t *)malloc(slices * sizeof(uint8_t));
+	uint32_t *queue = (uint32_t *)malloc(slices * sizeof(uint32_t));
+	if(remaining == NULL || queue == NULL) {
+		perror("[planner] peel_decode failed to allocate\n");
+		exit(1);
+	}
+	for(uint32_t g=0; g<slices; g++)
+		remaining[g] = xor_group_size;
+
+	// un-xor clear slices from the groups they are part of
+	for(uint32_t s=0; s<slices; s++) {
+		if(!have_clear[s])
+			continue;
+		uint32_t pos = lookup[s];
+		for(uint32_t i=0; i<xor_group_size; i++) {
+			uint32_t g = fountain_group(pos, slices, i);
+			if(have_xor[g])
+				remaining[g]--;
+		}
+	}
+
+	uint32_t head = 0, tail = 0;
+	for(uint32_t g=0; g<slices; g++)
+		if(have_xor[g] && remaining[g] == 1)
+			queue[tail++] = g;
+
+	while(head < tail) {
+		uint32_t g = queue[head++];
+		for(uint32_t j=0; j<xor_group_size; j++) {
+			uint32_t s = fountain_member(index, slices, g, j);
+			if(have_clear[s])
+				continue;
+			have_clear[s] = 1;
+			uint32_t pos = lookup[s];
+			for(uint32_t i=0; i<xor_group_size; i++) {
+				uint32_t k = fountain_group(pos, slices, i);
+				if(have_xor[k] && --remaining[k] == 1 && tail < slices)
+					queue[tail++] = k;
+			}
+		}
+	}
+
+	uint32_t missing = 0;
+	for(uint32_t s=0; s<slices; s++)
+		if(!have_clear[s])
+			missing++;
+
+	free(remaining);
+	free(queue);
+	return missing;
+}
+
+/* Gilbert-Elliott channel as a Markov chain: probability that a packet d packets after a lost one is lost as well */
+static double loss_after(loss_model_t *model, double d) {
+	double loss = model->loss;
+	if(model->burst <= 1.0 || loss <= 0.0 || loss >= 1.0)
+		return loss;
+	double p_bg = 1.0 / model->burst;
+	double memory = 1.0 - loss * p_bg / (1.0 - loss) - p_bg;
+	return (memory > 0.0) ? loss + (1.0 - loss) * pow(memory, d) : loss;
+}
+
+/* union bound over the stopping sets of the peeling decoder. The xor groups are windows of xor_group_size slices over
+ * the fountain shuffle, neighbouring groups share all but one slice and a group only reveals its last unknown slice:
+ *	- a lost slice whose xor_group_size groups are all lost
+ *	- a run of lost slices, or two lost slices d < xor_group_size apart, with the d groups at either end lost;
+ *	  the groups in between hold two unknowns
+ * Groups xor_group_size ids apart (the two ends) share an interleaver window in every round, so one loss burst can
+ * take both; copies of a packet are a round apart. A lower bound: larger stopping sets are left out. */
+double plan_analytic(uint32_t slices, loss_model_t *model, uint32_t depth, redundancy_t *r) {
+	uint32_t k = r->xor_group_size;
+	double loss = model->loss;
+	double apart = loss_after(model, slices);
+	double e0 = loss * pow(apart, r->clear_spray);	// every clear copy of a slice lost
+	double u = e0;
+
+	if(r->spray > 0 && e0 < 1.0) {
+		double group = loss * pow(apart, r->spray - 1);
+
+		// distance of ids k apart in a round: k*stride mod n, moved by the shuffle inside windows of stride/8
+		// (any two positions without interleaver); U1 - U2 is triangular on (-window, window)
+		double dist = slices / 3.0, window = 0.0, ends = 0.0;
+		if(depth > 1) {
+			uint32_t stride = schedule_stride(slices, depth);
+			dist = (double)(((uint64_t)k * stride) % slices);
+			if(dist > slices - dist)
+				dist = slices - dist;
+			window = (stride / 8) ? stride / 8 : 1;
+		}
+		double packets = (double)(r->clear_spray + r->spray) / r->spray;	// shuffled phase packets per xor packet
+		for(int i=0; i<64; i++) {
+			double x = (2.0 * (i + 0.5) / 64 - 1.0) * window;
+			ends += (1.0 - fabs(2.0 * (i + 0.5) / 64 - 1.0)) / 32.0 * loss_after(model, fabs(dist + x) * packets);
+		}
+		double pair = pow(loss * ends, r->spray);	// both end groups lost in every round
+
+		u = e0 * pow(group, k) + e0 * e0 * pair / (1.0 - e0);
+		for(uint32_t d=2; d<k; d++)
+			u += e0 * e0 * pow(pair, d);
+	}
+
+	// probability that at least one of the slices is missing
+	if(u >= 1.0)
+		return 1.0;
+	return -expm1(slices * log1p(-u));
+}
+
+/* an upper bound that leaves out the xor groups: a slice is only missing when every clear copy of it was lost */
+double plan_clear_bound(uint32_t slices, loss_model_t *model, redundancy_t *r) {
+	double e0 = model->loss * pow(loss_after(model, slices), r->clear_spray);
+
+	if(e0 >= 1.0)
+		return 1.0;
+	return -expm1(slices * log1p(-e0));
+}
+
+/* send the whole transmission plan through the channel, have_clear and have_xor mark the slices that arrived.
+ * Returns the number of packets sent. */
+uint64_t plan_channel(txplan_t *plan, channel_t *ch, uint8_t *have_clear, uint8_t *have_xor) {
+	uint64_t packets = 0;
+	uint32_t part;
+	tx_stream_t stream;
+
+	channel_reset(ch);
+	while((stream = txplan_next(plan, &part)) != TX_DONE) {
+		if(stream == TX_PAUSE) {
+			channel_reset(ch);
+			continue;
+		}
+		packets++;
+		if(channel_drop(ch))
+			continue;
+		if(stream == TX_CLEAR)
+			have_clear[part - 1] = 1;
+		else if(stream == TX_XOR)
+			have_xor[part - 1] = 1;
+	}
+	return packets;
+}
+
+/* run the real transmission plan through the channel, failed counts the blocks of the model size that were not recovered.
+ * Returns the upper bound of the failure rate scaled to the file, no failure does not mean a probability of 0. */
+double plan_montecarlo(uint32_t slices, loss_model_t *model, uint32_t depth, redundancy_t *r, uint32_t trials, uint64_t seed,
+	uint32_t *failed) {
+	uint32_t n = (slices < PLAN_MODEL_SLICES) ? slices : PLAN_MODEL_SLICES;
+	if(n < r->xor_group_size)
+		n = r->xor_group_size;
+
+	uint32_t *index = (uint32_t *)malloc(n * sizeof(uint32_t));
+	uint32_t *lookup = (uint32_t *)malloc(n * sizeof(uint32_t));
+	uint8_t *have_clear = (uint8_t *)malloc(n * sizeof(uint8_t));
+	uint8_t *have_xor = (uint8_t *)malloc(n * sizeof(uint8_t));
+	if(index == NULL || lookup == NULL || have_clear == NULL || have_xor == NULL) {
+		perror("[planner] plan_montecarlo failed to allocate\n");
+		exit(2);
+	}
+
+	channel_t ch;
+	channel_init(&ch, model->loss, model->burst, seed);
+	uint64_t state;
+	seed_r(&state, seed ^ 0x5DEECE66DLL);
+
+	*failed = 0;
+	for(uint32_t t=0; t<trials; t++) {
+		// any fountain shuffle is as good as the one of the file
+		for(uint32_t i=0; i<n; i++)
+			index[i] = i;
+		shuffle32_r(index, n, &state);
+		for(uint32_t i=0; i<n; i++)
+			lookup[index[i]] = i;
+		memset(have_clear, 0, n);
+		memset(have_xor, 0, n);
+
+		txplan_t plan;
+		txplan_init(&plan, n, index, r->clear_spray, r->spray, 20, int64_r(&state), depth ? depth : r->xor_group_size);
+		plan_channel(&plan, &ch, have_clear, have_xor);
+		txplan_free(&plan);
+
+		if(peel_decode(n, r->xor_group_size, index, lookup, have_clear, have_xor) > 0)
+			(*failed)++;
+	}
+
+	free(index);
+	free(lookup);
+	free(have_clear);
+	free(have_xor);
+
+	double f = failure_bound(*failed) / trials;
+	if(f >= 1.0)
+		return 1.0;
+	return -expm1(((double)slices / n) * log1p(-f));
+}
+
+/* cheapest redundancy meeting model->target; best holds the command line values on entry, used when nothing qualifies.
+ * The analytic estimate preselects, Monte-Carlo decides with as many trials as the target needs (~3/target per block).
+ * The analytic estimate is a lower bound and only preselects. When the budget does not reach that many trials a candidate
+ * without a single failure is taken if the clear copies alone meet the target (plan_clear_bound), p_bound is that
+ * bound then. Returns 0 if a candidate qualified, -2 if short runs without failures were all that stood in the way
+ * (the target is below what the simulation can show for this file), -1 otherwise; best is only written on 0. */
+int plan_redundancy(uint32_t slices, loss_model_t *model, uint32_t depth, redundancy_t *best) {
+	uint32_t simulated = 0, short_runs = 0;
+
+	// the target of a block of the model size, and the trials that show it without a failure
+	uint32_t n = (slices < PLAN_MODEL_SLICES) ? slices : PLAN_MODEL_SLICES;
+	double block_target = -expm1(log1p(-model->target) * n / slices);
+	double needed = ceil(failure_bound(0) / block_target);
+
+	for(uint32_t cost=1; cost<=1+PLAN_MAX_CLEAR_SPRAY+PLAN_MAX_SPRAY; cost++) {
+		for(uint32_t spray=0; spray<cost && spray<=PLAN_MAX_SPRAY; spray++) {
+			uint32_t clear_spray = cost - 1 - spray;
+			if(clear_spray > PLAN_MAX_CLEAR_SPRAY)
+				continue;
+
+			for(uint32_t k=0; k<sizeof(group_sizes); k++) {
+				redundancy_t r;
+				// without xor packets the group size does not matter
+				r.xor_group_size = (spray == 0) ? best->xor_group_size : group_sizes[k];
+				r.clear_spray = clear_spray;
+				r.spray = spray;
+				r.cost = cost;
+
+				r.p_fail = plan_analytic(slices, model, depth ? depth : r.xor_group_size, &r);
+				if(r.p_fail <= PLAN_ANALYTIC_ERROR * model->target) {
+					if(simulated++ >= PLAN_MAX_MONTECARLO)
+						return short_runs ? -2 : -1;
+
+					uint32_t trials = PLAN_MODEL_PACKETS / ((uint64_t)n * cost + 20), failed;
+					// up to 10x the minimum, a candidate somewhat below the target passes with a few failures
+					if(trials < 10)
+						trials = 10;
+					if(trials > 10 * needed)
+						trials = 10 * needed;
+					r.p_bound = plan_montecarlo(slices, model, depth, &r, trials, slices, &failed);
+
+					#ifdef DEBUG2
+						printf("[planner] xor=%u clear_spray=%u spray=%u analytic=%g montecarlo<=%g (%u of %u trials failed)\n",
+							r.xor_group_size, r.clear_spray, r.spray, r.p_fail, r.p_bound, failed, trials);
+					#endif
+
+					if(r.p_bound <= model->target) {
+						*best = r;
+						return 0;
+					}
+					if(trials < needed && failed == 0) {
+						r.p_bound = plan_clear_bound(slices, model, &r);
+						if(r.p_bound <= model->target) {
+							*best = r;
+							return 0;
+						}
+						short_runs++;
+					}
+				}
+
+				if(spray == 0)
+					break;
+			}
+		}
+	}
+
+	return short_runs ? -2 : -1;
+}
@@ -0,0 +1,77 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __PLANNER_FOUNTAIN__
+#define __PLANNER_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "schedule.h"
+
+/* Redundancy planner: picks XOR_GROUP_SIZE, CLEAR_SPRAY and SPRAY for one file from a measured loss profile.
+ * Candidates are ranked by packets sent per slice (1 sequential + CLEAR_SPRAY + SPRAY). A union bound over the small
+ * stopping sets of the peeling decoder of datadiode-recovery preselects them, a Monte-Carlo run of the real transmission
+ * plan through a Gilbert-Elliott channel and the same peeling rules decides. */
+
+typedef struct {
+	double loss;		// average packet loss rate 0..1
+	double burst;		// mean length of a loss burst in packets, <= 1 for independent losses
+	double target;		// acceptable probability that a file cannot be recovered
+} loss_model_t;
+
+typedef struct {
+	uint8_t xor_group_size;
+	uint8_t clear_spray;
+	uint8_t spray;
+	uint32_t cost;		// packets per slice
+	double p_fail;		// analytic estimate of the probability that recovery fails
+	double p_bound;		// Monte-Carlo 95% upper bound of that probability, or plan_clear_bound when the trials are too few
+} redundancy_t;
+
+/* Gilbert-Elliott channel: no loss in the good state, every packet lost in the bad state */
+typedef struct {
+	double p_gb;		// good -> bad
+	double p_bg;		// bad -> good
+	double loss;
+	uint8_t bad;
+	uint8_t bernoulli;
+	uint64_t state;
+} channel_t;
+
+void channel_init(channel_t *ch, double loss, double burst, uint64_t seed);
+void channel_reset(channel_t *ch);
+uint8_t channel_drop(channel_t *ch);
+
+uint32_t peel_decode(uint32_t slices, uint8_t xor_group_size, uint32_t *index, uint32_t *lookup,
+	uint8_t *have_clear, uint8_t *have_xor);
+
+uint64_t plan_channel(txplan_t *plan, channel_t *ch, uint8_t *have_clear, uint8_t *have_xor);
+double plan_analytic(uint32_t slices, loss_model_t *model, uint32_t depth, redundancy_t *r);
+double plan_clear_bound(uint32_t slices, loss_model_t *model, redundancy_t *r);
+double plan_montecarlo(uint32_t slices, loss_model_t *model, uint32_t depth, redundancy_t *r, uint32_t trials, uint64_t seed,
+	uint32_t *failed);
+int plan_redundancy(uint32_t slices, loss_model_t *model, uint32_t depth, redundancy_t *best);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include "protocol.h"
+
+// write big endian value on len bytes
+static void put_be(unsigned char *p, uint64_t value, uint8_t len) {
+	for(uint8_t i=0; i<len; i++)
+		*(p + i) = (value >> ((len-1-i)*8)) & 0xFF;
+}
+
+static uint64_t get_be(unsigned char *p, uint8_t len) {
+	uint64_t value = 0;
+	for(uint8_t i=0; i<len; i++)
+		value = (value << 8) | *(p + i);
+	return value;
+}
+
+// serialize descriptor into the data field of a packet
+void meta_serialize(meta_t *meta, unsigned char *data) {
+	memset(data, 0, METALEN);
+	put_be(data + 0, META_VERSION, 1);
+	put_be(data + 1, meta->xor_group_size, 1);
+	put_be(data + 2, meta->spray, 1);
+	put_be(data + 3, meta->clear_spray, 1);
+	put_be(data + 4, meta->flags, 4);
+	put_be(data + 8, meta->file_size, 8);
+	put_be(data + 16, meta->window, 4);
+}
+
+// returns 0 on success, -1 if the descriptor is unknown or invalid
+int meta_parse(meta_t *meta, unsigned char *data) {
+	meta->version = get_be(data + 0, 1);
+	meta->xor_group_size = get_be(data + 1, 1);
+	meta->spray = get_be(data + 2, 1);
+	meta->clear_spray = get_be(data + 3, 1);
+	meta->flags = get_be(data + 4, 4);
+	meta->file_size = get_be(data + 8, 8);
+	meta->window = get_be(data + 16, 4);
+
+	if(meta->version != META_VERSION || meta->xor_group_size == 0)
+		return -1;
+	return 0;
+}
+
+void spool_serialize(unsigned char *data, uint32_t mode, uint64_t mtime, char *name) {
+	size_t len = strlen(name);
+	put_be(data + METALEN, mode, 4);
+	put_be(data + METALEN + 4, mtime, 8);
+	put_be(data + METALEN + 12, len, 2);
+	memcpy(data + METALEN + 14, name, len);
+}
+
+// returns 0 on success, -1 if the name does not fit, name must hold SPOOL_NAMELEN + 1 bytes
+int spool_parse(unsigned char *data, uint32_t *mode, uint64_t *mtime, char *name) {
+	*mode = get_be(data + METALEN, 4);
+	*mtime = get_be(data + METALEN + 4, 8);
+	size_t len = get_be(data + METALEN + 12, 2);
+	if(len == 0 || len > SPOOL_NAMELEN)
+		return -1;
+	memcpy(name, data + METALEN + 14, len);
+	name[len] = 0;
+	return 0;
+}
+
+uint32_t block_count(uint32_t slices, uint32_t window) {
+	if(window == 0 || slices <= window)
+		return 1;
+	return slices / window;
+}
+
+void block_range(uint32_t slices, uint32_t window, uint32_t block, uint32_t *base, uint32_t *len) {
+	uint32_t blocks = block_count(slices, window);
+	if(blocks == 1) {
+		*base = 0;
+		*len = slices;
+		return;
+	}
+	*base = block * window;
+	*len = (block == blocks - 1) ? slices - *base : window;
+}
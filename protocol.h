@@ -0,0 +1,89 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __PROTOCOL_FOUNTAIN__
+#define __PROTOCOL_FOUNTAIN__
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+/* part_no of the transfer descriptor, sent on the checksum port next to checksum (0) and EOF (-1) packets */
+#define META_PART ((uint32_t)(-2))
+#define META_VERSION 1
+
+/* transfer descriptor, stored big endian in the data field of the packet
+*		Version					: 1 byte
+*		Xor group size				: 1 byte
+*		Spray					: 1 byte
+*		Clear spray				: 1 byte
+*		Flags					: 4 bytes
+*		File size				: 8 bytes
+*		Window					: 4 bytes		slices per source block, 0 = whole file
+*		TOTAL => 20 bytes			-> METALEN
+*
+*	receivers store it next to the checksum, recovery takes the xor group size from it instead of the command line
+*/
+#define METALEN 20
+
+/* flags */
+#define META_STREAM 0x1		/* sent from a pipe: file size is the data sent so far, final next to the checksum */
+#define META_CODEC_SHIFT 1		/* bits 1-2: codec of the chunked compressed object, see compress.h */
+#define META_CODEC_MASK (0x3 << META_CODEC_SHIFT)
+#define META_DELTA 0x8		/* delta object of content-defined chunks, see delta.h; expanded after the codec */
+#define META_SPOOL 0x10		/* file of a spool sent on its own, its place in the spool follows the descriptor */
+
+typedef struct {
+	uint8_t version;
+	uint8_t xor_group_size;
+	uint8_t spray;
+	uint8_t clear_spray;
+	uint32_t flags;
+	uint64_t file_size;
+	uint32_t window;
+} meta_t;
+
+void meta_serialize(meta_t *meta, unsigned char *data);
+int meta_parse(meta_t *meta, unsigned char *data);
+
+/* place of a META_SPOOL file, right after the descriptor (METALEN) in the same data field
+*		Mode					: 4 bytes
+*		Mtime					: 8 bytes
+*		Name length				: 2 bytes
+*		Relative name				: up to SPOOL_NAMELEN bytes, as a bundle member would be named
+*
+*	recovery moves the rebuilt file there, like the files it unpacks from a bundle
+*/
+#define SPOOL_NAMELEN 1024
+
+void spool_serialize(unsigned char *data, uint32_t mode, uint64_t mtime, char *name);
+int spool_parse(unsigned char *data, uint32_t *mode, uint64_t *mtime, char *name);
+
+/* source blocks of the windowed mode: window slices each, the last block also takes the remainder
+ * so that no block is shorter than the window. Xor groups never leave their block, the xor packet of
+ * local group g in block b uses part number base(b) + g + 1 like the clear slice at the same position. */
+uint32_t block_count(uint32_t slices, uint32_t window);
+void block_range(uint32_t slices, uint32_t window, uint32_t block, uint32_t *base, uint32_t *len);
+
+#endif
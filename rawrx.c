@@ -0,0 +1,423 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/filter.h>
+#include <linux/bpf.h>
+#include "rawrx.h"
+
+#define RAWRX_FRAMES 4096
+#define RAWRX_FRAME_SIZE 2048
+#define RAWRX_BLOCK_SIZE (1 << 20)
+#define RAWRX_BLOCKS 64
+#define RAWRX_QUEUES 64
+
+static int sys_bpf(int cmd, union bpf_attr *attr) {
+	return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+#define INSN(c, d, s, o, i) ((struct bpf_insn){ .code = (c), .dst_reg = (d), .src_reg = (s), .off = (o), .imm = (i) })
+
+/* XDP program: redirect IPv4/UDP packets (no options) for our ports to the socket of the rx queue
+ *	 0	r6 = ctx
+ *	 1..5	data, data_end, bounds check for the 42 header bytes
+ *	 6..15	ethertype, version/ihl, protocol, destination port
+ *	16..21	bpf_redirect_map(&xsks, rx_queue_index, XDP_PASS)
+ *	22..23	XDP_PASS */
+static int load_program(rawrx_t *rx) {
+	struct bpf_insn prog[] = {
+		INSN(BPF_ALU64 | BPF_MOV | BPF_X, 6, 1, 0, 0),
+		INSN(BPF_LDX | BPF_MEM | BPF_W, 2, 6, 0, 0),
+		INSN(BPF_LDX | BPF_MEM | BPF_W, 3, 6, 4, 0),
+		INSN(BPF_ALU64 | BPF_MOV | BPF_X, 4, 2, 0, 0),
+		INSN(BPF_ALU64 | BPF_ADD | BPF_K, 4, 0, 0, 42),
+		INSN(BPF_JMP | BPF_JGT | BPF_X, 4, 3, 16, 0),
+		INSN(BPF_LDX | BPF_MEM | BPF_H, 5, 2, 12, 0),
+		INSN(BPF_JMP | BPF_JNE | BPF_K, 5, 0, 14, htons(ETH_P_IP)),
+		INSN(BPF_LDX | BPF_MEM | BPF_B, 5, 2, 14, 0),
+		INSN(BPF_JMP | BPF_JNE | BPF_K, 5, 0, 12, 0x45),
+		INSN(BPF_LDX | BPF_MEM | BPF_B, 5, 2, 23, 0),
+		INSN(BPF_JMP | BPF_JNE | BPF_K, 5, 0, 10, IPPROTO_UDP),
+		INSN(BPF_LDX | BPF_MEM | BPF_H, 5, 2, 36, 0),
+		INSN(BPF_ALU | BPF_END | BPF_TO_BE, 5, 0, 0, 16),
+		INSN(BPF_JMP | BPF_JLT | BPF_K, 5, 0, 7, rx->port),
+		INSN(BPF_JMP | BPF_JGT | BPF_K, 5, 0, 6, rx->port + rx->nports - 1),
+		INSN(BPF_LDX | BPF_MEM | BPF_W, 2, 6, 16, 0),
+		INSN(BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD, 0, rx->map_fd),
+		INSN(0, 0, 0, 0, 0),
+		INSN(BPF_ALU64 | BPF_MOV | BPF_K, 3, 0, 0, XDP_PASS),
+		INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),
+		INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+		INSN(BPF_ALU64 | BPF_MOV | BPF_K, 0, 0, 0, XDP_PASS),
+		INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+	};
+	char license[] = "GPL";
+	union bpf_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type = BPF_MAP_TYPE_XSKMAP;
+	attr.key_size = sizeof(uint32_t);
+	attr.value_size = sizeof(uint32_t);
+	attr.max_entries = RAWRX_QUEUES;
+	rx->map_fd = sys_bpf(BPF_MAP_CREATE, &attr);
+	if(rx->map_fd == -1)
+		return -1;
+	prog[17].imm = rx->map_fd;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_XDP;
+	attr.insns = (uint64_t)(uintptr_t)prog;
+	attr.insn_cnt = sizeof(prog) / sizeof(prog[0]);
+	attr.license = (uint64_t)(uintptr_t)license;
+	attr.expected_attach_type = BPF_XDP;
+	rx->prog_fd = sys_bpf(BPF_PROG_LOAD, &attr);
+	if(rx->prog_fd == -1)
+		return -1;
+
+	// driver mode where supported, generic otherwise; the link goes away with the process
+	uint32_t modes[2] = { XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE };
+	for(int i=0; i<2 && rx->link_fd == -1; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.link_create.prog_fd = rx->prog_fd;
+		attr.link_create.target_ifindex = rx->ifindex;
+		attr.link_create.attach_type = BPF_XDP;
+		attr.link_create.flags = modes[i];
+		rx->link_fd = sys_bpf(BPF_LINK_CREATE, &attr);
+	}
+
+	return (rx->link_fd == -1) ? -1 : 0;
+}
+
+// receive queues of the interface, as listed in sysfs (1 when unknown)
+int rawrx_queues(int ifindex) {
+	char ifname[IF_NAMESIZE], path[64];
+	struct dirent *entry;
+	int n = 0;
+
+	if(if_indextoname(ifindex, ifname) == NULL)
+		return 1;
+	snprintf(path, sizeof(path), "/sys/class/net/%s/queues", ifname);
+	DIR *dir = opendir(path);
+	if(dir == NULL)
+		return 1;
+	while((entry = readdir(dir)) != NULL)
+		n += (strncmp(entry->d_name, "rx-", 3) == 0);
+	closedir(dir);
+	return (n > 0) ? n : 1;
+}
+
+static int open_xdp(rawrx_t *rx) {
+	// the socket is bound to queue 0 only, packets the NIC steers to another queue would pass to the
+	// muted UDP sockets and be lost: refused with EOPNOTSUPP, ethtool -L <iface> combined 1 makes it fit
+	if(rawrx_queues(rx->ifindex) > 1) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+	if(load_program(rx) == -1)
+		return -1;
+
+	rx->fd = socket(AF_XDP, SOCK_RAW, 0);
+	if(rx->fd == -1)
+		return -1;
+
+	rx->frames = RAWRX_FRAMES;
+	rx->frame_size = RAWRX_FRAME_SIZE;
+	rx->umem_len = (size_t)rx->frames * rx->frame_size;
+	rx->umem = mmap(NULL, rx->umem_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(rx->umem == MAP_FAILED)
+		return -1;
+
+	struct xdp_umem_reg mr;
+	memset(&mr, 0, sizeof(mr));
+	mr.addr = (uint64_t)(uintptr_t)rx->umem;
+	mr.len = rx->umem_len;
+	mr.chunk_size = rx->frame_size;
+	int n = rx->frames;
+	if(setsockopt(rx->fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) == -1 ||
+		setsockopt(rx->fd, SOL_XDP, XDP_UMEM_FILL_RING, &n, sizeof(n)) == -1 ||
+		setsockopt(rx->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &n, sizeof(n)) == -1 ||
+		setsockopt(rx->fd, SOL_XDP, XDP_RX_RING, &n, sizeof(n)) == -1)
+		return -1;
+
+	struct xdp_mmap_offsets off;
+	socklen_t optlen = sizeof(off);
+	if(getsockopt(rx->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) == -1)
+		return -1;
+
+	rx->rx_map_len = off.rx.desc + (size_t)n * sizeof(struct xdp_desc);
+	rx->rx_map = mmap(NULL, rx->rx_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, rx->fd, XDP_PGOFF_RX_RING);
+	rx->fq_map_len = off.fr.desc + (size_t)n * sizeof(uint64_t);
+	rx->fq_map = mmap(NULL, rx->fq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, rx->fd, XDP_UMEM_PGOFF_FILL_RING);
+	if(rx->rx_map == MAP_FAILED || rx->fq_map == MAP_FAILED)
+		return -1;
+	rx->rx_producer = (uint32_t *)((char *)rx->rx_map + off.rx.producer);
+	rx->rx_consumer = (uint32_t *)((char *)rx->rx_map + off.rx.consumer);
+	rx->rx_desc = (struct xdp_desc *)((char *)rx->rx_map + off.rx.desc);
+	rx->fq_producer = (uint32_t *)((char *)rx->fq_map + off.fr.producer);
+	rx->fq_consumer = (uint32_t *)((char *)rx->fq_map + off.fr.consumer);
+	rx->fq_addr = (uint64_t *)((char *)rx->fq_map + off.fr.desc);
+
+	// every frame starts in the fill ring
+	for(uint32_t i=0; i<rx->frames; i++)
+		rx->fq_addr[i] = (uint64_t)i * rx->frame_size;
+	__atomic_store_n(rx->fq_producer, rx->frames, __ATOMIC_RELEASE);
+
+	struct sockaddr_xdp sxdp;
+	memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = rx->ifindex;
+	sxdp.sxdp_queue_id = 0;
+	sxdp.sxdp_flags = XDP_ZEROCOPY;
+	if(bind(rx->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) == -1) {
+		sxdp.sxdp_flags = XDP_COPY;
+		if(bind(rx->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) == -1)
+			return -1;
+	}
+
+	uint32_t key = 0;
+	union bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd = rx->map_fd;
+	attr.key = (uint64_t)(uintptr_t)&key;
+	attr.value = (uint64_t)(uintptr_t)&(rx->fd);
+	if(sys_bpf(BPF_MAP_UPDATE_ELEM, &attr) == -1)
+		return -1;
+
+	return 0;
+}
+
+static int open_packet(rawrx_t *rx) {
+	rx->fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_IP));
+	if(rx->fd == -1)
+		return -1;
+
+	// udp to [port, port + nports), not fragmented
+	uint16_t last = rx->port + rx->nports - 1;
+	struct sock_filter code[] = {
+		BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 9),
+		BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 7),
+		BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+		BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 5, 0),
+		BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+		BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+		BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, rx->port, 0, 2),
+		BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, last, 1, 0),
+		BPF_STMT(BPF_RET | BPF_K, 0xFFFF),
+		BPF_STMT(BPF_RET | BPF_K, 0),
+	};
+	struct sock_fprog filter = { sizeof(code) / sizeof(code[0]), code };
+	if(setsockopt(rx->fd, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter)) == -1)
+		return -1;
+
+	int v = TPACKET_V3;
+	if(setsockopt(rx->fd, SOL_PACKET, PACKET_VERSION, &v, sizeof(v)) == -1)
+		return -1;
+
+	struct tpacket_req3 req;
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = RAWRX_BLOCK_SIZE;
+	req.tp_block_nr = RAWRX_BLOCKS;
+	req.tp_frame_size = RAWRX_FRAME_SIZE;
+	req.tp_frame_nr = (size_t)RAWRX_BLOCK_SIZE * RAWRX_BLOCKS / RAWRX_FRAME_SIZE;
+	req.tp_retire_blk_tov = 10;		// ms, hand over partly filled blocks
+	if(setsockopt(rx->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) == -1)
+		return -1;
+
+	rx->blocks = req.tp_block_nr;
+	rx->block_size = req.tp_block_size;
+	rx->ring_len = (size_t)req.tp_block_size * req.tp_block_nr;
+	rx->ring = mmap(NULL, rx->ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE | MAP_LOCKED, rx->fd, 0);
+	if(rx->ring == MAP_FAILED)
+		rx->ring = mmap(NULL, rx->ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, rx->fd, 0);
+	if(rx->ring == MAP_FAILED)
+		return -1;
+
+	struct sockaddr_ll sll;
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_IP);
+	sll.sll_ifindex = rx->ifindex;
+	if(bind(rx->fd, (struct sockaddr *)&sll, sizeof(sll)) == -1)
+		return -1;
+
+	return 0;
+}
+
+// returns -1 with errno set; RAWRX_AUTO tries AF_XDP first
+int rawrx_open(rawrx_t *rx, char *ifname, uint16_t port, uint16_t nports, uint8_t mode) {
+	memset(rx, 0, sizeof(rawrx_t));
+	rx->fd = rx->map_fd = rx->prog_fd = rx->link_fd = -1;
+	rx->port = port;
+	rx->nports = nports;
+
+	rx->ifindex = if_nametoindex(ifname);
+	if(rx->ifindex == 0)
+		return -1;
+
+	if(mode != RAWRX_PACKET) {
+		if(open_xdp(rx) == 0) {
+			rx->mode = RAWRX_XDP;
+			return 0;
+		}
+		if(mode == RAWRX_XDP)
+			return -1;
+		// no AF_XDP here, fall back to the packet ring
+		rawrx_close(rx);
+		rx->fd = rx->map_fd = rx->prog_fd = rx->link_fd = -1;
+		rx->port = port;
+		rx->nports = nports;
+		rx->ifindex = if_nametoindex(ifname);
+	}
+
+	if(open_packet(rx) == -1)
+		return -1;
+	rx->mode = RAWRX_PACKET;
+	return 0;
+}
+
+// locate the UDP payload inside an ethernet frame, 0 if the frame is not for us
+static uint32_t parse_frame(rawrx_t *rx, unsigned char *frame, uint32_t len, uint16_t *port, unsigned char **payload) {
+	if(len < 42 || frame[12] != 0x08 || frame[13] != 0x00)
+		return 0;
+	unsigned char *ip = frame + 14;
+	uint32_t ihl = (ip[0] & 0x0F) * 4;
+	if((ip[0] >> 4) != 4 || ip[9] != IPPROTO_UDP || len < 14 + ihl + 8)
+		return 0;
+	unsigned char *udp = ip + ihl;
+	uint16_t dport = (udp[2] << 8) | udp[3];
+	uint16_t ulen = (udp[4] << 8) | udp[5];
+	if(dport < rx->port || dport >= rx->port + rx->nports || ulen < 8 || 14 + ihl + ulen > len)
+		return 0;
+
+	*port = dport;
+	*payload = udp + 8;
+	return ulen - 8;
+}
+
+static int poll_xdp(rawrx_t *rx, rawrx_handler_t handler, void *ctx) {
+	uint32_t prod = __atomic_load_n(rx->rx_producer, __ATOMIC_ACQUIRE);
+	uint32_t cons = *(rx->rx_consumer);
+	uint32_t fill = *(rx->fq_producer);
+	int count = 0;
+
+	for(; cons != prod; cons++, count++) {
+		struct xdp_desc *d = &(rx->rx_desc[cons % rx->frames]);
+		uint16_t port;
+		unsigned char *payload;
+		uint32_t len = parse_frame(rx, rx->umem + d->addr, d->len, &port, &payload);
+		if(len > 0) {
+			handler(ctx, port, payload, len);
+			rx->packets++;
+		}
+		else
+			rx->dropped++;
+		// frame goes back to the kernel
+		rx->fq_addr[fill++ % rx->frames] = d->addr - (d->addr % rx->frame_size);
+	}
+	__atomic_store_n(rx->rx_consumer, cons, __ATOMIC_RELEASE);
+	__atomic_store_n(rx->fq_producer, fill, __ATOMIC_RELEASE);
+
+	return count;
+}
+
+static int poll_packet(rawrx_t *rx, rawrx_handler_t handler, void *ctx) {
+	int count = 0;
+
+	for(;;) {
+		struct tpacket_block_desc *bd = (struct tpacket_block_desc *)(rx->ring + (size_t)rx->block * rx->block_size);
+		if(!(__atomic_load_n(&(bd->hdr.bh1.block_status), __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+			break;
+
+		struct tpacket3_hdr *h = (struct tpacket3_hdr *)((unsigned char *)bd + bd->hdr.bh1.offset_to_first_pkt);
+		for(uint32_t i=0; i<bd->hdr.bh1.num_pkts; i++) {
+			uint16_t port;
+			unsigned char *payload;
+			uint32_t len = parse_frame(rx, (unsigned char *)h + h->tp_mac, h->tp_snaplen, &port, &payload);
+			if(len > 0) {
+				handler(ctx, port, payload, len);
+				rx->packets++;
+			}
+			else
+				rx->dropped++;
+			count++;
+			h = (struct tpacket3_hdr *)((unsigned char *)h + h->tp_next_offset);
+		}
+
+		// block goes back to the kernel
+		__atomic_store_n(&(bd->hdr.bh1.block_status), TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+		rx->block = (rx->block + 1) % rx->blocks;
+	}
+
+	return count;
+}
+
+// wait up to timeout ms for frames and hand every payload to handler, returns the number of frames
+int rawrx_poll(rawrx_t *rx, int timeout, rawrx_handler_t handler, void *ctx) {
+	int count = (rx->mode == RAWRX_XDP) ? poll_xdp(rx, handler, ctx) : poll_packet(rx, handler, ctx);
+	if(count > 0)
+		return count;
+
+	struct pollfd pfd = { rx->fd, POLLIN | POLLERR, 0 };
+	if(poll(&pfd, 1, timeout) == -1 && errno != EINTR)
+		return -1;
+
+	return (rx->mode == RAWRX_XDP) ? poll_xdp(rx, handler, ctx) : poll_packet(rx, handler, ctx);
+}
+
+void rawrx_close(rawrx_t *rx) {
+	if(rx->rx_map != NULL && rx->rx_map != MAP_FAILED)
+		munmap(rx->rx_map, rx->rx_map_len);
+	if(rx->fq_map != NULL && rx->fq_map != MAP_FAILED)
+		munmap(rx->fq_map, rx->fq_map_len);
+	if(rx->umem != NULL && rx->umem != MAP_FAILED)
+		munmap(rx->umem, rx->umem_len);
+	if(rx->ring != NULL && rx->ring != MAP_FAILED)
+		munmap(rx->ring, rx->ring_len);
+	if(rx->fd != -1)
+		close(rx->fd);
+	if(rx->link_fd != -1)
+		close(rx->link_fd);
+	if(rx->prog_fd != -1)
+		close(rx->prog_fd);
+	if(rx->map_fd != -1)
+		close(rx->map_fd);
+	rx->rx_map = rx->fq_map = NULL;
+	rx->umem = rx->ring = NULL;
+	rx->mode = 0;
+}
@@ -0,0 +1,77 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __RAWRX_FOUNTAIN__
+#define __RAWRX_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <linux/if_xdp.h>
+
+/* Receive ring backend: frames land in memory shared with the kernel and are parsed in place,
+ * the handler gets a pointer to the UDP payload inside the frame, valid until it returns.
+ * AF_XDP: a small XDP program redirects UDP packets for [port, port + nports) on queue 0 into the socket,
+ * everything else goes on to the kernel. TPACKET_V3: a classic BPF filter on a PACKET_RX_RING. */
+
+#define RAWRX_AUTO 0
+#define RAWRX_XDP 1
+#define RAWRX_PACKET 2
+
+typedef void (*rawrx_handler_t)(void *ctx, uint16_t port, unsigned char *payload, uint32_t len);
+
+typedef struct {
+	int fd;
+	uint8_t mode;
+	int ifindex;
+	uint16_t port;			// first port, host order
+	uint16_t nports;
+	// AF_XDP
+	int map_fd, prog_fd, link_fd;
+	unsigned char *umem;
+	size_t umem_len;
+	uint32_t frames;
+	uint32_t frame_size;
+	uint32_t *rx_producer, *rx_consumer;
+	struct xdp_desc *rx_desc;
+	uint32_t *fq_producer, *fq_consumer;
+	uint64_t *fq_addr;
+	void *rx_map, *fq_map;
+	size_t rx_map_len, fq_map_len;
+	// TPACKET_V3
+	unsigned char *ring;
+	size_t ring_len;
+	uint32_t blocks;
+	uint32_t block_size;
+	uint32_t block;			// next block to read
+	// statistics
+	uint64_t packets;
+	uint64_t dropped;		// frames that were not ours
+} rawrx_t;
+
+int rawrx_queues(int ifindex);
+int rawrx_open(rawrx_t *rx, char *ifname, uint16_t port, uint16_t nports, uint8_t mode);
+int rawrx_poll(rawrx_t *rx, int timeout, rawrx_handler_t handler, void *ctx);
+void rawrx_close(rawrx_t *rx);
+
+#endif
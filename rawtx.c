@@ -0,0 +1,377 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include "rawtx.h"
+
+#define RAWTX_FRAMES 2048
+#define RAWTX_FRAME_SIZE 2048
+#define RAWTX_BLOCK_SIZE (1 << 16)
+
+// aa:bb:cc:dd:ee:ff
+int parse_mac(char *s, unsigned char *mac) {
+	unsigned int m[6];
+	if(sscanf(s, "%x:%x:%x:%x:%x:%x", &m[0], &m[1], &m[2], &m[3], &m[4], &m[5]) != 6)
+		return -1;
+	for(int i=0; i<6; i++)
+		mac[i] = m[i];
+	return 0;
+}
+
+// peer MAC from the neighbour table, the diode link has a static ARP entry
+static int arp_lookup(uint32_t ip, char *ifname, unsigned char *mac) {
+	FILE *f = fopen("/proc/net/arp", "r");
+	if(f == NULL)
+		return -1;
+
+	char line[256], sip[64], shw[64], sdev[64];
+	unsigned int type, flags;
+	int found = -1;
+	struct in_addr addr = { ip };
+	char *want = inet_ntoa(addr);
+
+	while(found == -1 && fgets(line, sizeof(line), f) != NULL) {
+		if(sscanf(line, "%63s 0x%x 0x%x %63s %*s %63s", sip, &type, &flags, shw, sdev) != 5)
+			continue;
+		if(strcmp(sip, want) == 0 && strcmp(sdev, ifname) == 0 && (flags & 0x2))
+			found = parse_mac(shw, mac);
+	}
+	fclose(f);
+
+	return found;
+}
+
+static uint16_t ip_checksum(unsigned char *hdr, uint32_t len) {
+	uint32_t sum = 0;
+	for(uint32_t i=0; i<len; i+=2)
+		sum += (hdr[i] << 8) | hdr[i + 1];
+	while(sum >> 16)
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	return ~sum & 0xFFFF;
+}
+
+// ethernet, ipv4 and udp header for one destination port; all packets have the same payload length
+static void build_header(rawtx_t *tx, unsigned char *h, uint16_t port, uint32_t len) {
+	uint16_t ip_len = 20 + 8 + len;
+	uint16_t udp_len = 8 + len;
+
+	memcpy(h, tx->dst_mac, 6);
+	memcpy(h + 6, tx->src_mac, 6);
+	h[12] = 0x08; h[13] = 0x00;
+
+	unsigned char *ip = h + 14;
+	memset(ip, 0, 20);
+	ip[0] = 0x45;
+	ip[2] = ip_len >> 8; ip[3] = ip_len & 0xFF;
+	ip[6] = 0x40;					// DF
+	ip[8] = 64;					// TTL
+	ip[9] = IPPROTO_UDP;
+	memcpy(ip + 12, &(tx->src_ip), 4);
+	memcpy(ip + 16, &(tx->dst_ip), 4);
+	uint16_t csum = ip_checksum(ip, 20);
+	ip[10] = csum >> 8; ip[11] = csum & 0xFF;
+
+	unsigned char *udp = ip + 20;
+	memcpy(udp, &port, 2);				// source port = destination port, network order
+	memcpy(udp + 2, &port, 2);
+	udp[4] = udp_len >> 8; udp[5] = udp_len & 0xFF;
+	udp[6] = 0; udp[7] = 0;				// no checksum
+}
+
+static int open_xdp(rawtx_t *tx) {
+	tx->fd = socket(AF_XDP, SOCK_RAW, 0);
+	if(tx->fd == -1)
+		return -1;
+
+	tx->frames = RAWTX_FRAMES;
+	tx->frame_size = RAWTX_FRAME_SIZE;
+	tx->umem_len = (size_t)tx->frames * tx->frame_size;
+	tx->umem = mmap(NULL, tx->umem_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(tx->umem == MAP_FAILED)
+		return -1;
+
+	struct xdp_umem_reg mr;
+	memset(&mr, 0, sizeof(mr));
+	mr.addr = (uint64_t)(uintptr_t)tx->umem;
+	mr.len = tx->umem_len;
+	mr.chunk_size = tx->frame_size;
+	int n = tx->frames;
+	if(setsockopt(tx->fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) == -1 ||
+		setsockopt(tx->fd, SOL_XDP, XDP_UMEM_FILL_RING, &n, sizeof(n)) == -1 ||
+		setsockopt(tx->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &n, sizeof(n)) == -1 ||
+		setsockopt(tx->fd, SOL_XDP, XDP_TX_RING, &n, sizeof(n)) == -1)
+		return -1;
+
+	struct xdp_mmap_offsets off;
+	socklen_t optlen = sizeof(off);
+	if(getsockopt(tx->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) == -1)
+		return -1;
+
+	tx->tx_map_len = off.tx.desc + (size_t)n * sizeof(struct xdp_desc);
+	tx->tx_map = mmap(NULL, tx->tx_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, tx->fd, XDP_PGOFF_TX_RING);
+	tx->cr_map_len = off.cr.desc + (size_t)n * sizeof(uint64_t);
+	tx->cr_map = mmap(NULL, tx->cr_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, tx->fd, XDP_UMEM_PGOFF_COMPLETION_RING);
+	if(tx->tx_map == MAP_FAILED || tx->cr_map == MAP_FAILED)
+		return -1;
+	tx->tx_producer = (uint32_t *)((char *)tx->tx_map + off.tx.producer);
+	tx->tx_consumer = (uint32_t *)((char *)tx->tx_map + off.tx.consumer);
+	tx->tx_desc = (struct xdp_desc *)((char *)tx->tx_map + off.tx.desc);
+	tx->cr_producer = (uint32_t *)((char *)tx->cr_map + off.cr.producer);
+	tx->cr_consumer = (uint32_t *)((char *)tx->cr_map + off.cr.consumer);
+	tx->cr_addr = (uint64_t *)((char *)tx->cr_map + off.cr.desc);
+
+	struct sockaddr_xdp sxdp;
+	memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = tx->ifindex;
+	sxdp.sxdp_queue_id = 0;
+	sxdp.sxdp_flags = XDP_COPY;
+	if(bind(tx->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) == -1)
+		return -1;
+
+	tx->head = tx->done = *(tx->tx_producer);
+	return 0;
+}
+
+static int open_packet(rawtx_t *tx) {
+	tx->fd = socket(AF_PACKET, SOCK_RAW, 0);
+	if(tx->fd == -1)
+		return -1;
+
+	int v = TPACKET_V3;
+	if(setsockopt(tx->fd, SOL_PACKET, PACKET_VERSION, &v, sizeof(v)) == -1)
+		return -1;
+	// the frames skip the qdisc layer, the sender paces them itself
+	int one = 1;
+	setsockopt(tx->fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+	struct tpacket_req3 req;
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = RAWTX_BLOCK_SIZE;
+	req.tp_frame_size = RAWTX_FRAME_SIZE;
+	req.tp_block_nr = (size_t)RAWTX_FRAMES * RAWTX_FRAME_SIZE / RAWTX_BLOCK_SIZE;
+	req.tp_frame_nr = RAWTX_FRAMES;
+	if(setsockopt(tx->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) == -1)
+		return -1;
+
+	tx->frames = RAWTX_FRAMES;
+	tx->frame_size = RAWTX_FRAME_SIZE;
+	tx->umem_len = (size_t)req.tp_block_size * req.tp_block_nr;
+	tx->umem = mmap(NULL, tx->umem_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, tx->fd, 0);
+	if(tx->umem == MAP_FAILED)
+		return -1;
+
+	struct sockaddr_ll sll;
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_IP);
+	sll.sll_ifindex = tx->ifindex;
+	if(bind(tx->fd, (struct sockaddr *)&sll, sizeof(sll)) == -1)
+		return -1;
+
+	return 0;
+}
+
+// returns -1 with errno set; RAWTX_AUTO tries AF_XDP first
+int rawtx_open(rawtx_t *tx, char *ifname, uint32_t dst_ip, unsigned char *dst_mac, uint8_t mode) {
+	memset(tx, 0, sizeof(rawtx_t));
+	tx->fd = -1;
+	tx->dst_ip = dst_ip;
+
+	tx->ifindex = if_nametoindex(ifname);
+	if(tx->ifindex == 0)
+		return -1;
+
+	// source MAC and IPv4 address of the diode interface
+	struct ifreq ifr;
+	int s = socket(AF_INET, SOCK_DGRAM, 0);
+	if(s == -1)
+		return -1;
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+	if(ioctl(s, SIOCGIFHWADDR, &ifr) == -1) {
+		close(s);
+		return -1;
+	}
+	memcpy(tx->src_mac, ifr.ifr_hwaddr.sa_data, 6);
+	if(ioctl(s, SIOCGIFADDR, &ifr) == -1) {
+		close(s);
+		return -1;
+	}
+	tx->src_ip = ((struct sockaddr_in *)&(ifr.ifr_addr))->sin_addr.s_addr;
+	close(s);
+
+	if(dst_mac != NULL)
+		memcpy(tx->dst_mac, dst_mac, 6);
+	else if(arp_lookup(dst_ip, ifname, tx->dst_mac) == -1) {
+		errno = EHOSTUNREACH;
+		return -1;
+	}
+
+	if(mode != RAWTX_PACKET) {
+		if(open_xdp(tx) == 0) {
+			tx->mode = RAWTX_XDP;
+			return 0;
+		}
+		if(mode == RAWTX_XDP)
+			return -1;
+		// no AF_XDP here, fall back to the packet ring
+		rawtx_close(tx);
+		tx->fd = -1;
+	}
+
+	if(open_packet(tx) == -1)
+		return -1;
+	tx->mode = RAWTX_PACKET;
+	return 0;
+}
+
+static unsigned char *header_for(rawtx_t *tx, uint16_t port, uint32_t len) {
+	for(uint32_t i=0; i<tx->nports; i++)
+		if(tx->ports[i] == port)
+			return tx->headers[i];
+	if(tx->nports == RAWTX_PORTS)
+		return NULL;
+	tx->ports[tx->nports] = port;
+	build_header(tx, tx->headers[tx->nports], port, len);
+	return tx->headers[tx->nports++];
+}
+
+// take back the frames the kernel has sent
+static void xdp_complete(rawtx_t *tx) {
+	uint32_t prod = __atomic_load_n(tx->cr_producer, __ATOMIC_ACQUIRE);
+	uint32_t cons = *(tx->cr_consumer);
+	if(prod != cons) {
+		tx->done += prod - cons;
+		__atomic_store_n(tx->cr_consumer, prod, __ATOMIC_RELEASE);
+	}
+}
+
+// wait for a free frame, kicking the kernel while the ring is full
+static unsigned char *next_frame(rawtx_t *tx) {
+	if(tx->mode == RAWTX_XDP) {
+		xdp_complete(tx);
+		while(tx->head - tx->done >= tx->frames) {
+			rawtx_flush(tx);
+			xdp_complete(tx);
+		}
+		return tx->umem + (size_t)(tx->head % tx->frames) * tx->frame_size;
+	}
+
+	struct tpacket3_hdr *h = (struct tpacket3_hdr *)(tx->umem + (size_t)(tx->head % tx->frames) * tx->frame_size);
+	while(__atomic_load_n(&(h->tp_status), __ATOMIC_ACQUIRE) != TP_STATUS_AVAILABLE) {
+		rawtx_flush(tx);
+		struct pollfd pfd = { tx->fd, POLLOUT, 0 };
+		poll(&pfd, 1, 1);
+	}
+	return (unsigned char *)h + TPACKET3_HDRLEN - sizeof(struct sockaddr_ll);
+}
+
+// queue one UDP payload for dest, the kernel is kicked every RAWTX_BATCH frames
+int rawtx_send(rawtx_t *tx, struct sockaddr_in *dest, unsigned char *payload, uint32_t len) {
+	unsigned char *hdr = header_for(tx, dest->sin_port, len);
+	if(hdr == NULL || RAWTX_HDRLEN + len > tx->frame_size - TPACKET3_HDRLEN) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned char *frame = next_frame(tx);
+	memcpy(frame, hdr, RAWTX_HDRLEN);
+	memcpy(frame + RAWTX_HDRLEN, payload, len);
+
+	if(tx->mode == RAWTX_XDP) {
+		uint32_t idx = *(tx->tx_producer);
+		struct xdp_desc *d = &(tx->tx_desc[idx % tx->frames]);
+		d->addr = (uint64_t)(tx->head % tx->frames) * tx->frame_size;
+		d->len = RAWTX_HDRLEN + len;
+		d->options = 0;
+		__atomic_store_n(tx->tx_producer, idx + 1, __ATOMIC_RELEASE);
+	}
+	else {
+		struct tpacket3_hdr *h = (struct tpacket3_hdr *)(tx->umem + (size_t)(tx->head % tx->frames) * tx->frame_size);
+		h->tp_len = RAWTX_HDRLEN + len;
+		h->tp_snaplen = RAWTX_HDRLEN + len;
+		h->tp_next_offset = 0;
+		__atomic_store_n(&(h->tp_status), TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+	}
+
+	tx->head++;
+	tx->sent++;
+	if(++(tx->pending) >= RAWTX_BATCH)
+		rawtx_flush(tx);
+
+	return len;
+}
+
+// hand the queued frames to the driver
+void rawtx_flush(rawtx_t *tx) {
+	if(tx->pending == 0 && tx->mode == RAWTX_PACKET)
+		return;
+	tx->pending = 0;
+	if(sendto(tx->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) == -1 && errno != EAGAIN && errno != EBUSY && errno != ENOBUFS)
+		perror("[sender] raw transmit kick failed");
+}
+
+// send what is left in the ring and release it
+void rawtx_close(rawtx_t *tx) {
+	if(tx->mode != 0) {
+		for(uint32_t i=0; i<1000; i++) {
+			rawtx_flush(tx);
+			if(tx->mode == RAWTX_XDP) {
+				xdp_complete(tx);
+				if(tx->done == tx->head)
+					break;
+			}
+			else {
+				struct tpacket3_hdr *h = (struct tpacket3_hdr *)(tx->umem + (size_t)((tx->head + tx->frames - 1) % tx->frames) * tx->frame_size);
+				if(__atomic_load_n(&(h->tp_status), __ATOMIC_ACQUIRE) == TP_STATUS_AVAILABLE)
+					break;
+			}
+			usleep(1000);
+		}
+	}
+
+	if(tx->tx_map != NULL && tx->tx_map != MAP_FAILED)
+		munmap(tx->tx_map, tx->tx_map_len);
+	if(tx->cr_map != NULL && tx->cr_map != MAP_FAILED)
+		munmap(tx->cr_map, tx->cr_map_len);
+	if(tx->umem != NULL && tx->umem != MAP_FAILED)
+		munmap(tx->umem, tx->umem_len);
+	if(tx->fd != -1)
+		close(tx->fd);
+	tx->tx_map = tx->cr_map = NULL;
+	tx->umem = NULL;
+	tx->mode = 0;
+}
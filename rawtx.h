@@ -0,0 +1,82 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __RAWTX_FOUNTAIN__
+#define __RAWTX_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <linux/if_xdp.h>
+
+/* Raw transmit backend: pre-framed Ethernet/IPv4/UDP packets are written into a ring shared with the kernel,
+ * AF_XDP (copy mode, works on any driver including veth) or a TPACKET_V3 PACKET_TX_RING as fallback.
+ * The peer MAC comes from the static ARP entry of the destination (see README) unless given explicitly.
+ * Headers are built once per destination port: every packet has the same length, only the payload changes.
+ * UDP checksum is left at 0, the IPv4 header carries DF and id 0. */
+
+#define RAWTX_AUTO 0
+#define RAWTX_XDP 1
+#define RAWTX_PACKET 2
+
+#define RAWTX_HDRLEN 42		// ethernet 14 + ipv4 20 + udp 8
+#define RAWTX_PORTS 4
+#define RAWTX_BATCH 16		// frames queued before the kernel is kicked
+
+typedef struct {
+	int fd;
+	uint8_t mode;
+	int ifindex;
+	unsigned char src_mac[6];
+	unsigned char dst_mac[6];
+	uint32_t src_ip;		// network order
+	uint32_t dst_ip;
+	// one header per destination port, built on first use
+	uint16_t ports[RAWTX_PORTS];
+	unsigned char headers[RAWTX_PORTS][RAWTX_HDRLEN];
+	uint32_t nports;
+	// shared ring
+	unsigned char *umem;		// AF_XDP frames, or the whole PACKET_TX_RING
+	size_t umem_len;
+	uint32_t frames;
+	uint32_t frame_size;
+	uint32_t *tx_producer, *tx_consumer;
+	struct xdp_desc *tx_desc;
+	uint32_t *cr_producer, *cr_consumer;
+	uint64_t *cr_addr;
+	void *tx_map, *cr_map;
+	size_t tx_map_len, cr_map_len;
+	uint32_t head;			// next frame to fill
+	uint32_t done;			// frames completed by the kernel (AF_XDP)
+	uint32_t pending;		// frames filled since the last kick
+	uint64_t sent;
+} rawtx_t;
+
+int rawtx_open(rawtx_t *tx, char *ifname, uint32_t dst_ip, unsigned char *dst_mac, uint8_t mode);
+int rawtx_send(rawtx_t *tx, struct sockaddr_in *dest, unsigned char *payload, uint32_t len);
+void rawtx_flush(rawtx_t *tx);
+void rawtx_close(rawtx_t *tx);
+int parse_mac(char *s, unsigned char *mac);
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "ring.h"
+
+#define RING_SPINS 64
+#define RING_MAX_SLEEP 1000
+
+// the other side is behind: give it the cpu, then back off up to 1ms so a waiting side does not burn it
+static void ring_wait(uint32_t *spins) {
+	if(*spins < RING_SPINS)
+		sched_yield();
+	else {
+		uint32_t shift = (*spins - RING_SPINS < 5) ? *spins - RING_SPINS : 5;
+		usleep((32u << shift) < RING_MAX_SLEEP ? (32u << shift) : RING_MAX_SLEEP);
+	}
+	(*spins)++;
+}
+
+// size is rounded up to a power of two, returns -1 if the slots can not be allocated
+int ring_init(ring_t *ring, uint32_t size, uint32_t slot_size) {
+	uint32_t n = 1;
+	while(n < size)
+		n <<= 1;
+
+	ring->slots = (unsigned char *)malloc((size_t)n * slot_size);
+	if(ring->slots == NULL)
+		return -1;
+	ring->size = n;
+	ring->slot_size = slot_size;
+	ring->shared = 0;
+	atomic_init(&(ring->head), 0);
+	atomic_init(&(ring->tail), 0);
+
+	return 0;
+}
+
+// same, with the slots in shared memory; the ring_t itself has to be shared by the caller
+int ring_init_shared(ring_t *ring, uint32_t size, uint32_t slot_size) {
+	uint32_t n = 1;
+	while(n < size)
+		n <<= 1;
+
+	ring->slots = mmap(NULL, (size_t)n * slot_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if(ring->slots == MAP_FAILED) {
+		ring->slots = NULL;
+		return -1;
+	}
+	ring->size = n;
+	ring->slot_size = slot_size;
+	ring->shared = 1;
+	atomic_init(&(ring->head), 0);
+	atomic_init(&(ring->tail), 0);
+
+	return 0;
+}
+
+void *ring_reserve(ring_t *ring) {
+	uint64_t head = atomic_load_explicit(&(ring->head), memory_order_relaxed);
+	uint32_t spins = 0;
+	while(head - atomic_load_explicit(&(ring->tail), memory_order_acquire) >= ring->size)
+		ring_wait(&spins);
+
+	return ring->slots + (size_t)(head & (ring->size - 1)) * ring->slot_size;
+}
+
+void ring_push(ring_t *ring) {
+	uint64_t head = atomic_load_explicit(&(ring->head), memory_order_relaxed);
+	atomic_store_explicit(&(ring->head), head + 1, memory_order_release);
+}
+
+void *ring_peek(ring_t *ring) {
+	uint64_t tail = atomic_load_explicit(&(ring->tail), memory_order_relaxed);
+	uint32_t spins = 0;
+	while(atomic_load_explicit(&(ring->head), memory_order_acquire) == tail)
+		ring_wait(&spins);
+
+	return ring->slots + (size_t)(tail & (ring->size - 1)) * ring->slot_size;
+}
+
+// the slot at tail, NULL instead of waiting when the ring is empty
+void *ring_poll(ring_t *ring) {
+	uint64_t tail = atomic_load_explicit(&(ring->tail), memory_order_relaxed);
+	if(atomic_load_explicit(&(ring->head), memory_order_acquire) == tail)
+		return NULL;
+
+	return ring->slots + (size_t)(tail & (ring->size - 1)) * ring->slot_size;
+}
+
+void ring_pop(ring_t *ring) {
+	uint64_t tail = atomic_load_explicit(&(ring->tail), memory_order_relaxed);
+	atomic_store_explicit(&(ring->tail), tail + 1, memory_order_release);
+}
+
+void ring_free(ring_t *ring) {
+	if(ring->shared)
+		munmap(ring->slots, (size_t)ring->size * ring->slot_size);
+	else
+		free(ring->slots);
+	ring->slots = NULL;
+}
@@ -0,0 +1,54 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __RING_FOUNTAIN__
+#define __RING_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/* Bounded single producer / single consumer ring of fixed size slots.
+ * The producer reserves the slot at head, fills it in place and pushes it; the consumer peeks the slot
+ * at tail, uses it in place and pops it. Both sides wait (yield, then sleep) while the ring is full/empty. */
+typedef struct {
+	unsigned char *slots;
+	uint32_t size;			// number of slots, power of two
+	uint32_t slot_size;
+	_Atomic uint64_t head;		// next slot to fill, written by the producer only
+	_Atomic uint64_t tail;		// next slot to use, written by the consumer only
+	uint8_t shared;			// slots mapped shared, the ring can be used across fork()
+} ring_t;
+
+int ring_init(ring_t *ring, uint32_t size, uint32_t slot_size);
+int ring_init_shared(ring_t *ring, uint32_t size, uint32_t slot_size);
+void *ring_reserve(ring_t *ring);
+void ring_push(ring_t *ring);
+void *ring_peek(ring_t *ring);
+void *ring_poll(ring_t *ring);
+void ring_pop(ring_t *ring);
+void ring_free(ring_t *ring);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include "schedule.h"
+#include "fountain.h"
+
+// draw the permutation for the next round
+static void schedule_round(schedule_t *sch) {
+	if(sch->depth <= 1) {
+		for(uint32_t i=0; i<sch->n; i++)
+			sch->order[i] = i;
+		shuffle32_r(sch->order, sch->n, &(sch->state));
+	}
+	else {
+		// interleaver: id goes to position id*stride mod n, consecutive ids (xor groups sharing a slice) are stride apart
+		uint64_t p = 0;
+		for(uint32_t id=0; id<sch->n; id++) {
+			sch->order[p] = id;
+			p = (p + sch->stride) % sch->n;
+		}
+		// fresh randomness every round, ids only move inside their window
+		for(uint32_t w=0; w<sch->n; w+=sch->window) {
+			uint32_t len = (sch->n - w < sch->window) ? sch->n - w : sch->window;
+			shuffle32_r(sch->order + w, len, &(sch->state));
+		}
+	}
+	sch->pos = 0;
+	sch->round++;
+
+	#ifdef DEBUG
+		printf("Schedule round %u: ", sch->round);
+		printlineArray32(sch->order, sch->n);
+	#endif
+}
+
+static uint32_t gcd32(uint32_t a, uint32_t b) {
+	while(b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// stride ~ n/depth and coprime with n, so that id*stride mod n is a permutation
+uint32_t schedule_stride(uint32_t n, uint32_t depth) {
+	uint32_t stride = (depth > 1) ? n / depth : 1;
+	if(stride == 0)
+		stride = 1;
+	while(n > 1 && gcd32(stride, n) != 1)
+		stride++;
+	return stride;
+}
+
+void schedule_init(schedule_t *sch, uint32_t n, uint64_t seed, uint32_t shift, uint32_t depth) {
+	sch->n = n;
+	sch->depth = depth;
+	sch->round = 0;
+
+	sch->stride = schedule_stride(n, depth);
+	sch->window = sch->stride / 8;
+	if(sch->window == 0)
+		sch->window = 1;
+
+	// keep the shift on a window boundary, the reading position then never crosses into the next round
+	// in the middle of a window and repeats of one id stay a round apart
+	sch->shift = (n > 0) ? shift % n : 0;
+	if(depth > 1)
+		sch->shift -= sch->shift % sch->window;
+
+	sch->order = (uint32_t *)malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+	if(sch->order == NULL) {
+		perror("[schedule] schedule_init failed to allocate\n");
+		exit(1);
+	}
+	seed_r(&(sch->state), seed);
+	if(n > 0)
+		schedule_round(sch);
+}
+
+// next slice index 0..n-1, a new permutation is drawn after every n calls
+uint32_t schedule_next(schedule_t *sch) {
+	if(sch->pos >= sch->n)
+		schedule_round(sch);
+	uint32_t slice = sch->order[(sch->pos + sch->shift) % sch->n];
+	sch->pos++;
+	return slice;
+}
+
+void schedule_free(schedule_t *sch) {
+	free(sch->order);
+	sch->order = NULL;
+}
+
+void txplan_init(txplan_t *plan, uint32_t slices, uint32_t *index, uint8_t clear_spray, uint8_t spray, uint32_t checksums,
+	uint64_t seed, uint32_t depth) {
+	plan->index = index;
+	plan->slices = slices;
+	plan->seq_sent = 0;
+	plan->copy = 0;
+	plan->paused = 0;
+	plan->clear_total = (uint64_t)slices * clear_spray;
+	plan->xor_total = (uint64_t)slices * spray;
+	plan->check_total = checksums;
+	plan->clear_sent = plan->xor_sent = plan->check_sent = 0;
+
+	// same seed and depth -> same rounds; clear reads them ahead of xor, half way to the next group of the slice
+	schedule_init(&(plan->xor), slices, seed, 0, depth);
+	schedule_init(&(plan->clear), slices, seed, (depth > 1) ? plan->xor.stride / 2 : slices / 2, depth);
+}
+
+tx_stream_t txplan_next(txplan_t *plan, uint32_t *part_no) {
+	// sequential pass in file order
+	if(plan->seq_sent < plan->slices) {
+		*part_no = ++(plan->seq_sent);
+		plan->copy = 0;
+		return TX_CLEAR;
+	}
+	if(!plan->paused) {
+		plan->paused = 1;
+		return TX_PAUSE;
+	}
+
+	// spread checksum packets evenly, the first one opens the shuffled phase
+	uint64_t data_total = plan->clear_total + plan->xor_total;
+	uint64_t data_sent = plan->clear_sent + plan->xor_sent;
+	if(plan->check_sent < plan->check_total && 
+		(data_total == 0 || plan->check_sent * data_total <= data_sent * plan->check_total)) {
+		plan->check_sent++;
+		*part_no = 0;
+		return TX_CHECKSUM;
+	}
+	if(data_sent >= data_total)
+		return TX_DONE;
+
+	// pick the stream that is furthest behind its share
+	if(plan->xor_sent >= plan->xor_total ||
+		(plan->clear_sent < plan->clear_total && plan->clear_sent * plan->xor_total <= plan->xor_sent * plan->clear_total)) {
+		plan->clear_sent++;
+		*part_no = plan->index[schedule_next(&(plan->clear))] + 1;
+		plan->copy = plan->clear.round;
+		return TX_CLEAR;
+	}
+	plan->xor_sent++;
+	*part_no = schedule_next(&(plan->xor)) + 1;
+	plan->copy = plan->xor.round - 1;
+	return TX_XOR;
+}
+
+void txplan_free(txplan_t *plan) {
+	schedule_free(&(plan->clear));
+	schedule_free(&(plan->xor));
+}
@@ -0,0 +1,88 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __SCHEDULE_FOUNTAIN__
+#define __SCHEDULE_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Repetition schedule for the shuffled phase.
+ * Every round is a fresh permutation of all n slices, so after r rounds each slice was sent exactly r times
+ * (rand() % n leaves ~e^-r of the slices out by coupon-collector effects).
+ * Two schedules built with the same seed and depth walk the same permutations; shift rotates the reading position
+ * inside each round, so the copies emitted by the two streams for one id are shift positions apart.
+ *
+ * depth > 1 interleaves each round: id is placed at id*stride mod n with stride ~ n/depth, then shuffled inside windows
+ * of stride/8 positions. Ids closer than depth to each other (the xor groups sharing a slice when depth >= XOR_GROUP_SIZE)
+ * stay at least 3/4*stride positions apart, and the same id is at least n - stride/4 positions apart in consecutive rounds. */
+typedef struct {
+	uint32_t *order;	// permutation of the current round
+	uint32_t n;
+	uint32_t depth;
+	uint32_t stride;	// interleaver spacing of consecutive ids
+	uint32_t window;	// shuffle window inside a round
+	uint32_t pos;
+	uint32_t shift;
+	uint32_t round;
+	uint64_t state;		// private generator, independent from the fountain shuffle
+} schedule_t;
+
+uint32_t schedule_stride(uint32_t n, uint32_t depth);
+void schedule_init(schedule_t *sch, uint32_t n, uint64_t seed, uint32_t shift, uint32_t depth);
+uint32_t schedule_next(schedule_t *sch);
+void schedule_free(schedule_t *sch);
+
+/* Transmission plan of one file: sequential clear pass in file order, a pause, then clear repeats, xor groups and
+ * checksum packets interleaved packet by packet in proportion to their counts (instead of 10% blocks of each).
+ * Clear repeats send the first slice of the group the xor stream sends stride/2 positions later, half way between
+ * the groups of that slice: a burst shorter than ~n/(2*depth) packets of one stream takes at most one copy of a slice. */
+typedef enum {
+	TX_CLEAR = 0,
+	TX_XOR = 1,
+	TX_CHECKSUM = 2,
+	TX_PAUSE = 3,		// end of the sequential pass
+	TX_DONE = 4
+} tx_stream_t;
+
+typedef struct {
+	schedule_t clear;
+	schedule_t xor;
+	uint32_t *index;	// fountain shuffle, not owned
+	uint32_t slices;
+	uint32_t seq_sent;
+	uint32_t copy;		// copy of the slice or xor group txplan_next returned last, the sequential pass is clear copy 0
+	uint64_t clear_total, clear_sent;
+	uint64_t xor_total, xor_sent;
+	uint64_t check_total, check_sent;
+	uint8_t paused;
+} txplan_t;
+
+void txplan_init(txplan_t *plan, uint32_t slices, uint32_t *index, uint8_t clear_spray, uint8_t spray, uint32_t checksums,
+	uint64_t seed, uint32_t depth);
+tx_stream_t txplan_next(txplan_t *plan, uint32_t *part_no);
+void txplan_free(txplan_t *plan);
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include "sysframe.h"
+
+void sysdgram_serialize(uint32_t source, uint64_t seq, unsigned char *data) {
+	for(int i=0; i<4; i++)
+		data[i] = source >> (24 - 8 * i);
+	for(int i=0; i<8; i++)
+		data[4 + i] = seq >> (56 - 8 * i);
+}
+
+int sysdgram_parse(uint32_t *source, uint64_t *seq, unsigned char *data, size_t len) {
+	if(len < SYSDGRAM_HEADER)
+		return -1;
+	*source = 0;
+	*seq = 0;
+	for(int i=0; i<4; i++)
+		*source = (*source << 8) | data[i];
+	for(int i=0; i<8; i++)
+		*seq = (*seq << 8) | data[4 + i];
+	return 0;
+}
+
+void sysframe_serialize(sysframe_t *frame, unsigned char *data) {
+	data[0] = 'D';
+	data[1] = 'S';
+	data[2] = frame->type;
+	data[3] = frame->index;
+	for(int i=0; i<4; i++) {
+		data[4 + i] = frame->run >> (24 - 8 * i);
+		data[8 + i] = frame->window >> (24 - 8 * i);
+	}
+	data[12] = frame->k;
+	data[13] = frame->r;
+	data[14] = frame->length >> 8;
+	data[15] = frame->length;
+}
+
+// -1 for anything that is not a whole frame
+int sysframe_parse(sysframe_t *frame, unsigned char *data, size_t len) {
+	if(len < SYSFRAME_HEADER || data[0] != 'D' || data[1] != 'S' || data[2] > SYSFRAME_REPAIR)
+		return -1;
+	frame->type = data[2];
+	frame->index = data[3];
+	frame->run = 0;
+	frame->window = 0;
+	for(int i=0; i<4; i++) {
+		frame->run = (frame->run << 8) | data[4 + i];
+		frame->window = (frame->window << 8) | data[8 + i];
+	}
+	frame->k = data[12];
+	frame->r = data[13];
+	frame->length = ((uint16_t)data[14] << 8) | data[15];
+	if(len != SYSFRAME_HEADER + (size_t)frame->length)
+		return -1;
+	if(frame->type == SYSFRAME_REPAIR && (frame->k == 0 || frame->index < frame->k || frame->index - frame->k >= frame->r))
+		return -1;
+	return 0;
+}
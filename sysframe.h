@@ -0,0 +1,73 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __SYSFRAME_FOUNTAIN__
+#define __SYSFRAME_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Datagrams of datadiode-amplify-syslog start with the source and its sequence number, the lines follow as
+ * <length (2)><line>; every source numbers its datagrams 0, 1, 2 ... and the deamplifier drops the copies.
+ *		Source					: 4 bytes		-> random per amplifier start
+ *		Sequence				: 8 bytes
+ * all numbers big endian */
+
+#define SYSDGRAM_HEADER 12
+
+/* Frames of the coded syslog mode (-F of datadiode-amplify-syslog and datadiode-deamplify-syslog).
+ * Datagrams are sent at once as the payload of data frames and grouped in windows of up to k of them; a window is closed when it is
+ * full or its deadline passes and r repair frames follow, Reed-Solomon coded (fec.h) over the blocks
+ * <payload length (2)><payload> of its data frames, zero padded to the longest.
+ *		Magic					: 2 bytes		-> "DS"
+ *		Type					: 1 byte		-> SYSFRAME_DATA or SYSFRAME_REPAIR
+ *		Index					: 1 byte		-> data 0..k-1, repair k..k+r-1
+ *		Run						: 4 bytes		-> random per amplifier start, windows are told apart by run and window
+ *		Window					: 4 bytes		-> counted from 0 in every run
+ *		k						: 1 byte		-> data frames of the window, 0 in data frames (not known yet)
+ *		r						: 1 byte
+ *		Length					: 2 bytes		-> payload bytes, repair: the padded block length
+ *		Payload
+ * all numbers big endian */
+
+#define SYSFRAME_HEADER 16
+#define SYSFRAME_DATA 0
+#define SYSFRAME_REPAIR 1
+
+typedef struct {
+	uint8_t type;
+	uint8_t index;
+	uint32_t run;
+	uint32_t window;
+	uint8_t k;
+	uint8_t r;
+	uint16_t length;
+} sysframe_t;
+
+void sysdgram_serialize(uint32_t source, uint64_t seq, unsigned char *data);
+int sysdgram_parse(uint32_t *source, uint64_t *seq, unsigned char *data, size_t len);
+void sysframe_serialize(sysframe_t *frame, unsigned char *data);
+int sysframe_parse(sysframe_t *frame, unsigned char *data, size_t len);
+
+#endif
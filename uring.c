@@ -0,0 +1,254 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include "uring.h"
+
+static int sys_setup(unsigned entries, struct io_uring_params *p) {
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned complete, unsigned flags) {
+	return syscall(__NR_io_uring_enter, fd, submit, complete, flags, NULL, 0);
+}
+
+static int sys_register(int fd, unsigned opcode, void *arg, unsigned nr) {
+	return syscall(__NR_io_uring_register, fd, opcode, arg, nr);
+}
+
+// returns -1 with errno set when io_uring is not available
+int uring_open(uring_t *u, unsigned entries, uint32_t nbufs, uint32_t buf_size, unsigned nfiles) {
+	struct io_uring_params p;
+
+	memset(u, 0, sizeof(uring_t));
+	memset(&p, 0, sizeof(p));
+	u->fd = sys_setup(entries, &p);
+	if(u->fd == -1)
+		return -1;
+	u->entries = p.sq_entries;
+
+	u->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	u->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if(p.features & IORING_FEAT_SINGLE_MMAP) {
+		if(u->cq_len > u->sq_len)
+			u->sq_len = u->cq_len;
+		u->cq_len = u->sq_len;
+	}
+	u->sq_map = mmap(NULL, u->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+	if(u->sq_map == MAP_FAILED)
+		return -1;
+	if(p.features & IORING_FEAT_SINGLE_MMAP)
+		u->cq_map = u->sq_map;
+	else {
+		u->cq_map = mmap(NULL, u->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+		if(u->cq_map == MAP_FAILED)
+			return -1;
+	}
+	u->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	u->sqes = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+	if(u->sqes == MAP_FAILED)
+		return -1;
+
+	u->sq_head = (unsigned *)((char *)u->sq_map + p.sq_off.head);
+	u->sq_tail = (unsigned *)((char *)u->sq_map + p.sq_off.tail);
+	u->sq_mask = (unsigned *)((char *)u->sq_map + p.sq_off.ring_mask);
+	u->sq_array = (unsigned *)((char *)u->sq_map + p.sq_off.array);
+	u->cq_head = (unsigned *)((char *)u->cq_map + p.cq_off.head);
+	u->cq_tail = (unsigned *)((char *)u->cq_map + p.cq_off.tail);
+	u->cq_mask = (unsigned *)((char *)u->cq_map + p.cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *)((char *)u->cq_map + p.cq_off.cqes);
+
+	// buffer pool plus the constant buffer, pinned once instead of on every write
+	u->nbufs = nbufs;
+	u->buf_size = buf_size;
+	u->bufs = mmap(NULL, (size_t)(nbufs + 1) * buf_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	u->free_bufs = (uint32_t *)malloc(nbufs * sizeof(uint32_t));
+	struct iovec *iov = (struct iovec *)malloc((nbufs + 1) * sizeof(struct iovec));
+	if(u->bufs == MAP_FAILED || u->free_bufs == NULL || iov == NULL)
+		return -1;
+	for(uint32_t i=0; i<=nbufs; i++) {
+		iov[i].iov_base = u->bufs + (size_t)i * buf_size;
+		iov[i].iov_len = buf_size;
+	}
+	for(uint32_t i=0; i<nbufs; i++)
+		u->free_bufs[i] = nbufs - 1 - i;
+	u->nfree = nbufs;
+	u->fixed = u->bufs + (size_t)nbufs * buf_size;
+	int ret = sys_register(u->fd, IORING_REGISTER_BUFFERS, iov, nbufs + 1);
+	free(iov);
+	if(ret == -1)
+		return -1;
+
+	// empty file table, slots are filled in with uring_set_file
+	int *fds = (int *)malloc(nfiles * sizeof(int));
+	if(fds == NULL)
+		return -1;
+	for(unsigned i=0; i<nfiles; i++)
+		fds[i] = -1;
+	ret = sys_register(u->fd, IORING_REGISTER_FILES, fds, nfiles);
+	free(fds);
+	if(ret == -1)
+		return -1;
+	u->nfiles = nfiles;
+
+	return 0;
+}
+
+// the slot is resolved when a write is issued, not when it is queued: drain the ring before replacing a file in use
+int uring_set_file(uring_t *u, unsigned slot, int fd) {
+	struct io_uring_files_update up;
+
+	memset(&up, 0, sizeof(up));
+	up.offset = slot;
+	up.fds = (uint64_t)(uintptr_t)&fd;
+	return (sys_register(u->fd, IORING_REGISTER_FILES_UPDATE, &up, 1) == 1) ? 0 : -1;
+}
+
+// collect finished writes, buffers go back to the pool
+static void reap(uring_t *u) {
+	unsigned head = *(u->cq_head);
+	unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+
+	for(; head != tail; head++) {
+		struct io_uring_cqe *cqe = &(u->cqes[head & *(u->cq_mask)]);
+		if(cqe->res < 0 && cqe->res != -ECANCELED) {
+			fprintf(stderr, "[receiver] io_uring write failed: %s\n", strerror(-cqe->res));
+			exit(29);
+		}
+		if(cqe->user_data != 0)
+			u->free_bufs[u->nfree++] = (uint32_t)(cqe->user_data - 1);
+		u->inflight--;
+	}
+	__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+// hand the queued writes to the kernel, optionally wait for some of them to finish
+int uring_submit(uring_t *u, unsigned wait) {
+	if(wait > u->inflight + u->pending)
+		wait = u->inflight + u->pending;
+	while(u->pending > 0 || wait > 0) {
+		int ret = sys_enter(u->fd, u->pending, wait, (wait > 0) ? IORING_ENTER_GETEVENTS : 0);
+		if(ret == -1) {
+			if(errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+				reap(u);
+				continue;
+			}
+			return -1;
+		}
+		u->pending -= ret;
+		u->inflight += ret;
+		if(wait > 0)
+			break;
+	}
+	reap(u);
+	return 0;
+}
+
+// wait for everything queued so far
+int uring_drain(uring_t *u) {
+	while(u->pending > 0 || u->inflight > 0)
+		if(uring_submit(u, u->pending + u->inflight) == -1)
+			return -1;
+	return 0;
+}
+
+// a free registered buffer, waits for completions only when the pool is empty
+unsigned char *uring_buffer(uring_t *u, uint32_t *index) {
+	reap(u);
+	while(u->nfree == 0)
+		if(uring_submit(u, 1) == -1) {
+			perror("[receiver] io_uring submit failed");
+			exit(29);
+		}
+
+	*index = u->free_bufs[--(u->nfree)];
+	return u->bufs + (size_t)(*index) * u->buf_size;
+}
+
+static struct io_uring_sqe *get_sqe(uring_t *u) {
+	unsigned tail = *(u->sq_tail);
+
+	while(tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->entries) {
+		if(uring_submit(u, 1) == -1) {
+			perror("[receiver] io_uring submit failed");
+			exit(29);
+		}
+	}
+
+	struct io_uring_sqe *sqe = &(u->sqes[tail & *(u->sq_mask)]);
+	memset(sqe, 0, sizeof(*sqe));
+	u->sq_array[tail & *(u->sq_mask)] = tail & *(u->sq_mask);
+	return sqe;
+}
+
+static void commit_sqe(uring_t *u) {
+	__atomic_store_n(u->sq_tail, *(u->sq_tail) + 1, __ATOMIC_RELEASE);
+	u->pending++;
+}
+
+/* queue a write of data (inside registered buffer index) to the file in slot
+ * buffers from the pool are released when the write completes, the constant buffer never is
+ * link orders the write before the next one queued */
+void uring_write_fixed(uring_t *u, unsigned slot, uint32_t index, unsigned char *data, uint32_t len, off_t offset, uint8_t link) {
+	struct io_uring_sqe *sqe = get_sqe(u);
+
+	sqe->opcode = IORING_OP_WRITE_FIXED;
+	sqe->flags = IOSQE_FIXED_FILE | (link ? IOSQE_IO_LINK : 0);
+	sqe->fd = slot;
+	sqe->off = offset;
+	sqe->addr = (uint64_t)(uintptr_t)data;
+	sqe->len = len;
+	sqe->buf_index = index;
+	sqe->user_data = (index < u->nbufs) ? index + 1 : 0;
+	commit_sqe(u);
+
+	// batch submissions, never leave a link chain open across a submit
+	if(!link && u->pending >= URING_BATCH && uring_submit(u, 0) == -1) {
+		perror("[receiver] io_uring submit failed");
+		exit(29);
+	}
+}
+
+void uring_close(uring_t *u) {
+	uring_drain(u);
+	if(u->sqes != NULL && u->sqes != MAP_FAILED)
+		munmap(u->sqes, u->sqes_len);
+	if(u->cq_map != NULL && u->cq_map != MAP_FAILED && u->cq_map != u->sq_map)
+		munmap(u->cq_map, u->cq_len);
+	if(u->sq_map != NULL && u->sq_map != MAP_FAILED)
+		munmap(u->sq_map, u->sq_len);
+	if(u->bufs != NULL && u->bufs != MAP_FAILED)
+		munmap(u->bufs, (size_t)(u->nbufs + 1) * u->buf_size);
+	free(u->free_bufs);
+	if(u->fd != -1)
+		close(u->fd);
+	memset(u, 0, sizeof(uring_t));
+	u->fd = -1;
+}
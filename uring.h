@@ -0,0 +1,71 @@
+/*
+ *      (C) 2025 Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *               Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *       
+ *      This software is used internally at the Politehnica University of Timisoara to upload files through data diodes and recover the missing packets.
+ *      It is based on Beej's Guide on Network Programming and uses code snippets from Numerical Recipes by William H. Press, Saul A. Teukolsky,
+ *      William T. Vetterling and Brian P. Flannery.
+ *
+ *      Principal Investigator: Alin-Adrian Anton <alin.anton@cs.upt.ro>
+ *      Project members: Razvan-Dorel Cioarga <razvan.cioarga@cs.upt.ro>
+ *                       Eugenia Capota <eugenia.capota@cs.upt.ro>
+ *                       Petra Csereoka <petra.csereoka@cs.upt.ro>
+ *                       Bianca Gusita <bianca.gusita@cs.upt.ro>
+ *
+ *      This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation,
+ *      either version 3 of the License, or (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *      See the GNU General Public License for more details.
+ *      You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. 
+ *
+ *      An unofficial Romanian translation of the GNU General Public License is available here: <https://staff.cs.upt.ro/~gnu/Licenta_GPL-3-0_RO.html>.                                        
+*/ 
+
+#ifndef __URING_FOUNTAIN__
+#define __URING_FOUNTAIN__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <linux/io_uring.h>
+
+/* Minimal io_uring writer on top of the raw system calls.
+ * Writes come out of a pool of registered buffers into registered files, they are queued and
+ * submitted in batches. Completions are reaped whenever the queue is touched, the caller only
+ * waits when the buffer pool runs dry or when it drains the ring on purpose. */
+
+#define URING_BATCH 32
+
+typedef struct {
+	int fd;
+	unsigned entries;
+	// submission queue
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	struct io_uring_sqe *sqes;
+	// completion queue
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+	void *sq_map, *cq_map;
+	size_t sq_len, cq_len, sqes_len;
+	unsigned pending;		// queued, not yet submitted
+	unsigned inflight;		// submitted, not yet completed
+	// registered buffers: nbufs in the pool, then one constant buffer at index nbufs
+	unsigned char *bufs;
+	uint32_t nbufs;
+	uint32_t buf_size;
+	uint32_t *free_bufs;
+	uint32_t nfree;
+	unsigned char *fixed;
+	unsigned nfiles;
+} uring_t;
+
+int uring_open(uring_t *u, unsigned entries, uint32_t nbufs, uint32_t buf_size, unsigned nfiles);
+int uring_set_file(uring_t *u, unsigned slot, int fd);
+unsigned char *uring_buffer(uring_t *u, uint32_t *index);
+void uring_write_fixed(uring_t *u, unsigned slot, uint32_t index, unsigned char *data, uint32_t len, off_t offset, uint8_t link);
+int uring_submit(uring_t *u, unsigned wait);
+int uring_drain(uring_t *u);
+void uring_close(uring_t *u);
+
+#endif